@@ -5,6 +5,8 @@
 #include "freeglut.h"
 #include "GLSL.h"
 #include "MeshIO.h"
+#include "MeshPack.h"
+#include "Mipmap.h"
 
 // Application Data
 
@@ -15,6 +17,7 @@ vector<vec3> points;				// 3D mesh vertices
 vector<vec3> normals;				// vertex normals
 vector<int3> triangles;				// triplets of vertex indices
 vector<vec2> uvs;
+PackedMesh packed;					// quantized for the GPU
 
 vec3  lightSource(1, 1, 0);		// for Phong shading
 GLuint vBuffer = 0;				// GPU vertex buffer ID
@@ -33,10 +36,11 @@ char *vertexShader = "\
 	out vec3 vNormal;													\n\
     uniform mat4 view;													\n\
 	uniform mat4 persp;													\n\
+	uniform mat3 normalMatrix;											\n\
 	uniform mat4 scale;													\n\
 	void main() {														\n\
 		vPoint = (view*vec4(point, 1)).xyz;								\n\
-		vNormal = (view*vec4(normal, 0)).xyz;							\n\
+		vNormal = normalMatrix*normal;									\n\
 		vUv = uv;														\n\
 		//Bonus2														\n\
 		//vUv = vec2(vec4(uv,0,1)*scale).xy;							\n\
@@ -67,21 +71,9 @@ char *pixelShader = "\
 // Initialization
 
 void InitVertexBuffer() {
-    // create GPU buffer, make it the active buffer
-    glGenBuffers(1, &vBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vBuffer);
-    // allocate memory for vertex positions and normals
-	int sizePts = points.size()*sizeof(vec3);
-	int sizeNrms = normals.size()*sizeof(vec3);
-	int sizeUvs = uvs.size() * sizeof(vec2);
-	
-    glBufferData(GL_ARRAY_BUFFER, sizePts+sizeNrms+sizeUvs, NULL, GL_STATIC_DRAW);
-    // copy data
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizePts, &points[0]);
-	if (sizeNrms)
-		glBufferSubData(GL_ARRAY_BUFFER, sizePts, sizeNrms, &normals[0]);
-	if (sizeUvs)
-		glBufferSubData(GL_ARRAY_BUFFER, sizeNrms, sizeUvs, &uvs[0]);
+    // quantize vertex positions, normals and uvs, copy to a new GPU buffer and make it active
+	PackMesh(points, &normals, &uvs, packed);
+	vBuffer = InitPackedBuffer(packed);
 }
 
 // Interactive Rotation
@@ -98,18 +90,11 @@ void MouseButton(int butn, int state, int x, int y) {
 
 
 void InitTexture(const char *filename) {
-	int width, height;
-	char*pixels = ReadTexture(filename, width, height);
-
-	if (pixels) {
-		// allocate GPU texture buffer; copy, free pixels
-		glGenTextures(1, &textureId);
-		glBindTexture(GL_TEXTURE_2D, textureId);
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);// in case width not multiple of 4
-											  // transfer pixel data
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, pixels);
-		delete[]pixels;
-		glGenerateMipmap(GL_TEXTURE_2D);
+	vector<MipLevel> levels;
+	int channels;
+	if (ReadMipmapsCached(filename, levels, channels, false, 0)) {
+		// allocate GPU texture buffer; transfer each mipmap level
+		textureId = UploadMipmaps(levels, channels);
 		// refer sampler uniform to texture 0 (default texture)
 		// for multiple textures, see glActiveTexture
 		GLSL::SetUniform(program, "textureImage", 0);
@@ -129,7 +114,8 @@ void Display() {
     glUseProgram(program);
 	// update view matrix
 	mat4 view = Translate(0, 0, -10)*RotateY(rotNew.x)*RotateX(rotNew.y);
-	GLSL::SetUniform(program, "view", view);
+	GLSL::SetUniform(program, "view", view*packed.Decode());	// packed points are in +/-1
+	GLSL::SetUniform(program, "normalMatrix", NormalMatrix(view*packed.Decode()));
 	// update persp matrix
 	static float fov = 15, nearPlane = -.001f, farPlane = -500;
 	static float aspect = (float)glutGet(GLUT_WINDOW_WIDTH)/(float)glutGet(GLUT_WINDOW_HEIGHT);
@@ -153,11 +139,7 @@ void Display() {
 	glClear(GL_DEPTH_BUFFER_BIT);
 	glEnable(GL_DEPTH_TEST);
     // setup vertex feeder
-	int sizePts = points.size()*sizeof(vec3);
-	int sizeNrms = normals.size() * sizeof(vec3);
-	GLSL::VertexAttribPointer(program, "point", 3, GL_FLOAT, GL_FALSE, 0, (void *) 0);
-	GLSL::VertexAttribPointer(program, "normal", 3, GL_FLOAT, GL_FALSE, 0, (void *) sizePts);
-	GLSL::VertexAttribPointer(program, "uv", 2, GL_FLOAT, GL_FALSE, 0, (void *) sizeNrms);
+	PackedAttributes(program, packed);
 	// draw triangles, finish
     glDrawElements(GL_TRIANGLES, 3*triangles.size(), GL_UNSIGNED_INT, &triangles[0]);
     glFlush();
@@ -175,7 +157,7 @@ void main(int argc, char **argv) {
     glewInit();
 	program = GLSL::LinkProgramViaCode(vertexShader, pixelShader);
 	InitTexture(fileName);
-	if (!ReadAsciiObj(objFilename, points, triangles, &normals)) {
+	if (!ReadObjCached(objFilename, points, triangles, &normals)) {
 		printf("failed to read obj file\n");
 		getchar();
 		return;
@@ -1,10 +1,13 @@
 // ShadeMeshSTL.cpp: Phong shade .stl mesh
 
 #include <stdio.h>
+#include <chrono>
 #include <glew.h>
 #include <freeglut.h>
 #include "GLSL.h"
 #include "MeshIO.h"
+#include "MeshLoader.h"
+#include "MeshOpt.h"
 
 // Application Data
 
@@ -12,7 +15,13 @@ char			   *filename = "C:/Users/jules/SeattleUniversity/Web/Models/Bolt.stl";
 vec3				lightSource(1, 1, 0);	// for Phong shading
 GLuint				vBuffer = 0;			// GPU vertex buffer ID
 GLuint				program = 0;			// GLSL program ID
-vector<VertexSTL>	vertices;
+vector<vec3>		points;					// welded from the STL triangle soup
+vector<vec3>		normals;				// vertex normals
+vector<int3>		triangles;				// triplets of vertex indices
+vector<Meshlet>		meshlets;				// clusters of triangles, for culling
+vector<int2>		ranges;					// triangles of meshlets in view
+MeshLoader			loader;					// reads the file in the background
+ProgressiveMesh		preview;				// facets read so far, until the whole mesh arrives
 
 // Shaders
 
@@ -24,11 +33,12 @@ char *vertexShader = "\
 	out vec3 vNormal;													\n\
     uniform mat4 view;													\n\
 	uniform mat4 persp;													\n\
+	uniform mat3 normalMatrix;											\n\
 	void main() {														\n\
 		vec4 hPosition = view*vec4(point, 1);							\n\
 		vPoint = hPosition.xyz;											\n\
 		gl_Position = persp*hPosition;									\n\
-		vNormal = (view*vec4(normal, 0)).xyz;							\n\
+		vNormal = normalMatrix*normal;									\n\
 	}";
 
 char *pixelShader = "\
@@ -76,7 +86,9 @@ void Display() {
 	// update and send matrices to vertex shader
 	mat4 view = Translate(0, 0, -5)*RotateY(rotNew.x)*RotateX(rotNew.y);
 	mat4 persp = Perspective(fov, aspect, nearPlane, farPlane);
-	GLSL::SetUniform(program, "view", view);
+	mat4 modelview = vBuffer? view : view*preview.Fit();	// preview is not normalized
+	GLSL::SetUniform(program, "view", modelview);
+	GLSL::SetUniform(program, "normalMatrix", NormalMatrix(modelview));
 	GLSL::SetUniform(program, "persp", persp);
 	// transform light and send to fragment shader
 	vec4 hLight = view*vec4(lightSource, 1);
@@ -89,21 +101,62 @@ void Display() {
 	glEnable(GL_DEPTH_BUFFER);
 	glClear(GL_DEPTH_BUFFER_BIT);
 	glEnable(GL_DEPTH_TEST);
+	if (!vBuffer) {
+		// still loading: draw what has arrived and is in view
+		mat4 fullview = persp*modelview;
+		preview.Draw(program, true, &fullview);
+		glFlush();
+		return;
+	}
     // link shader inputs with  vertex buffer
-	GLSL::VertexAttribPointer(program, "point", 3, GL_FLOAT, GL_FALSE, sizeof(VertexSTL), (void *) 0);
-	GLSL::VertexAttribPointer(program, "normal", 3, GL_FLOAT, GL_FALSE, sizeof(VertexSTL), (void *) sizeof(vec3));
-	// draw triangles and finish
- 	glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+	int sizePts = points.size()*sizeof(vec3);
+	GLSL::VertexAttribPointer(program, "point", 3, GL_FLOAT, GL_FALSE, 0, (void *) 0);
+	GLSL::VertexAttribPointer(program, "normal", 3, GL_FLOAT, GL_FALSE, 0, (void *) (size_t) sizePts);
+	// draw triangles of meshlets in view and facing the eye (an STL solid is closed), and finish
+	vec4 hEye = RotateX(-rotNew.y)*RotateY(-rotNew.x)*vec4(0, 0, 5, 1);	// inverse view of origin
+	vec3 eye(hEye.x, hEye.y, hEye.z);
+	CullMeshlets(meshlets, persp*view, &eye, ranges);
+	for (size_t i = 0; i < ranges.size(); i++)
+		glDrawElements(GL_TRIANGLES, 3*ranges[i].i2, GL_UNSIGNED_INT, &triangles[ranges[i].i1]);
     glFlush();
 }
 
 void InitVertexBuffer() {
     glGenBuffers(1, &vBuffer);
     glBindBuffer(GL_ARRAY_BUFFER, vBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(VertexSTL), &vertices[0], GL_STATIC_DRAW);
+	int sizePts = points.size()*sizeof(vec3), sizeNrms = normals.size()*sizeof(vec3);
+	glBufferData(GL_ARRAY_BUFFER, sizePts+sizeNrms, NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizePts, &points[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, sizePts, sizeNrms, &normals[0]);
+}
+
+void Idle() {
+	// upload what the loader has read; once the whole mesh arrives, replace the preview with it
+	int nBefore = preview.nTriangles;
+	MeshChunk *whole = preview.Upload(loader);
+	if (whole) {
+		points.swap(whole->points);
+		normals.swap(whole->normals);
+		triangles.swap(whole->triangles);
+		delete whole;
+		preview.Clear();
+		printf("%i triangles\n", triangles.size());
+		InitVertexBuffer();
+	}
+	if (!loader.Loading()) {
+		if (loader.Failed())
+			printf("Failed to read %s\n", filename);
+		glutIdleFunc(NULL);
+	}
+	if (whole || preview.nTriangles != nBefore)
+		glutPostRedisplay();
+	else
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
 }
 
 void Close() {
+	loader.Stop();
+	preview.Clear();
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glDeleteBuffers(1, &vBuffer);
 }
@@ -114,15 +167,14 @@ void main(int argc, char **argv) {
     glutCreateWindow("Mesh Example");
     glewInit();
 	program = GLSL::LinkProgramViaCode(vertexShader, pixelShader);
-	if (!ReadSTL(filename, vertices)) {
-		printf("Failed to read obj file\n");
-		getchar();
-		return;
-	}
-	printf("%i triangles\n", vertices.size()/3);
-	Normalize(vertices);
-    InitVertexBuffer();
+	// read, weld, shade and cluster on the loader thread; meshlets is set before the whole mesh is queued
+	loader.Start(filename, [](MeshChunk &mesh) {
+		Normalize(mesh.points);
+		SetVertexNormals(mesh.points, mesh.triangles, mesh.normals);
+		BuildMeshlets(mesh.points, mesh.triangles, meshlets);
+	});
     glutDisplayFunc(Display);
+	glutIdleFunc(Idle);
 	glutMouseFunc(MouseButton);
 	glutMotionFunc(MouseDrag);
     glutCloseFunc(Close);
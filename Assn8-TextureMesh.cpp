@@ -5,6 +5,9 @@
 #include <freeglut.h>
 #include "GLSL.h"
 #include "MeshIO.h"
+#include "MeshOpt.h"
+#include "MeshPack.h"
+#include "Mipmap.h"
 
 // Application Data
 
@@ -15,6 +18,7 @@ vector<vec3> points;
 vector<vec3> normals;
 vector<vec2> textures;
 vector<int3> triangles;
+PackedMesh   packed;
 
 vec3         lightSource(1, 1, 0);
 GLuint		 programId = 0, vBufferId = 0, textureId = 0;
@@ -31,9 +35,10 @@ char *vertexShader = "\
 	out vec2 vUv;													\n\
     uniform mat4 view;												\n\
 	uniform mat4 persp;												\n\
+	uniform mat3 normalMatrix;										\n\
 	void main() {													\n\
 		vPoint = (view*vec4(point, 1)).xyz;							\n\
-		vNormal = (view*vec4(normal, 0)).xyz;						\n\
+		vNormal = normalMatrix*normal;								\n\
 		gl_Position = persp*vec4(vPoint, 1);						\n\
 		vUv = uv;													\n\
 	}";
@@ -64,35 +69,22 @@ char *pixelShader = "\
 // Vertex Buffering
 
 void InitVertexBuffer() {
-    // create GPU buffer, make it the active buffer
-    glGenBuffers(1, &vBufferId);
-    glBindBuffer(GL_ARRAY_BUFFER, vBufferId);
-	// allocate and fill vertex buffer
-	int nPts = points.size(), nNrms = normals.size(), nTex = textures.size();
-	int sizePts = nPts*sizeof(vec3), sizeNrms = nNrms*sizeof(vec3), sizeTex = nTex*sizeof(vec2);
-    glBufferData(GL_ARRAY_BUFFER, sizePts+sizeNrms+sizeTex, NULL, GL_STATIC_DRAW);
-    // load data to sub-buffers
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizePts, &points[0]);
-	if (sizeNrms)
-		glBufferSubData(GL_ARRAY_BUFFER, sizePts, sizeNrms, &normals[0]);
-	if (sizeTex)
-		glBufferSubData(GL_ARRAY_BUFFER, sizePts+sizeNrms, sizeTex, &textures[0]);
+	// quantize points, normals, uvs (14 rather than 32 bytes per vertex)
+	PackMesh(points, &normals, &textures, packed);
+    // create GPU buffer, make it the active buffer, load packed sub-buffers
+	vBufferId = InitPackedBuffer(packed);
 }
 
 // Texture
 
 void InitTexture(const char *filename) {
-	int width, height;
-	char *pixels = ReadTexture(filename, width, height);
-	if (pixels) {
-		// allocate GPU texture buffer; copy, free pixels
-		glGenTextures(1, &textureId);
-		glBindTexture(GL_TEXTURE_2D, textureId);
+	// read texture image and its mipmaps (cached beside it as <filename>.mip)
+	vector<MipLevel> levels;
+	int channels;
+	if (ReadMipmapsCached(filename, levels, channels, false, 0)) {
+		// allocate GPU texture buffer; copy each level
 		// for multiple textures, see glActiveTexture
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // in case width not multiple of 4
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, pixels);
-		delete [] pixels;
-		glGenerateMipmap(GL_TEXTURE_2D);
+		textureId = UploadMipmaps(levels, channels);
 		// refer sampler uniform to texture 0 (default)
 		GLSL::SetUniform(programId, "textureImage", 0);
 	}
@@ -127,7 +119,8 @@ void Display() {
     glBindBuffer(GL_ARRAY_BUFFER, vBufferId);
 	// update and send matrices to vertex shader
 	mat4 view = Translate(0, 0, -5)*RotateY(rotNew.x)*RotateX(rotNew.y);
-	GLSL::SetUniform(programId, "view", view);
+	GLSL::SetUniform(programId, "view", view*packed.Decode());	// decode packed points
+	GLSL::SetUniform(programId, "normalMatrix", NormalMatrix(view*packed.Decode()));
 	float fov = 15, nearPlane = -.001f, farPlane = -500;
 	float aspect = (float) glutGet(GLUT_WINDOW_WIDTH) / (float) glutGet(GLUT_WINDOW_HEIGHT);
 	mat4 persp = Perspective(fov, aspect, nearPlane, farPlane);
@@ -144,10 +137,7 @@ void Display() {
 	glClear(GL_DEPTH_BUFFER_BIT);
 	glEnable(GL_DEPTH_TEST);
     // establish shader links
-	int sizePts = points.size()*sizeof(vec3);
-	GLSL::VertexAttribPointer(programId, "point", 3, GL_FLOAT, GL_FALSE, 0, (void *) 0);
-	GLSL::VertexAttribPointer(programId, "normal", 3, GL_FLOAT, GL_FALSE, 0, (void *) sizePts);
-	GLSL::VertexAttribPointer(programId, "uv", 2, GL_FLOAT, GL_FALSE, 0, (void *) (2*sizePts));
+	PackedAttributes(programId, packed);
 	// draw triangles
 	glDrawElements(GL_TRIANGLES, 3*triangles.size(), GL_UNSIGNED_INT, &triangles[0]);
     glFlush();
@@ -171,8 +161,8 @@ void main(int argc, char **argv) {
 	programId = GLSL::LinkProgramViaCode(vertexShader, pixelShader);
 	if (!programId)
 		printf("can't link shader program\n");
-	// read Alias/Wavefront "obj" formatted mesh file
-	bool readOk = ReadAsciiObj(objFilename, points, triangles, &normals, &textures, NULL);
+	// read Alias/Wavefront "obj" formatted mesh file (or its binary cache)
+	bool readOk = ReadObjCached(objFilename, points, triangles, &normals, &textures, NULL);
 	if (!readOk)
 		printf("failed to read %s\n", objFilename);
 	if (!programId || !readOk) {
@@ -182,6 +172,7 @@ void main(int argc, char **argv) {
 	int nvrts = points.size(), nnrms = normals.size(), ntxts = textures.size();
 	if (nvrts != nnrms || nvrts != ntxts)
 		printf("error: %i vrts, %i nrms, %i txts\n", nvrts, nnrms, ntxts);
+	OptimizeMesh(points, triangles, &normals, &textures);	// reorder for the vertex cache
 	printf("%i triangles\n", triangles.size());
 	Normalize(points, .8f);
 	// allocate vertex memory in the GPU, link it to the vertex shader
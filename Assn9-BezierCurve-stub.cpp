@@ -5,6 +5,7 @@
 #include "mat.h"
 #include <math.h>
 #include <time.h>
+#include "Transform.h"
 #include "UI.h"
 
 // Bezier class
@@ -42,28 +43,10 @@ public:
 
 	vec3 *PickPoint(int x, int y, mat4 view) {
 		// return pointer to nearest control point, if within 10 pixels of mouse (x,y), else NULL
-		
-		float dist1 = sqrt(ScreenDistSq(x, y, p1, view));
-		float dist2 = sqrt(ScreenDistSq(x, y, p2, view));
-		float dist3 = sqrt(ScreenDistSq(x, y, p3, view));
-		float dist4 = sqrt(ScreenDistSq(x, y, p4, view));
-
-		if (dist1 <= 10 && dist1 <= dist2 && dist1 <= dist3 && dist1 <= dist4) {
-			return &p1;
-		}
-		else if(dist2 <= 10 && dist2 <= dist3 && dist3 <= dist4){
-			return &p2;
-		}
-		else if (dist3 <= 10 && dist3 <= dist4) {
-			return &p3;
-		}
-		else if (dist4 <= 10) {
-			return &p4;
-		}
-		else {
-			return NULL;
-		}
-		
+		vec3 points[] = {p1, p2, p3, p4}, *controls[] = {&p1, &p2, &p3, &p4};
+		PointXform xform(view, glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+		int nearest = xform.Nearest(x, y, points, 4, 100);
+		return nearest < 0? NULL : controls[nearest];
 	}
 };
 
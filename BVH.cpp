@@ -0,0 +1,392 @@
+/* ======================================
+   BVH.cpp - bounding volume hierarchy over mesh triangles
+   Copyright (c) Jules Bloomenthal, Seattle, 2012
+   All rights reserved
+   ====================================== */
+
+#include "BVH.h"
+#include "Parallel.h"
+#include "UI.h"
+#include <algorithm>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_SSE
+#include <emmintrin.h>
+#endif
+
+// Bounds
+
+struct Bounds {
+	vec3 min, max;
+	Bounds() : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX) { }
+	void Grow(const vec3 &p) { Grow(p, p); }
+	void Grow(const Bounds &b) { Grow(b.min, b.max); }
+	void Grow(const vec3 &lo, const vec3 &hi) {
+		min.x = lo.x < min.x? lo.x : min.x; max.x = hi.x > max.x? hi.x : max.x;
+		min.y = lo.y < min.y? lo.y : min.y; max.y = hi.y > max.y? hi.y : max.y;
+		min.z = lo.z < min.z? lo.z : min.z; max.z = hi.z > max.z? hi.z : max.z;
+	}
+	float HalfArea() const {
+		vec3 d(max-min);
+		return d.x < 0? 0 : d.x*d.y+d.y*d.z+d.z*d.x;
+	}
+};
+
+// Build
+
+static const int NBins = 16, MaxSahDepth = 40;	// below which splits halve, so depth stays under 64
+
+struct Prim {
+	Bounds box;
+	int    id;
+	vec3   Center() const { return box.min+box.max; }	// twice the center, as only order matters
+};
+
+struct Bin {
+	Bounds box, centers;
+	int    count;
+	Bin() : count(0) { }
+};
+
+class BVHBuilder {
+public:
+	vector<Prim> prims;							// reordered in place, leaf by leaf
+	int parallelDepth;							// spawn a thread for left subtrees above this depth
+	void Measure(int begin, int end, Bounds &b, Bounds &cb) {
+		b = cb = Bounds();
+		for (int i = begin; i < end; i++) {
+			b.Grow(prims[i].box);
+			cb.Grow(prims[i].Center());
+		}
+	}
+	int Split(int begin, int end, int depth, Bounds &cb, Bounds lr[2], Bounds lrCenters[2]) {
+		// return index partitioning prims[begin, end) by the least cost plane of the binned centers,
+		// one pass for all three axes; set bounds of each side and of their centers
+		int bestAxis = -1, bestBin = 0;
+		float bestCost = FLT_MAX, scale[3];
+		Bin bins[3][NBins];
+		for (int k = 0; k < 3; k++) {
+			float extent = cb.max[k]-cb.min[k];
+			scale[k] = extent > 0? NBins*(1-1e-5f)/extent : 0;
+		}
+		for (int i = begin; i < end && depth < MaxSahDepth; i++) {
+			vec3 c = prims[i].Center();
+			for (int k = 0; k < 3; k++) {
+				int b = (int) ((c[k]-cb.min[k])*scale[k]);
+				Bin &bin = bins[k][b < 0? 0 : b >= NBins? NBins-1 : b];
+				bin.box.Grow(prims[i].box);
+				bin.centers.Grow(c);
+				bin.count++;
+			}
+		}
+		for (int k = 0; k < 3 && depth < MaxSahDepth; k++) {
+			if (scale[k] == 0)
+				continue;
+			// sweep from the right for areas, then from the left for costs
+			float rightCost[NBins];
+			Bounds r;
+			int nRight = 0;
+			for (int b = NBins-1; b > 0; b--) {
+				r.Grow(bins[k][b].box);
+				nRight += bins[k][b].count;
+				rightCost[b] = nRight*r.HalfArea();
+			}
+			Bounds l;
+			int nLeft = 0;
+			for (int b = 0; b < NBins-1; b++) {
+				l.Grow(bins[k][b].box);
+				nLeft += bins[k][b].count;
+				float cost = nLeft*l.HalfArea()+rightCost[b+1];
+				if (nLeft && nLeft < end-begin && cost < bestCost) {
+					bestCost = cost;
+					bestAxis = k;
+					bestBin = b;
+				}
+			}
+		}
+		if (bestAxis < 0) {
+			// centers coincide, or too deep: split in half, by order
+			int mid = (begin+end)/2;
+			Measure(begin, mid, lr[0], lrCenters[0]);
+			Measure(mid, end, lr[1], lrCenters[1]);
+			return mid;
+		}
+		for (int b = 0; b < NBins; b++) {
+			int side = b <= bestBin? 0 : 1;
+			lr[side].Grow(bins[bestAxis][b].box);
+			lrCenters[side].Grow(bins[bestAxis][b].centers);
+		}
+		float lo = cb.min[bestAxis], s = scale[bestAxis];
+		Prim *mid = std::partition(&prims[0]+begin, &prims[0]+end, [&](const Prim &p) {
+			return (int) ((p.Center()[bestAxis]-lo)*s) <= bestBin;
+		});
+		return (int) (mid-&prims[0]);
+	}
+	void Build(int begin, int end, int depth, Bounds &b, Bounds &cb, vector<BVH::Node> &out) {
+		// append the subtree for prims[begin, end), bounded by b with centers bounded by cb, to out;
+		// interior nodes' right child indices are relative to the start of out
+		BVH::Node n;
+		n.min = b.min;
+		n.max = b.max;
+		if (end-begin <= BVH::LeafSize) {
+			n.index = begin;
+			n.count = end-begin;
+			out.push_back(n);
+			return;
+		}
+		Bounds lr[2], lrCenters[2];
+		int mid = Split(begin, end, depth, cb, lr, lrCenters), node = (int) out.size();
+		n.count = 0;
+		out.push_back(n);
+		if (depth < parallelDepth && end-begin > 65536) {
+			// build the left subtree on another thread, then append both
+			vector<BVH::Node> left, right;
+			std::thread t([&]() { Build(begin, mid, depth+1, lr[0], lrCenters[0], left); });
+			Build(mid, end, depth+1, lr[1], lrCenters[1], right);
+			t.join();
+			int leftStart = node+1, rightStart = leftStart+(int) left.size();
+			Append(left, leftStart, out);
+			out[node].index = rightStart;
+			Append(right, rightStart, out);
+		}
+		else {
+			Build(begin, mid, depth+1, lr[0], lrCenters[0], out);
+			out[node].index = (int) out.size();
+			Build(mid, end, depth+1, lr[1], lrCenters[1], out);
+		}
+	}
+	void Append(vector<BVH::Node> &sub, int start, vector<BVH::Node> &out) {
+		for (size_t i = 0; i < sub.size(); i++) {
+			BVH::Node n = sub[i];
+			if (!n.count)
+				n.index += start;
+			out.push_back(n);
+		}
+	}
+};
+
+void BVH::Build(vector<vec3> &pts, vector<int3> &tris, int nThreads) {
+	clock_t start = clock();
+	points = &pts;
+	triangles = &tris;
+	int nTriangles = (int) tris.size();
+	nodes.resize(0);
+	triIds.resize(nTriangles);
+	if (!nTriangles)
+		return;
+	BVHBuilder builder;
+	builder.prims.resize(nTriangles);
+	ParallelFor(nTriangles, [&](int begin, int end) {
+		for (int t = begin; t < end; t++) {
+			Prim &p = builder.prims[t];
+			p.box = Bounds();
+			int *vids = &tris[t].i1;
+			for (int k = 0; k < 3; k++)
+				p.box.Grow(pts[vids[k]]);
+			p.id = t;
+		}
+	}, 65536, nThreads);
+	int n = NumThreads(nThreads);
+	for (builder.parallelDepth = 0; (1 << builder.parallelDepth) < n; builder.parallelDepth++)
+		;
+	Bounds b, cb;
+	builder.Measure(0, nTriangles, b, cb);
+	nodes.reserve(nTriangles);
+	builder.Build(0, nTriangles, 0, b, cb, nodes);
+	for (int i = 0; i < nTriangles; i++)
+		triIds[i] = builder.prims[i].id;
+	float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+	printf("BVH for %i triangles: %i nodes (%.1f triangles/leaf) in %.2f secs\n",
+		nTriangles, (int) nodes.size(), 2.f*nTriangles/(nodes.size()+1), dt);
+}
+
+// Ray Intersection
+
+static inline bool HitBox(const BVH::Node &n, const vec3 &o, const vec3 &inv, float tMax, float &tNear) {
+	// slab test; tNear is where the ray enters the box
+	float t0 = 0, t1 = tMax;
+	for (int k = 0; k < 3; k++) {
+		float a = (n.min[k]-o[k])*inv[k], b = (n.max[k]-o[k])*inv[k];
+		if (a > b) { float tmp = a; a = b; b = tmp; }
+		t0 = a > t0? a : t0;
+		t1 = b < t1? b : t1;
+	}
+	tNear = t0;
+	return t0 <= t1;
+}
+
+#ifdef BVH_SSE
+
+static inline __m128 Cross(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz, __m128 &cy, __m128 &cz) {
+	cy = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+	cz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+	return _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+}
+
+static inline __m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz) {
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+#endif
+
+static bool HitLeaf(BVH &bvh, const BVH::Node &n, const vec3 &o, const vec3 &d, RayHit &hit, float &tMax) {
+	// Moller-Trumbore for the leaf's triangles, four at once if SSE
+	vector<vec3> &pts = *bvh.points;
+	vector<int3> &tris = *bvh.triangles;
+	const int *ids = &bvh.triIds[n.index];
+	bool found = false;
+#ifdef BVH_SSE
+	// gather as structure of arrays, repeating the last triangle to fill four lanes
+	float p1[3][4], e1[3][4], e2[3][4];
+	for (int i = 0; i < 4; i++) {
+		const int3 &t = tris[ids[i < n.count? i : n.count-1]];
+		const vec3 &a = pts[t.i1], &b = pts[t.i2], &c = pts[t.i3];
+		for (int k = 0; k < 3; k++) {
+			p1[k][i] = a[k];
+			e1[k][i] = b[k]-a[k];
+			e2[k][i] = c[k]-a[k];
+		}
+	}
+	__m128 e1x = _mm_loadu_ps(e1[0]), e1y = _mm_loadu_ps(e1[1]), e1z = _mm_loadu_ps(e1[2]);
+	__m128 e2x = _mm_loadu_ps(e2[0]), e2y = _mm_loadu_ps(e2[1]), e2z = _mm_loadu_ps(e2[2]);
+	__m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z), py, pz, qy, qz;
+	__m128 px = Cross(dx, dy, dz, e2x, e2y, e2z, py, pz);
+	__m128 det = Dot(e1x, e1y, e1z, px, py, pz), inv = _mm_div_ps(_mm_set1_ps(1), det);
+	__m128 sx = _mm_sub_ps(_mm_set1_ps(o.x), _mm_loadu_ps(p1[0]));
+	__m128 sy = _mm_sub_ps(_mm_set1_ps(o.y), _mm_loadu_ps(p1[1]));
+	__m128 sz = _mm_sub_ps(_mm_set1_ps(o.z), _mm_loadu_ps(p1[2]));
+	__m128 u = _mm_mul_ps(Dot(sx, sy, sz, px, py, pz), inv);
+	__m128 qx = Cross(sx, sy, sz, e1x, e1y, e1z, qy, qz);
+	__m128 v = _mm_mul_ps(Dot(dx, dy, dz, qx, qy, qz), inv);
+	__m128 t = _mm_mul_ps(Dot(e2x, e2y, e2z, qx, qy, qz), inv);
+	__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1);
+	// det != 0 (nan-free u, v, t) is implied by the comparisons, which fail for nan or infinity
+	__m128 mask = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+	mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, _mm_set1_ps(tMax))));
+	int bits = _mm_movemask_ps(mask);
+	if (bits) {
+		float ts[4], us[4], vs[4];
+		_mm_storeu_ps(ts, t);
+		_mm_storeu_ps(us, u);
+		_mm_storeu_ps(vs, v);
+		for (int i = 0; i < n.count; i++)
+			if ((bits >> i)&1 && ts[i] < tMax) {
+				tMax = hit.t = ts[i];
+				hit.u = us[i];
+				hit.v = vs[i];
+				hit.triangle = ids[i];
+				found = true;
+			}
+	}
+#else
+	for (int i = 0; i < n.count; i++) {
+		const int3 &tri = tris[ids[i]];
+		const vec3 &a = pts[tri.i1];
+		vec3 e1(pts[tri.i2]-a), e2(pts[tri.i3]-a), p = cross(d, e2);
+		float det = dot(e1, p);
+		if (det == 0)
+			continue;
+		float inv = 1/det;
+		vec3 s(o-a), q = cross(s, e1);
+		float u = dot(s, p)*inv, v = dot(d, q)*inv, t = dot(e2, q)*inv;
+		if (u >= 0 && v >= 0 && u+v <= 1 && t > 0 && t < tMax) {
+			tMax = hit.t = t;
+			hit.u = u;
+			hit.v = v;
+			hit.triangle = ids[i];
+			found = true;
+		}
+	}
+#endif
+	return found;
+}
+
+bool BVH::Intersect(vec3 origin, vec3 dir, RayHit &hit, float tMax) {
+	hit.triangle = -1;
+	float tNear;
+	vec3 inv(1/dir.x, 1/dir.y, 1/dir.z);
+	if (nodes.empty() || !HitBox(nodes[0], origin, inv, tMax, tNear))
+		return false;
+	int stack[64], nStack = 0;
+	float stackNear[64];
+	for (int node = 0;;) {
+		const Node &n = nodes[node];
+		if (n.count)
+			HitLeaf(*this, n, origin, dir, hit, tMax);
+		else {
+			// visit the nearer child first, return for the other if still closer than the best hit
+			int a = node+1, b = n.index;
+			float ta, tb;
+			bool hitA = HitBox(nodes[a], origin, inv, tMax, ta), hitB = HitBox(nodes[b], origin, inv, tMax, tb);
+			if (hitA && hitB) {
+				if (tb < ta) {
+					std::swap(a, b);
+					std::swap(ta, tb);
+				}
+				stack[nStack] = b;
+				stackNear[nStack++] = tb;
+				node = a;
+				continue;
+			}
+			if (hitA || hitB) {
+				node = hitA? a : b;
+				continue;
+			}
+		}
+		// pop, skipping nodes entered beyond the nearest hit so far
+		while (nStack && stackNear[nStack-1] > tMax)
+			nStack--;
+		if (!nStack)
+			break;
+		node = stack[--nStack];
+	}
+	if (hit.triangle < 0)
+		return false;
+	int3 &t = (*triangles)[hit.triangle];
+	vector<vec3> &p = *points;
+	hit.point = (1-hit.u-hit.v)*p[t.i1]+hit.u*p[t.i2]+hit.v*p[t.i3];
+	return true;
+}
+
+// Box Query
+
+int BVH::Query(vec3 min, vec3 max, vector<int> &result) {
+	result.resize(0);
+	if (nodes.empty())
+		return 0;
+	int stack[64], nStack = 0;
+	stack[nStack++] = 0;
+	while (nStack) {
+		const Node &n = nodes[stack[--nStack]];
+		if (n.min.x > max.x || n.min.y > max.y || n.min.z > max.z ||
+			n.max.x < min.x || n.max.y < min.y || n.max.z < min.z)
+			continue;
+		if (!n.count) {
+			stack[nStack++] = n.index;
+			stack[nStack++] = (int) (&n-&nodes[0])+1;
+			continue;
+		}
+		for (int i = 0; i < n.count; i++) {
+			int id = triIds[n.index+i];
+			int *vids = &(*triangles)[id].i1;
+			Bounds b;
+			for (int k = 0; k < 3; k++)
+				b.Grow((*points)[vids[k]]);
+			if (b.min.x <= max.x && b.min.y <= max.y && b.min.z <= max.z &&
+				b.max.x >= min.x && b.max.y >= min.y && b.max.z >= min.z)
+				result.push_back(id);
+		}
+	}
+	return (int) result.size();
+}
+
+// Picking
+
+bool PickTriangle(BVH &bvh, int x, int y, mat4 &modelview, mat4 &persp, RayHit &hit) {
+	vec3 p1, p2;
+	ScreenLine((float) x, (float) y, modelview, persp, (float *) &p1, (float *) &p2);
+	return bvh.Intersect(p1, p2-p1, hit);
+}
@@ -0,0 +1,52 @@
+/*	==============================
+    BVH.h - bounding volume hierarchy over mesh triangles, for ray picking and box queries
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef BVH_HDR
+#define BVH_HDR
+
+#include <float.h>
+#include <vector>
+#include "mat.h"
+
+using std::vector;
+
+struct RayHit {
+	int   triangle;							// index into triangles, -1 if none
+	float t;								// hit point = origin+t*dir
+	float u, v;								// and = (1-u-v)*p1+u*p2+v*p3 of the triangle
+	vec3  point;
+	RayHit() : triangle(-1), t(0), u(0), v(0), point(0, 0, 0) { }
+};
+
+class BVH {
+public:
+	struct Node {
+		vec3 min;
+		int  index;							// leaf: first of its triIds; interior: right child (left is next node)
+		vec3 max;
+		int  count;							// leaf: # triangles (1 to LeafSize); interior: 0
+	};
+	static const int LeafSize = 4;			// one pass of the SIMD ray-triangle test
+	vector<Node> nodes;						// depth first, root first
+	vector<int> triIds;						// triangle indices, leaf by leaf
+	vector<vec3> *points;					// the mesh, set by Build, which must outlive the BVH
+	vector<int3> *triangles;
+	BVH() : points(NULL), triangles(NULL) { }
+	void Build(vector<vec3> &points, vector<int3> &triangles, int nThreads = 1);
+		// binned surface area heuristic; subtrees are built on up to nThreads threads (0 for
+		// one per hardware thread); the tree doesn't depend on nThreads; print time and size
+	bool Intersect(vec3 origin, vec3 dir, RayHit &hit, float tMax = FLT_MAX);
+		// find the nearest triangle hit by the ray at 0 < t < tMax; either side of a triangle counts
+	int Query(vec3 min, vec3 max, vector<int> &result);
+		// set result to the triangles whose bounds overlap the box min/max; return # triangles
+};
+
+bool PickTriangle(BVH &bvh, int x, int y, mat4 &modelview, mat4 &persp, RayHit &hit);
+	// intersect the line (from ScreenLine) through pixel (x, y) (y increasing upward) with the mesh,
+	// which is transformed by modelview; hit.point is in the mesh's (untransformed) space
+	// ScreenLine is from UI or Draw, whichever the application links
+
+#endif
@@ -0,0 +1,104 @@
+// Bench-BVH.cpp: BVH build time and ray (pick) rate on a large mesh, against a test of every triangle
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include "BVH.h"
+#include "MeshIO.h"
+
+void Grid(int res, vector<vec3> &points, vector<int3> &triangles) {
+	// res*res points on a bumpy sheet, two triangles per cell
+	points.resize(res*res);
+	triangles.resize(0);
+	for (int j = 0; j < res; j++)
+		for (int i = 0; i < res; i++) {
+			float u = (float) i/(res-1), v = (float) j/(res-1);
+			points[j*res+i] = vec3(2*u-1, 2*v-1, .05f*sin(20*u)*cos(17*v));
+		}
+	for (int j = 0; j < res-1; j++)
+		for (int i = 0; i < res-1; i++) {
+			int a = j*res+i, b = a+1, c = a+res, d = c+1;
+			triangles.push_back(int3(a, b, d));
+			triangles.push_back(int3(a, d, c));
+		}
+}
+
+float Random(float min, float max) { return min+(max-min)*rand()/RAND_MAX; }
+
+bool TestAll(vector<vec3> &points, vector<int3> &triangles, vec3 origin, vec3 dir, RayHit &hit) {
+	// nearest hit by Moller-Trumbore on every triangle, as picking did without the BVH
+	hit.triangle = -1;
+	hit.t = FLT_MAX;
+	for (size_t i = 0; i < triangles.size(); i++) {
+		vec3 &p1 = points[triangles[i].i1], e1 = points[triangles[i].i2]-p1, e2 = points[triangles[i].i3]-p1;
+		vec3 p = cross(dir, e2), s = origin-p1, q = cross(s, e1);
+		float det = dot(e1, p);
+		if (det == 0)
+			continue;
+		float f = 1/det, u = f*dot(s, p), v = f*dot(dir, q), t = f*dot(e2, q);
+		if (u >= 0 && v >= 0 && u+v <= 1 && t > 0 && t < hit.t) {
+			hit.triangle = (int) i;
+			hit.t = t;
+		}
+	}
+	return hit.triangle >= 0;
+}
+
+double Now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+	// Bench-BVH [file.obj | grid resolution] [# threads to build]; resolution 2237 gives 10M triangles
+	vector<vec3> points;
+	vector<int3> triangles;
+	int res = argc > 1? atoi(argv[1]) : 1000, nThreads = argc > 2? atoi(argv[2]) : 1;
+	if (argc > 1 && res < 2) {
+		if (!ReadAsciiObj(argv[1], points, triangles)) {
+			printf("can't read %s\n", argv[1]);
+			return 1;
+		}
+	}
+	else
+		Grid(res, points, triangles);
+	Normalize(points, .8f);
+	BVH bvh;
+	double start = Now();
+	bvh.Build(points, triangles, nThreads);
+	printf("%i triangles, built in %.2f secs\n", (int) triangles.size(), Now()-start);
+	// rays from a sphere about the mesh toward points near it, as picks from all around
+	const int nRays = 1000000;
+	vector<vec3> origins(nRays), dirs(nRays);
+	srand(1);
+	for (int i = 0; i < nRays; i++) {
+		origins[i] = 3*normalize(vec3(Random(-1, 1), Random(-1, 1), Random(-1, 1)));
+		dirs[i] = vec3(Random(-.5f, .5f), Random(-.5f, .5f), Random(-.1f, .1f))-origins[i];
+	}
+	RayHit hit;
+	int nHits = 0;
+	double worst = 0;
+	start = Now();
+	for (int i = 0; i < nRays; i++)
+		nHits += bvh.Intersect(origins[i], dirs[i], hit);
+	double dt = Now()-start;
+	for (int i = 0; i < 10000; i++) {
+		double t = Now();
+		bvh.Intersect(origins[i], dirs[i], hit);
+		t = Now()-t;
+		worst = t > worst? t : worst;
+	}
+	printf("BVH:       %i rays, %i hits, %.2f Mrays/s, %.2f us per pick (worst of 10000 %.1f us)\n",
+		nRays, nHits, nRays/dt/1e6, 1e6*dt/nRays, 1e6*worst);
+	// every triangle, on a few rays; nearest hits should agree
+	int nCheck = triangles.size() > 2000000? 10 : 100, nDiffer = 0;
+	start = Now();
+	for (int i = 0; i < nCheck; i++) {
+		RayHit a, b;
+		bool ha = bvh.Intersect(origins[i], dirs[i], a), hb = TestAll(points, triangles, origins[i], dirs[i], b);
+		nDiffer += ha != hb || (ha && fabs(a.t-b.t) > 1e-6f*b.t);
+	}
+	dt = Now()-start;
+	printf("all tris:  %i rays, %.1f ms per pick, %i differ from BVH\n", nCheck, 1e3*dt/nCheck, nDiffer);
+	return nDiffer? 1 : 0;
+}
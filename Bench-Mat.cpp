@@ -0,0 +1,244 @@
+// Bench-Mat.cpp: mat4 products, transpose, dot(vec4), inverses and NormalMatrix against the scalar
+// code they replaced
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "mat.h"
+
+using std::vector;
+
+// Scalar versions (as in mat.h without SSE)
+
+mat4 ScalarProduct(const mat4 &m, const mat4 &n) {
+	mat4 a(0.0);
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++) {
+			GLfloat sum = 0;
+			for (int k = 0; k < 4; k++)
+				sum += m[i][k]*n[k][j];
+			a[i][j] = sum;
+		}
+	return a;
+}
+
+vec4 ScalarProduct(const mat4 &m, const vec4 &v) {
+	return vec4(m[0][0]*v.x+m[0][1]*v.y+m[0][2]*v.z+m[0][3]*v.w,
+				m[1][0]*v.x+m[1][1]*v.y+m[1][2]*v.z+m[1][3]*v.w,
+				m[2][0]*v.x+m[2][1]*v.y+m[2][2]*v.z+m[2][3]*v.w,
+				m[3][0]*v.x+m[3][1]*v.y+m[3][2]*v.z+m[3][3]*v.w);
+}
+
+mat4 ScalarTranspose(const mat4 &m) {
+	return mat4(vec4(m[0][0], m[1][0], m[2][0], m[3][0]), vec4(m[0][1], m[1][1], m[2][1], m[3][1]),
+				vec4(m[0][2], m[1][2], m[2][2], m[3][2]), vec4(m[0][3], m[1][3], m[2][3], m[3][3]));
+}
+
+float ScalarDot(const vec4 &u, const vec4 &v) { return u.x*v.x+u.y*v.y+u.z*v.z+u.w*v.w; }
+
+mat4 ScalarInverse(const mat4 &A) {
+	const vec4 &a = A[0], &b = A[1], &c = A[2], &d = A[3];
+	GLfloat s0 = a.x*b.y-b.x*a.y, s1 = a.x*b.z-b.x*a.z, s2 = a.x*b.w-b.x*a.w;
+	GLfloat s3 = a.y*b.z-b.y*a.z, s4 = a.y*b.w-b.y*a.w, s5 = a.z*b.w-b.z*a.w;
+	GLfloat c5 = c.z*d.w-d.z*c.w, c4 = c.y*d.w-d.y*c.w, c3 = c.y*d.z-d.y*c.z;
+	GLfloat c2 = c.x*d.w-d.x*c.w, c1 = c.x*d.z-d.x*c.z, c0 = c.x*d.y-d.x*c.y;
+	GLfloat r = 1/(s0*c5-s1*c4+s2*c3+s3*c2-s4*c1+s5*c0);
+	return mat4(vec4( b.y*c5-b.z*c4+b.w*c3, -a.y*c5+a.z*c4-a.w*c3,  d.y*s5-d.z*s4+d.w*s3, -c.y*s5+c.z*s4-c.w*s3)*r,
+				vec4(-b.x*c5+b.z*c2-b.w*c1,  a.x*c5-a.z*c2+a.w*c1, -d.x*s5+d.z*s2-d.w*s1,  c.x*s5-c.z*s2+c.w*s1)*r,
+				vec4( b.x*c4-b.y*c2+b.w*c0, -a.x*c4+a.y*c2-a.w*c0,  d.x*s4-d.y*s2+d.w*s0, -c.x*s4+c.y*s2-c.w*s0)*r,
+				vec4(-b.x*c3+b.y*c1-b.z*c0,  a.x*c3-a.y*c1+a.z*c0, -d.x*s3+d.y*s1-d.z*s0,  c.x*s3-c.y*s1+c.z*s0)*r);
+}
+
+mat4 ScalarAffineInverse(const mat4 &A) {
+	vec3 r0(A[0].x, A[0].y, A[0].z), r1(A[1].x, A[1].y, A[1].z), r2(A[2].x, A[2].y, A[2].z);
+	vec3 c0 = cross(r1, r2), c1 = cross(r2, r0), c2 = cross(r0, r1), t(A[0].w, A[1].w, A[2].w);
+	GLfloat r = 1/dot(r0, c0);
+	c0 *= r; c1 *= r; c2 *= r;
+	vec3 it = -(c0*t.x+c1*t.y+c2*t.z);
+	return mat4(vec4(c0.x, c1.x, c2.x, it.x), vec4(c0.y, c1.y, c2.y, it.y), vec4(c0.z, c1.z, c2.z, it.z), vec4(0, 0, 0, 1));
+}
+
+mat4 ScalarRigidInverse(const mat4 &A) {
+	vec3 r0(A[0].x, A[0].y, A[0].z), r1(A[1].x, A[1].y, A[1].z), r2(A[2].x, A[2].y, A[2].z);
+	vec3 it = -(r0*A[0].w+r1*A[1].w+r2*A[2].w);
+	return mat4(vec4(r0.x, r1.x, r2.x, it.x), vec4(r0.y, r1.y, r2.y, it.y), vec4(r0.z, r1.z, r2.z, it.z), vec4(0, 0, 0, 1));
+}
+
+mat3 ScalarNormalMatrix(const mat4 &A) {
+	vec3 r0(A[0].x, A[0].y, A[0].z), r1(A[1].x, A[1].y, A[1].z), r2(A[2].x, A[2].y, A[2].z);
+	vec3 c0 = cross(r1, r2), c1 = cross(r2, r0), c2 = cross(r0, r1);
+	GLfloat r = 1/dot(r0, c0);
+	return mat3(c0*r, c1*r, c2*r);
+}
+
+// Test data
+
+float Random() { return 2*(float) rand()/RAND_MAX-1; }
+
+mat4 RandomMatrix() {
+	mat4 m;
+	for (int i = 0; i < 4; i++)
+		m[i] = vec4(Random(), Random(), Random(), Random());
+	return m;
+}
+
+mat4 RandomRigid() {
+	return Translate(5*Random(), 5*Random(), 5*Random())*RotateZ(180*Random())*RotateY(180*Random())*RotateX(180*Random());
+}
+
+float Diff(const vec3 &a, const vec3 &b) {
+	return fmaxf(fmaxf(fabsf(a.x-b.x), fabsf(a.y-b.y)), fabsf(a.z-b.z));
+}
+
+float Diff(const mat3 &a, const mat3 &b) {
+	return fmaxf(fmaxf(Diff(a[0], b[0]), Diff(a[1], b[1])), Diff(a[2], b[2]));
+}
+
+float Diff(const vec4 &a, const vec4 &b) {
+	return fmaxf(fmaxf(fabsf(a.x-b.x), fabsf(a.y-b.y)), fmaxf(fabsf(a.z-b.z), fabsf(a.w-b.w)));
+}
+
+float Diff(const mat4 &a, const mat4 &b) {
+	return fmaxf(fmaxf(Diff(a[0], b[0]), Diff(a[1], b[1])), fmaxf(Diff(a[2], b[2]), Diff(a[3], b[3])));
+}
+
+// Timing
+
+float Seconds(std::function<void()> f, int nTimes = 3) {
+	float best = -1;
+	for (int i = 0; i < nTimes; i++) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		float dt = std::chrono::duration<float>(std::chrono::steady_clock::now()-start).count();
+		best = best < 0 || dt < best? dt : best;
+	}
+	return best;
+}
+
+void Report(const char *name, float tScalar, float t, int nOps, float diff) {
+	printf("  %-10s scalar %6.2f ns  mat.h %6.2f ns  (%.1fx)  max difference %g\n",
+		name, 1e9f*tScalar/nOps, 1e9f*t/nOps, tScalar/t, diff);
+}
+
+template<class Scalar, class Lib> void TimeInverse(const char *name, vector<mat4> &in, vector<mat4> &c, vector<mat4> &d,
+												   int nReps, Scalar scalar, Lib lib) {
+	// as the loops in main, with the inverses inlined
+	int n = (int) in.size();
+	float tScalar = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				c[i] = scalar(in[(i+r)&(n-1)]);
+	});
+	float t = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				d[i] = lib(in[(i+r)&(n-1)]);
+	});
+	float diff = 0;
+	for (int i = 0; i < n; i++)
+		diff = fmaxf(diff, Diff(c[i], d[i]));
+	Report(name, tScalar, t, n*nReps, diff);
+}
+
+int main(int argc, char **argv) {
+	// Bench-Mat [millions of operations]; operands are 1024 random matrices and vectors,
+	// so they stay in cache and the arithmetic is timed
+	const int n = 1024;
+	int nReps = (int) ((argc > 1? atof(argv[1]) : 20)*1e6/n), nOps = n*nReps;
+	vector<mat4> a(n), b(n), c(n), d(n), g(n), affine(n), rigid(n);
+	vector<mat3> m(n), m2(n);
+	vector<vec4> u(n), v(n), w(n), x(n);
+	srand(1);
+	for (int i = 0; i < n; i++) {
+		a[i] = RandomMatrix();
+		b[i] = RandomMatrix();
+		u[i] = vec4(Random(), Random(), Random(), Random());
+		g[i] = a[i]+mat4(5);					// well conditioned (as Test-MatInverse)
+		rigid[i] = RandomRigid();
+		affine[i] = rigid[i]*Scale(1.5f+.4f*Random(), 1+.9f*Random(), 2+Random());
+	}
+	float diff = 0, tScalar, t;
+	printf("%.0fM of each operation, %s\n", nOps/1e6f,
+#ifdef VEC_SSE
+		"mat.h with SSE");
+#else
+		"mat.h scalar (VEC_NO_SIMD)");
+#endif
+	tScalar = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				c[i] = ScalarProduct(a[i], b[(i+r)&(n-1)]);
+	});
+	t = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				d[i] = a[i]*b[(i+r)&(n-1)];
+	});
+	for (int i = 0; i < n; i++)
+		diff = fmaxf(diff, Diff(c[i], d[i]));
+	Report("mat4*mat4", tScalar, t, nOps, diff);
+	tScalar = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				v[i] = ScalarProduct(a[(i+r)&(n-1)], u[i]);
+	});
+	t = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				w[i] = a[(i+r)&(n-1)]*u[i];
+	});
+	diff = 0;
+	for (int i = 0; i < n; i++)
+		diff = fmaxf(diff, Diff(v[i], w[i]));
+	Report("mat4*vec4", tScalar, t, nOps, diff);
+	tScalar = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				c[i] = ScalarTranspose(a[(i+r)&(n-1)]);
+	});
+	t = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				d[i] = transpose(a[(i+r)&(n-1)]);
+	});
+	diff = 0;
+	for (int i = 0; i < n; i++)
+		diff = fmaxf(diff, Diff(c[i], d[i]));
+	Report("transpose", tScalar, t, nOps, diff);
+	float dot1 = 0, dot2 = 0;
+	tScalar = Seconds([&]() {
+		dot1 = 0;
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				dot1 += ScalarDot(u[i], w[(i+r)&(n-1)]);
+	});
+	t = Seconds([&]() {
+		dot2 = 0;
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				dot2 += dot(u[i], w[(i+r)&(n-1)]);
+	});
+	Report("dot(vec4)", tScalar, t, nOps, fabsf(dot1-dot2)/fmaxf(1, fabsf(dot1)));
+	// inverses, each of the kind of matrix it's for
+	TimeInverse("inverse", g, c, d, nReps, [](const mat4 &A) { return ScalarInverse(A); }, [](const mat4 &A) { return inverse(A); });
+	TimeInverse("affineInv", affine, c, d, nReps, [](const mat4 &A) { return ScalarAffineInverse(A); }, [](const mat4 &A) { return affineInverse(A); });
+	TimeInverse("rigidInv", rigid, c, d, nReps, [](const mat4 &A) { return ScalarRigidInverse(A); }, [](const mat4 &A) { return rigidInverse(A); });
+	tScalar = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				m[i] = ScalarNormalMatrix(affine[(i+r)&(n-1)]);
+	});
+	t = Seconds([&]() {
+		for (int r = 0; r < nReps; r++)
+			for (int i = 0; i < n; i++)
+				m2[i] = NormalMatrix(affine[(i+r)&(n-1)]);
+	});
+	diff = 0;
+	for (int i = 0; i < n; i++)
+		diff = fmaxf(diff, Diff(m[i], m2[i]));
+	Report("NormalMat", tScalar, t, nOps, diff);
+	return 0;
+}
@@ -0,0 +1,99 @@
+// Bench-Normalize.cpp: MinMax and Normalize on large point clouds, against per-component scalar loops
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include "MeshIO.h"
+
+// Scalar loops (as MinMax and Normalize were)
+
+template<class F> void ScalarMinMax(int n, F point, vec3 &min, vec3 &max) {
+	min = vec3(FLT_MAX);
+	max = vec3(-FLT_MAX);
+	for (int i = 0; i < n; i++) {
+		vec3 &v = point(i);
+		for (int k = 0; k < 3; k++) {
+			if (v[k] < min[k]) min[k] = v[k];
+			if (v[k] > max[k]) max[k] = v[k];
+		}
+	}
+}
+
+template<class F> void ScalarNormalize(int n, F point, float scale) {
+	vec3 min, max;
+	ScalarMinMax(n, point, min, max);
+	vec3 center = .5f*(min+max);
+	float maxrange = 0;
+	for (int k = 0; k < 3; k++)
+		if ((max[k]-min[k]) > maxrange)
+			maxrange = max[k]-min[k];
+	float s = scale*2.f/maxrange;
+	for (int i = 0; i < n; i++) {
+		vec3 &v = point(i);
+		v = s*(v-center);
+	}
+}
+
+bool Same(const vec3 &a, const vec3 &b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+// Timing
+
+float Seconds(std::function<void()> f, int nTimes = 3) {
+	float best = -1;
+	for (int i = 0; i < nTimes; i++) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		float dt = std::chrono::duration<float>(std::chrono::steady_clock::now()-start).count();
+		best = best < 0 || dt < best? dt : best;
+	}
+	return best;
+}
+
+template<class T, class F> void Bench(const char *name, vector<T> &points, F point) {
+	// time MinMax and Normalize, scalar and with 1, 2 and 4 threads; check the results agree
+	int n = (int) points.size();
+	float mpts = n/1e6f;
+	vector<T> copy(points), scalar(points);
+	vec3 min, max, smin, smax;
+	float tMinMax = Seconds([&]() { ScalarMinMax(n, [&](int i) -> vec3 & { return point(points, i); }, smin, smax); });
+	float tNormalize = Seconds([&]() {
+		scalar = copy;
+		ScalarNormalize(n, [&](int i) -> vec3 & { return point(scalar, i); }, 1);
+	}, 1);
+	float tCopy = Seconds([&]() { points = copy; }, 1);
+	printf("%s, %.0fM points\n", name, mpts);
+	printf("  scalar     MinMax %7.1f Mpts/s   Normalize %7.1f Mpts/s\n", mpts/tMinMax, mpts/(tNormalize-tCopy));
+	for (int nThreads = 1; nThreads <= 4; nThreads *= 2) {
+		float t1 = Seconds([&]() { MinMax(copy, min, max, nThreads); });
+		bool same = Same(min, smin) && Same(max, smax);
+		float t2 = Seconds([&]() {
+			points = copy;
+			Normalize(points, 1, nThreads);
+		}, 1);
+		for (int i = 0; i < n && same; i++)
+			same = Same(point(points, i), point(scalar, i));
+		printf("  %i thread%s  MinMax %7.1f Mpts/s (%.1fx) Normalize %7.1f Mpts/s (%.1fx)%s\n", nThreads, nThreads > 1? "s" : " ",
+			mpts/t1, tMinMax/t1, mpts/(t2-tCopy), (tNormalize-tCopy)/(t2-tCopy), same? "" : " (results differ!)");
+	}
+}
+
+int main(int argc, char **argv) {
+	// Bench-Normalize [millions of points]; half as many VertexSTL, which are twice the size;
+	// Normalize times exclude restoring the points
+	int n = (int) (1e6f*(argc > 1? (float) atof(argv[1]) : 50));
+	srand(1);
+	{
+		vector<vec3> points(n);
+		for (int i = 0; i < n; i++)
+			points[i] = vec3((float) rand()/RAND_MAX, (float) rand()/RAND_MAX, (float) rand()/RAND_MAX)*vec3(7, -3, 2);
+		Bench("vec3", points, [](vector<vec3> &p, int i) -> vec3 & { return p[i]; });
+	}
+	{
+		vector<VertexSTL> vertices(n/2);
+		for (int i = 0; i < n/2; i++)
+			vertices[i].point = vec3((float) rand()/RAND_MAX, (float) rand()/RAND_MAX, (float) rand()/RAND_MAX)*vec3(7, -3, 2);
+		Bench("VertexSTL", vertices, [](vector<VertexSTL> &p, int i) -> vec3 & { return p[i].point; });
+	}
+	return 0;
+}
@@ -0,0 +1,199 @@
+// Bench-ReadObj.cpp: ReadAsciiObj throughput in MB/s, against the fgets/sscanf reader it replaced,
+// and its scaling with threads (each read must give the one-thread mesh exactly)
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include "MeshIO.h"
+#include "Parallel.h"
+
+// Previous reader
+
+struct Compare {
+	bool operator() (const int3 &a, const int3 &b) const {
+		return (a.i1==b.i1? (a.i2==b.i2? a.i3 < b.i3 : a.i2 < b.i2) : a.i1 < b.i1);
+	}
+};
+
+static bool ReadWord(char *&ptr, char *word, int charLimit) {
+	ptr += strspn(ptr, " \t");					// skip white space
+	int nChars = (int) strcspn(ptr, " \t");		// get # non-white-space characters
+	if (!nChars)
+		return false;
+	int nRead = charLimit-1 < nChars? charLimit-1 : nChars;
+	strncpy(word, ptr, nRead);
+	word[nRead] = 0;
+	ptr += nChars;
+	return true;
+}
+
+bool ReadLines(char *filename, vector<vec3> &points, vector<int3> &triangles, vector<vec3> *normals, vector<vec2> *textures) {
+	// the per-line loop of ReadAsciiObj before the file was mapped: fgets, ReadWord, sscanf, atoi,
+	// and a std::map from vid/tid/nid to vertex (groups and winding checks omitted)
+	FILE *in = fopen(filename, "r");
+	if (!in)
+		return false;
+	char line[1000], word[100];
+	vec2 t;
+	vec3 v;
+	vector<vec3> tmpVertices, tmpNormals;
+	vector<vec2> tmpTextures;
+	vector<int> vids;
+	std::map<int3, int, Compare> vidMap;
+	while (fgets(line, 1000, in)) {
+		char *ptr = line;
+		if (!ReadWord(ptr, word, 100) || *word == '#')
+			continue;
+		if (!_stricmp(word, "v") && sscanf(ptr, "%g%g%g", &v.x, &v.y, &v.z) == 3)
+			tmpVertices.push_back(v);
+		if (!_stricmp(word, "vn") && sscanf(ptr, "%g%g%g", &v.x, &v.y, &v.z) == 3)
+			tmpNormals.push_back(v);
+		if (!_stricmp(word, "vt") && sscanf(ptr, "%g%g", &t.x, &t.y) == 2)
+			tmpTextures.push_back(t);
+		if (!_stricmp(word, "f")) {
+			vids.resize(0);
+			while (ReadWord(ptr, word, 100)) {
+				char *tPtr = strchr(word+1, '/'), *nPtr = tPtr? strchr(tPtr+1, '/') : NULL;
+				int vid = atoi(word);
+				if (!vid)
+					break;
+				int tid = tPtr && *++tPtr != '/'? atoi(tPtr) : vid;
+				int nid = nPtr && *++nPtr != 0? atoi(nPtr) : vid;
+				int3 key(vid-1, tid-1, nid-1);
+				std::map<int3, int, Compare>::iterator it = vidMap.find(key);
+				if (it != vidMap.end()) {
+					vids.push_back(it->second);
+					continue;
+				}
+				int id = (int) points.size();
+				vidMap[key] = id;
+				points.push_back(tmpVertices[vid-1]);
+				if (normals && (int) tmpNormals.size() >= nid)
+					normals->push_back(tmpNormals[nid-1]);
+				if (textures && (int) tmpTextures.size() >= tid)
+					textures->push_back(tmpTextures[tid-1]);
+				vids.push_back(id);
+			}
+			for (int i = 1; i < (int) vids.size()-1; i++)
+				triangles.push_back(int3(vids[0], vids[i], vids[i+1]));
+		}
+	}
+	fclose(in);
+	return true;
+}
+
+// Test files
+
+long long WriteGrid(const char *filename, int res, bool shareCorners = true) {
+	// res*res points with normals on a bumpy sheet, two triangles per cell; if shareCorners, each
+	// point has one uv and the six or so corners at it are one vertex, else each corner has a uv
+	// of its own, so no two corners are alike; return file size
+	FILE *out = fopen(filename, "w");
+	if (!out)
+		return 0;
+	for (int j = 0; j < res; j++)
+		for (int i = 0; i < res; i++) {
+			float u = (float) i/(res-1), v = (float) j/(res-1), z = .05f*sin(20*u)*cos(17*v);
+			fprintf(out, "v %g %g %g\nvn %g %g %g\n", 2*u-1, 2*v-1, z, -z, z, 1.f);
+			if (shareCorners)
+				fprintf(out, "vt %g %g\n", u, v);
+		}
+	for (int j = 0, tid = 1; j < res-1; j++)
+		for (int i = 0; i < res-1; i++) {
+			int a = j*res+i+1, b = a+1, c = a+res, d = c+1, tri[2][3] = {{a, b, d}, {a, d, c}};
+			for (int t = 0; t < 2; t++) {
+				int *p = tri[t], tids[3] = {p[0], p[1], p[2]};
+				if (!shareCorners)
+					for (int k = 0; k < 3; k++) {
+						fprintf(out, "vt %g %g\n", (float) ((p[k]-1)%res)/(res-1), (float) ((p[k]-1)/res)/(res-1));
+						tids[k] = tid++;
+					}
+				fprintf(out, "f %i/%i/%i %i/%i/%i %i/%i/%i\n", p[0], tids[0], p[0], p[1], tids[1], p[1], p[2], tids[2], p[2]);
+			}
+		}
+	long long size = ftell(out);
+	fclose(out);
+	return size;
+}
+
+// Timing
+
+float Seconds(std::function<bool()> read, int nTimes = 3) {
+	// best of nTimes, negative if read fails
+	float best = -1;
+	for (int i = 0; i < nTimes; i++) {
+		auto start = std::chrono::steady_clock::now();
+		if (!read())
+			return -1;
+		float dt = std::chrono::duration<float>(std::chrono::steady_clock::now()-start).count();
+		best = best < 0 || dt < best? dt : best;
+	}
+	return best;
+}
+
+template<class T> bool Same(vector<T> &a, vector<T> &b) {
+	return a.size() == b.size() && (a.empty() || !memcmp(&a[0], &b[0], a.size()*sizeof(T)));
+}
+
+void Bench(char *filename, long long size) {
+	float mb = (float) size/(1 << 20);
+	vector<vec3> points, normals;
+	vector<vec2> uvs;
+	vector<int3> triangles;
+	auto Clear = [&]() { points.resize(0); normals.resize(0); uvs.resize(0); triangles.resize(0); };
+	float tLines = Seconds([&]() { Clear(); return ReadLines(filename, points, triangles, &normals, &uvs); }, 1);
+	int nPoints = (int) points.size(), nTriangles = (int) triangles.size();
+	printf("%s: %.1f MB, %i points, %i triangles, %.1f corners per point\n", filename, mb, nPoints, nTriangles,
+		nPoints? 3.f*nTriangles/nPoints : 0.f);
+	printf("  fgets/sscanf/map        %6.3f secs %7.1f MB/s\n", tLines, mb/tLines);
+	// one thread, then doubling to the hardware's threads, or at least four
+	vector<vec3> points1, normals1;
+	vector<vec2> uvs1;
+	vector<int3> triangles1;
+	vector<int> groups, groups1;
+	float t1 = 0;
+	for (int nThreads = 1, maxThreads = NumThreads(0) > 4? NumThreads(0) : 4; nThreads <= maxThreads; nThreads *= 2) {
+		float t = Seconds([&]() {
+			Clear();
+			groups.resize(0);
+			return ReadAsciiObj(filename, points, triangles, &normals, &uvs, &groups, nThreads);
+		});
+		if (nThreads == 1) {
+			t1 = t;
+			points1 = points; normals1 = normals; uvs1 = uvs; triangles1 = triangles; groups1 = groups;
+		}
+		bool same = (int) points.size() == nPoints && (int) triangles.size() == nTriangles &&
+			Same(points, points1) && Same(normals, normals1) && Same(uvs, uvs1) && Same(triangles, triangles1) && Same(groups, groups1);
+		printf("  ReadAsciiObj, %2i thread%s %6.3f secs %7.1f MB/s (%.1fx, %.1fx one thread)%s\n", nThreads, nThreads > 1? "s" : " ",
+			t, mb/t, tLines/t, t1/t, same? "" : " (different mesh!)");
+	}
+}
+
+int main(int argc, char **argv) {
+	// Bench-ReadObj [file.obj | grid resolution]
+	// a generated grid is read twice: with corners shared, as most meshes, and with none shared
+	int res = argc > 1? atoi(argv[1]) : 1000;
+	if (argc > 1 && res < 2) {
+		long long size = 0, time;
+		if (!SourceKey(argv[1], size, time)) {
+			printf("can't open %s\n", argv[1]);
+			return 1;
+		}
+		Bench(argv[1], size);
+		return 0;
+	}
+	char *filename = (char *) "Bench-ReadObj.obj";
+	for (int share = 1; share >= 0; share--) {
+		long long size = WriteGrid(filename, res, share == 1);
+		if (!size) {
+			printf("can't write %s\n", filename);
+			return 1;
+		}
+		printf("%s corners\n", share? "shared" : "unique");
+		Bench(filename, size);
+		remove(filename);
+	}
+	return 0;
+}
@@ -0,0 +1,139 @@
+// Bench-ReadPly.cpp: ReadPly against ReadAsciiObj on the same mesh, binary and ascii PLY
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include "MeshIO.h"
+
+// Test files
+
+void Grid(int res, vector<vec3> &points, vector<vec3> &normals, vector<vec2> &uvs, vector<int3> &triangles) {
+	// res*res points with normals and uvs on a bumpy sheet, two triangles per cell
+	points.resize(res*res);
+	normals.resize(res*res);
+	uvs.resize(res*res);
+	triangles.resize(0);
+	for (int j = 0; j < res; j++)
+		for (int i = 0; i < res; i++) {
+			float u = (float) i/(res-1), v = (float) j/(res-1), z = .05f*sin(20*u)*cos(17*v);
+			points[j*res+i] = vec3(2*u-1, 2*v-1, z);
+			normals[j*res+i] = normalize(vec3(-z, z, 1));
+			uvs[j*res+i] = vec2(u, v);
+		}
+	for (int j = 0; j < res-1; j++)
+		for (int i = 0; i < res-1; i++) {
+			int a = j*res+i, b = a+1, c = a+res, d = c+1;
+			triangles.push_back(int3(a, b, d));
+			triangles.push_back(int3(a, d, c));
+		}
+}
+
+long long WritePly(const char *filename, vector<vec3> &points, vector<vec3> &normals, vector<vec2> &uvs,
+				   vector<int3> &triangles, bool ascii, bool colors) {
+	// as a scanner would; colors adds uchar red, green, blue per vertex and a uchar flags per face,
+	// which ReadPly must skip; return file size
+	FILE *out = fopen(filename, "wb");
+	if (!out)
+		return 0;
+	fprintf(out, "ply\nformat %s 1.0\nelement vertex %i\n", ascii? "ascii" : "binary_little_endian", (int) points.size());
+	fprintf(out, "property float x\nproperty float y\nproperty float z\n");
+	fprintf(out, "property float nx\nproperty float ny\nproperty float nz\n");
+	if (colors)
+		fprintf(out, "property uchar red\nproperty uchar green\nproperty uchar blue\n");
+	fprintf(out, "property float s\nproperty float t\n");
+	fprintf(out, "element face %i\nproperty list uchar int vertex_indices\n", (int) triangles.size());
+	if (colors)
+		fprintf(out, "property uchar flags\n");
+	fprintf(out, "end_header\n");
+	for (size_t i = 0; i < points.size(); i++) {
+		vec3 &p = points[i], &n = normals[i];
+		vec2 &uv = uvs[i];
+		if (ascii)
+			fprintf(out, "%.9g %.9g %.9g %.9g %.9g %.9g%s %.9g %.9g\n", p.x, p.y, p.z, n.x, n.y, n.z, colors? " 128 64 32" : "", uv.x, uv.y);
+		else {
+			fwrite(&p, 12, 1, out);
+			fwrite(&n, 12, 1, out);
+			if (colors)
+				fwrite("\x80\x40\x20", 3, 1, out);
+			fwrite(&uv, 8, 1, out);
+		}
+	}
+	for (size_t t = 0; t < triangles.size(); t++) {
+		int3 &tri = triangles[t];
+		if (ascii)
+			fprintf(out, "3 %i %i %i%s\n", tri.i1, tri.i2, tri.i3, colors? " 0" : "");
+		else {
+			fwrite("\x03", 1, 1, out);
+			fwrite(&tri, 12, 1, out);
+			if (colors)
+				fwrite("\x00", 1, 1, out);
+		}
+	}
+	long long size = ftell(out);
+	fclose(out);
+	return size;
+}
+
+// Timing
+
+float Seconds(std::function<bool()> read, int nTimes = 3) {
+	// best of nTimes, negative if read fails
+	float best = -1;
+	for (int i = 0; i < nTimes; i++) {
+		auto start = std::chrono::steady_clock::now();
+		if (!read())
+			return -1;
+		float dt = std::chrono::duration<float>(std::chrono::steady_clock::now()-start).count();
+		best = best < 0 || dt < best? dt : best;
+	}
+	return best;
+}
+
+template<class T> bool Same(vector<T> &a, vector<T> &b) {
+	return a.size() == b.size() && (a.empty() || !memcmp(&a[0], &b[0], a.size()*sizeof(T)));
+}
+
+int main(int argc, char **argv) {
+	// Bench-ReadPly [grid resolution]
+	int res = argc > 1? atoi(argv[1]) : 1000;
+	vector<vec3> points, normals, objPoints, objNormals;
+	vector<vec2> uvs, objUvs;
+	vector<int3> triangles, objTriangles;
+	Grid(res, points, normals, uvs, triangles);
+	char *objName = (char *) "Bench-ReadPly.obj", *plyName = (char *) "Bench-ReadPly.ply";
+	if (!WriteAsciiObj(objName, points, triangles, &normals, &uvs)) {
+		printf("can't write %s\n", objName);
+		return 1;
+	}
+	long long size = 0, time;
+	SourceKey(objName, size, time);
+	float tObj = Seconds([&]() {
+		objPoints.resize(0); objNormals.resize(0); objUvs.resize(0); objTriangles.resize(0);
+		return ReadAsciiObj(objName, objPoints, objTriangles, &objNormals, &objUvs);
+	});
+	printf("%i points, %i triangles, with normals and uvs\n", (int) points.size(), (int) triangles.size());
+	printf("  OBJ (ReadAsciiObj)       %7.1f MB %6.3f secs\n", size/(float) (1 << 20), tObj);
+	// PLY written from the OBJ read, so both reads should give the same mesh
+	const char *names[] = {"PLY binary", "PLY binary, colors/flags", "PLY ascii", "PLY ascii, colors/flags"};
+	bool ok = true;
+	for (int variant = 0; variant < 4; variant++) {
+		bool ascii = variant >= 2, colors = variant%2 == 1;
+		size = WritePly(plyName, objPoints, objNormals, objUvs, objTriangles, ascii, colors);
+		vector<vec3> plyPoints, plyNormals;
+		vector<vec2> plyUvs;
+		vector<int3> plyTriangles;
+		float t = Seconds([&]() {
+			plyPoints.resize(0); plyNormals.resize(0); plyUvs.resize(0); plyTriangles.resize(0);
+			return ReadPly(plyName, plyPoints, plyTriangles, &plyNormals, &plyUvs);
+		});
+		bool same = Same(plyPoints, objPoints) && Same(plyNormals, objNormals) && Same(plyUvs, objUvs) && Same(plyTriangles, objTriangles);
+		printf("  %-24s %7.1f MB %6.3f secs (%.1fx)%s\n", names[variant], size/(float) (1 << 20), t, tObj/t, same? "" : " (different mesh!)");
+		ok = ok && same;
+	}
+	remove(objName);
+	remove(plyName);
+	return ok? 0 : 1;
+}
@@ -0,0 +1,74 @@
+// Bench-Simplify.cpp: SimplifyLODs collapse rate on a large mesh, with a check of each level
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include "MeshIO.h"
+#include "Simplify.h"
+
+void Grid(int res, vector<vec3> &points, vector<int3> &triangles) {
+	// res*res points on a noisy, bumpy sheet, two triangles per cell
+	srand(1);
+	points.resize(res*res);
+	triangles.resize(0);
+	for (int j = 0; j < res; j++)
+		for (int i = 0; i < res; i++) {
+			float u = (float) i/(res-1), v = (float) j/(res-1), noise = .002f*((float) rand()/RAND_MAX-.5f);
+			points[j*res+i] = vec3(2*u-1, 2*v-1, .1f*sin(9*u)*cos(7*v)+noise);
+		}
+	for (int j = 0; j < res-1; j++)
+		for (int i = 0; i < res-1; i++) {
+			int a = j*res+i, b = a+1, c = a+res, d = c+1;
+			triangles.push_back(int3(a, b, d));
+			triangles.push_back(int3(a, d, c));
+		}
+}
+
+void Check(vector<int3> &triangles, int &nDegenerate, int &nDoubled) {
+	// count triangles with a repeated vertex, and directed edges used more than once
+	vector<long long> edges;
+	nDegenerate = nDoubled = 0;
+	for (size_t t = 0; t < triangles.size(); t++) {
+		int *v = &triangles[t].i1;
+		if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+			nDegenerate++;
+		for (int k = 0; k < 3; k++)
+			edges.push_back(((long long) v[k] << 32) | (unsigned) v[(k+1)%3]);
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 1; i < edges.size(); i++)
+		nDoubled += edges[i] == edges[i-1];
+}
+
+int main(int argc, char **argv) {
+	// Bench-Simplify [file.obj | grid resolution]
+	vector<vec3> points;
+	vector<int3> triangles;
+	int res = argc > 1? atoi(argv[1]) : 1000;
+	if (argc > 1 && res < 2) {
+		if (!ReadAsciiObj(argv[1], points, triangles)) {
+			printf("can't read %s\n", argv[1]);
+			return 1;
+		}
+	}
+	else
+		Grid(res, points, triangles);
+	printf("%i points, %i triangles\n", (int) points.size(), (int) triangles.size());
+	vector<float> ratios = {.5f, .25f, .1f, .02f}, errors;
+	vector<vector<int3> > lods;
+	auto start = std::chrono::steady_clock::now();
+	SimplifyLODs(points, triangles, ratios, lods, &errors);
+	float dt = std::chrono::duration<float>(std::chrono::steady_clock::now()-start).count();
+	int nRemoved = (int) (triangles.size()-lods.back().size());
+	// an interior collapse removes two triangles
+	printf("%i triangles removed in %.2f secs: about %.0f collapses/sec\n", nRemoved, dt, nRemoved/(2*dt));
+	for (size_t i = 0; i < lods.size(); i++) {
+		int nDegenerate, nDoubled;
+		Check(lods[i], nDegenerate, nDoubled);
+		printf("  %3.0f%%: %8i triangles, error %g, %i degenerate, %i doubled edges\n",
+			100*ratios[i], (int) lods[i].size(), errors[i], nDegenerate, nDoubled);
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+// Bench-Transform.cpp: PointXform in points/s, against a ScreenPoint/ScreenDistSq call per point
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "Transform.h"
+
+using std::vector;
+
+// Per-point versions (as ScreenPoint and ScreenDistSq in UI.cpp, the window size passed in
+// rather than from glutGet)
+
+vec2 ScreenPoint(vec3 &p, mat4 &m, int width, int height) {
+	vec4 xp = m*vec4(p, 1);
+	return vec2(((xp.x/xp.w)+1)*.5f*(float) width, ((xp.y/xp.w)+1)*.5f*(float) height);
+}
+
+float ScreenDistSq(int x, int y, vec3 p, mat4 m, int width, int height) {
+	vec2 screen = ScreenPoint(p, m, width, height);
+	float dx = x-screen.x, dy = y-screen.y;
+	return dx*dx+dy*dy;
+}
+
+// Timing
+
+float Seconds(std::function<void()> f, int nTimes = 3) {
+	float best = -1;
+	for (int i = 0; i < nTimes; i++) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		float dt = std::chrono::duration<float>(std::chrono::steady_clock::now()-start).count();
+		best = best < 0 || dt < best? dt : best;
+	}
+	return best;
+}
+
+float Random() { return 2*(float) rand()/RAND_MAX-1; }
+
+int main(int argc, char **argv) {
+	// Bench-Transform [millions of points]
+	int n = (int) (1e6f*(argc > 1? (float) atof(argv[1]) : 4)), width = 1280, height = 960, x = 600, y = 500;
+	vector<vec3> points(n);
+	vector<vec4> out(n);
+	vector<vec2> screen(n);
+	vector<float> px(n), py(n), pz(n), ox(n), oy(n);
+	srand(1);
+	for (int i = 0; i < n; i++) {
+		points[i] = vec3(Random(), Random(), Random());
+		px[i] = points[i].x;
+		py[i] = points[i].y;
+		pz[i] = points[i].z;
+	}
+	mat4 fullview = Perspective(30, (float) width/height, .001f, 500)*Translate(0, 0, -5)*RotateY(20)*RotateX(10);
+	float mpts = n/1e6f;
+	printf("%.0fM points\n", mpts);
+	// screen locations
+	float tLoop = Seconds([&]() {
+		for (int i = 0; i < n; i++)
+			screen[i] = ScreenPoint(points[i], fullview, width, height);
+	});
+	printf("  ScreenPoint per point        %7.1f Mpts/s\n", mpts/tLoop);
+	for (int nThreads = 1; nThreads <= 4; nThreads *= 4) {
+		PointXform xform(fullview, width, height);
+		float t = Seconds([&]() { xform.Transform(points.data(), n, out.data(), ScreenSpace, nThreads); });
+		float t2 = Seconds([&]() { xform.Transform(px.data(), py.data(), pz.data(), n, ox.data(), oy.data(), NULL, NULL, ScreenSpace, nThreads); });
+		float diff = 0;
+		for (int i = 0; i < n; i++)
+			diff = fmaxf(diff, fmaxf(fmaxf(fabsf(out[i].x-screen[i].x), fabsf(out[i].y-screen[i].y)),
+									 fmaxf(fabsf(ox[i]-screen[i].x), fabsf(oy[i]-screen[i].y))));
+		printf("  Transform, %i thread%s   vec3 %7.1f Mpts/s (%.1fx), x/y/z arrays %7.1f Mpts/s (%.1fx), max difference %g pixels\n",
+			nThreads, nThreads > 1? "s" : " ", mpts/t, tLoop/t, mpts/t2, tLoop/t2, diff);
+	}
+	// nearest point to a pixel
+	int idLoop = -1;
+	tLoop = Seconds([&]() {
+		float dist = 100;
+		idLoop = -1;
+		for (int i = 0; i < n; i++) {
+			float d = ScreenDistSq(x, y, points[i], fullview, width, height);
+			if (d < dist) {
+				dist = d;
+				idLoop = i;
+			}
+		}
+	});
+	printf("  ScreenDistSq per point       %7.1f Mpts/s\n", mpts/tLoop);
+	for (int nThreads = 1; nThreads <= 4; nThreads *= 4) {
+		PointXform xform(fullview, width, height);
+		int id = -1;
+		float t = Seconds([&]() { id = xform.Nearest(x, y, points.data(), n, 100, NULL, nThreads); });
+		printf("  Nearest, %i thread%s          %7.1f Mpts/s (%.1fx), point %i (per point %i)\n",
+			nThreads, nThreads > 1? "s" : " ", mpts/t, tLoop/t, id, idLoop);
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+// Bench-VecCopy.cpp: vector<vec3> and vector<mat4> growth, insert, copy and resize, against types
+// with the user-written copy constructors vec.h and mat.h had before they were trivially copyable
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "mat.h"
+
+using std::vector;
+
+// Previous types (copy constructors as in vec.h and mat.h before; other members omitted)
+
+struct OldVec3 {
+	GLfloat x, y, z;
+	OldVec3(GLfloat s = GLfloat(0.0)) : x(s), y(s), z(s) { }
+	OldVec3(GLfloat x, GLfloat y, GLfloat z) : x(x), y(y), z(z) { }
+	OldVec3(const OldVec3 &v) { x = v.x;  y = v.y;  z = v.z; }
+	OldVec3 &operator = (const OldVec3 &v) { x = v.x;  y = v.y;  z = v.z;  return *this; }
+};
+
+struct OldVec4 {
+	GLfloat x, y, z, w;
+	OldVec4(GLfloat s = GLfloat(0.0)) : x(s), y(s), z(s), w(s) { }
+	OldVec4(GLfloat x, GLfloat y, GLfloat z, GLfloat w) : x(x), y(y), z(z), w(w) { }
+	OldVec4(const OldVec4 &v) { x = v.x;  y = v.y;  z = v.z;  w = v.w; }
+	OldVec4 &operator = (const OldVec4 &v) { x = v.x;  y = v.y;  z = v.z;  w = v.w;  return *this; }
+	bool operator != (const OldVec4 &v) const { return x != v.x || y != v.y || z != v.z || w != v.w; }
+};
+
+class OldMat4 {
+	OldVec4 _m[4];
+public:
+	OldMat4(const GLfloat d = GLfloat(1.0)) { _m[0].x = d;  _m[1].y = d;  _m[2].z = d;  _m[3].w = d; }
+	OldMat4(const OldMat4 &m) {
+		if (*this != m) {
+			_m[0] = m._m[0];  _m[1] = m._m[1];  _m[2] = m._m[2];  _m[3] = m._m[3];
+		}
+	}
+	OldVec4 &operator [] (int i) { return _m[i]; }
+	bool operator != (const OldMat4 &m) const {
+		return _m[0] != m._m[0] || _m[1] != m._m[1] || _m[2] != m._m[2] || _m[3] != m._m[3];
+	}
+};
+
+// Timing
+
+float Seconds(std::function<void()> f, int nTimes = 5) {
+	float best = -1;
+	for (int i = 0; i < nTimes; i++) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		float dt = std::chrono::duration<float>(std::chrono::steady_clock::now()-start).count();
+		best = best < 0 || dt < best? dt : best;
+	}
+	return best;
+}
+
+template<class T> size_t Build(vector<T> &items, int op) {
+	// a vector of items built from scratch by push_back, insert, copy or resize; return its size
+	vector<T> v;
+	int n = (int) items.size();
+	if (op == 0)
+		for (int i = 0; i < n; i++)
+			v.push_back(items[i]);				// copies all on each reallocation
+	if (op == 1)
+		v.insert(v.end(), items.begin(), items.end());
+	if (op == 2)
+		v = vector<T>(items);
+	if (op == 3) {
+		v = vector<T>(items.begin(), items.begin()+n/2);
+		v.resize(n);							// reallocates, copies half
+	}
+	return v.size();
+}
+
+template<class Old, class New> void Bench(const char *name, vector<Old> &oldItems, vector<New> &newItems, int nReps) {
+	// each operation builds a vector of the n items nReps times; the items are few enough to stay
+	// in cache, so copying is timed rather than memory; times are per item
+	int n = (int) newItems.size();
+	size_t sum = 0;								// keeps results live
+	printf("%s, %i items %i times, trivially copyable: before %s, now %s\n", name, n, nReps,
+		std::is_trivially_copyable<Old>::value? "yes" : "no", std::is_trivially_copyable<New>::value? "yes" : "no");
+	const char *ops[] = {"push_back", "insert", "copy", "resize"};
+	for (int op = 0; op < 4; op++) {
+		float tOld = Seconds([&]() {
+			for (int r = 0; r < nReps; r++)
+				sum += Build(oldItems, op);
+		});
+		float tNew = Seconds([&]() {
+			for (int r = 0; r < nReps; r++)
+				sum += Build(newItems, op);
+		});
+		float nItems = (float) n*nReps;
+		printf("  %-10s before %6.2f ns  now %6.2f ns  (%.1fx)\n", ops[op], 1e9f*tOld/nItems, 1e9f*tNew/nItems, tOld/tNew);
+	}
+	if (!sum)
+		printf("no items\n");
+}
+
+float Random() { return 2*(float) rand()/RAND_MAX-1; }
+
+int main(int argc, char **argv) {
+	// Bench-VecCopy [millions of items]; vectors of 1024 vec3s and of 1024 mat4s
+	const int n = 1024;
+	int nReps = (int) ((argc > 1? atof(argv[1]) : 10)*1e6/n);
+	vector<OldVec3> oldPoints(n);
+	vector<vec3> points(n);
+	srand(1);
+	for (int i = 0; i < n; i++) {
+		points[i] = vec3(Random(), Random(), Random());
+		oldPoints[i] = OldVec3(points[i].x, points[i].y, points[i].z);
+	}
+	Bench("vec3", oldPoints, points, nReps);
+	vector<OldMat4> oldMatrices(n);
+	vector<mat4> matrices(n);
+	for (int i = 0; i < n; i++)
+		for (int r = 0; r < 4; r++) {
+			matrices[i][r] = vec4(Random(), Random(), Random(), Random());
+			oldMatrices[i][r] = OldVec4(matrices[i][r].x, matrices[i][r].y, matrices[i][r].z, matrices[i][r].w);
+		}
+	Bench("mat4", oldMatrices, matrices, nReps);
+	return 0;
+}
@@ -0,0 +1,189 @@
+/* ======================================
+   Cull.cpp - view frustum culling of bounding spheres and boxes in bulk
+   Copyright (c) Jules Bloomenthal, Seattle, 2012
+   All rights reserved
+   ====================================== */
+
+#include "Cull.h"
+#include "Parallel.h"
+#include <math.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULL_SSE
+#include <emmintrin.h>
+#endif
+
+static const int cullGrain = 1 << 14;
+
+// ViewFrustum
+
+ViewFrustum::ViewFrustum(mat4 &fullview) {
+	// a point is inside if each clip coordinate lies within +/-w
+	planes[LeftPlane]   = fullview[3]+fullview[0];
+	planes[RightPlane]  = fullview[3]-fullview[0];
+	planes[BottomPlane] = fullview[3]+fullview[1];
+	planes[TopPlane]    = fullview[3]-fullview[1];
+	planes[NearPlane]   = fullview[3]+fullview[2];
+	planes[FarPlane]    = fullview[3]-fullview[2];
+	for (int i = 0; i < 6; i++) {
+		float len = length(vec3(planes[i].x, planes[i].y, planes[i].z));
+		if (len > 0)
+			planes[i] = planes[i]/len;
+	}
+}
+
+bool ViewFrustum::Visible(vec3 &center, float radius) {
+	for (int i = 0; i < 6; i++) {
+		vec4 &p = planes[i];
+		if (p.x*center.x+p.y*center.y+(p.z*center.z+(p.w+radius)) < 0)
+			return false;
+	}
+	return true;
+}
+
+bool ViewFrustum::Visible(vec3 &min, vec3 &max) {
+	// out if the center is further behind a plane than the half size projected on the plane
+	// normal (that is, if the corner furthest along the normal is behind it)
+	vec3 c = .5f*(min+max), e = .5f*(max-min);
+	for (int i = 0; i < 6; i++) {
+		vec4 &p = planes[i];
+		float d = p.x*c.x+p.y*c.y+(p.z*c.z+p.w), r = fabsf(p.x)*e.x+fabsf(p.y)*e.y+fabsf(p.z)*e.z;
+		if (d+r < 0)
+			return false;
+	}
+	return true;
+}
+
+// Bounds
+
+void Spheres::Add(vec3 &center, float radius) {
+	x.push_back(center.x);
+	y.push_back(center.y);
+	z.push_back(center.z);
+	r.push_back(radius);
+}
+
+void Spheres::Clear() {
+	x.resize(0);
+	y.resize(0);
+	z.resize(0);
+	r.resize(0);
+}
+
+void Boxes::Add(vec3 &min, vec3 &max) {
+	x0.push_back(min.x);
+	y0.push_back(min.y);
+	z0.push_back(min.z);
+	x1.push_back(max.x);
+	y1.push_back(max.y);
+	z1.push_back(max.z);
+}
+
+void Boxes::Clear() {
+	x0.resize(0);
+	y0.resize(0);
+	z0.resize(0);
+	x1.resize(0);
+	y1.resize(0);
+	z1.resize(0);
+}
+
+// Culling
+
+template<class F>
+static int Gather(int n, vector<int> &visible, int nThreads, F test) {
+	// test(i, end, ids) writes the visible indices of [i, end) to ids and returns their count;
+	// each block writes at its own start in visible, then the blocks are packed in order
+	int nBlocks = (n+cullGrain-1)/cullGrain;
+	vector<int> counts(nBlocks, 0);
+	visible.resize(n);
+	ParallelFor(n, [&](int i, int end) {
+		counts[i/cullGrain] = test(i, end, n? &visible[i] : NULL);
+	}, cullGrain, nThreads);
+	int nVisible = 0;
+	for (int b = 0; b < nBlocks; b++) {
+		int *ids = &visible[b*cullGrain];
+		if (nVisible != b*cullGrain)
+			for (int k = 0; k < counts[b]; k++)
+				visible[nVisible+k] = ids[k];
+		nVisible += counts[b];
+	}
+	visible.resize(nVisible);
+	return nVisible;
+}
+
+int Cull(ViewFrustum &f, Spheres &s, vector<int> &visible, int nThreads) {
+	const float *x = s.x.data(), *y = s.y.data(), *z = s.z.data(), *r = s.r.data();
+	return Gather(s.Size(), visible, nThreads, [&](int i, int end, int *ids) {
+		int nIds = 0;
+#ifdef CULL_SSE
+		// four spheres per register, out if the center is further than the radius behind any plane
+		__m128 pl[6][4], zero = _mm_setzero_ps();
+		for (int k = 0; k < 6; k++)
+			for (int j = 0; j < 4; j++)
+				pl[k][j] = _mm_set1_ps(f.planes[k][j]);
+		for (; i+4 <= end; i += 4) {
+			__m128 px = _mm_loadu_ps(x+i), py = _mm_loadu_ps(y+i), pz = _mm_loadu_ps(z+i), pr = _mm_loadu_ps(r+i);
+			__m128 out = zero;
+			for (int k = 0; k < 6; k++) {
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl[k][0], px), _mm_mul_ps(pl[k][1], py)),
+									  _mm_add_ps(_mm_mul_ps(pl[k][2], pz), _mm_add_ps(pl[k][3], pr)));
+				out = _mm_or_ps(out, _mm_cmplt_ps(d, zero));
+			}
+			int in = ~_mm_movemask_ps(out);
+			for (int j = 0; j < 4; j++) {
+				ids[nIds] = i+j;				// written always, kept if in
+				nIds += (in >> j) & 1;
+			}
+		}
+#endif
+		for (; i < end; i++) {
+			vec3 c(x[i], y[i], z[i]);
+			if (f.Visible(c, r[i]))
+				ids[nIds++] = i;
+		}
+		return nIds;
+	});
+}
+
+int Cull(ViewFrustum &f, Boxes &b, vector<int> &visible, int nThreads) {
+	const float *x0 = b.x0.data(), *y0 = b.y0.data(), *z0 = b.z0.data();
+	const float *x1 = b.x1.data(), *y1 = b.y1.data(), *z1 = b.z1.data();
+	return Gather(b.Size(), visible, nThreads, [&](int i, int end, int *ids) {
+		int nIds = 0;
+#ifdef CULL_SSE
+		// four boxes per register, as Visible
+		__m128 pl[6][4], ab[6][3], zero = _mm_setzero_ps(), half = _mm_set1_ps(.5f);
+		for (int k = 0; k < 6; k++)
+			for (int j = 0; j < 4; j++) {
+				pl[k][j] = _mm_set1_ps(f.planes[k][j]);
+				if (j < 3)
+					ab[k][j] = _mm_set1_ps(fabsf(f.planes[k][j]));
+			}
+		for (; i+4 <= end; i += 4) {
+			__m128 lx = _mm_loadu_ps(x0+i), ly = _mm_loadu_ps(y0+i), lz = _mm_loadu_ps(z0+i);
+			__m128 hx = _mm_loadu_ps(x1+i), hy = _mm_loadu_ps(y1+i), hz = _mm_loadu_ps(z1+i);
+			__m128 cx = _mm_mul_ps(_mm_add_ps(lx, hx), half), ex = _mm_mul_ps(_mm_sub_ps(hx, lx), half);
+			__m128 cy = _mm_mul_ps(_mm_add_ps(ly, hy), half), ey = _mm_mul_ps(_mm_sub_ps(hy, ly), half);
+			__m128 cz = _mm_mul_ps(_mm_add_ps(lz, hz), half), ez = _mm_mul_ps(_mm_sub_ps(hz, lz), half);
+			__m128 out = zero;
+			for (int k = 0; k < 6; k++) {
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl[k][0], cx), _mm_mul_ps(pl[k][1], cy)),
+									  _mm_add_ps(_mm_mul_ps(pl[k][2], cz), pl[k][3]));
+				__m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ab[k][0], ex), _mm_mul_ps(ab[k][1], ey)), _mm_mul_ps(ab[k][2], ez));
+				out = _mm_or_ps(out, _mm_cmplt_ps(_mm_add_ps(d, e), zero));
+			}
+			int in = ~_mm_movemask_ps(out);
+			for (int j = 0; j < 4; j++) {
+				ids[nIds] = i+j;
+				nIds += (in >> j) & 1;
+			}
+		}
+#endif
+		for (; i < end; i++) {
+			vec3 min(x0[i], y0[i], z0[i]), max(x1[i], y1[i], z1[i]);
+			if (f.Visible(min, max))
+				ids[nIds++] = i;
+		}
+		return nIds;
+	});
+}
@@ -0,0 +1,52 @@
+/*	==============================
+    Cull.h - view frustum culling of bounding spheres and boxes in bulk
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef CULL_HDR
+#define CULL_HDR
+
+#include <vector>
+#include "mat.h"
+
+using std::vector;
+
+// ViewFrustum
+
+enum { LeftPlane, RightPlane, BottomPlane, TopPlane, NearPlane, FarPlane };
+
+struct ViewFrustum {
+	vec4 planes[6];								// (a, b, c, d), unit (a, b, c), ax+by+cz+d >= 0 inside
+	ViewFrustum(mat4 &fullview);
+		// the planes of fullview (persp*modelview) in model space, inward (Gribb and Hartmann)
+	bool Visible(vec3 &center, float radius);
+		// true unless the sphere is wholly outside a plane
+	bool Visible(vec3 &min, vec3 &max);
+		// true unless the box is wholly outside a plane (a box near a frustum corner may be
+		// outside yet pass)
+};
+
+// Bounds, one array per component
+
+struct Spheres {
+	vector<float> x, y, z, r;					// centers and radii
+	int Size() { return (int) r.size(); }
+	void Add(vec3 &center, float radius);
+	void Clear();
+};
+
+struct Boxes {
+	vector<float> x0, y0, z0, x1, y1, z1;		// min and max corners
+	int Size() { return (int) x0.size(); }
+	void Add(vec3 &min, vec3 &max);
+	void Clear();
+};
+
+int Cull(ViewFrustum &f, Spheres &spheres, vector<int> &visible, int nThreads = 1);
+int Cull(ViewFrustum &f, Boxes &boxes, vector<int> &visible, int nThreads = 1);
+	// set visible to the indices, ascending, of the spheres or boxes that pass ViewFrustum::Visible;
+	// four at a time with SSE where the compiler targets it, blocks on nThreads threads (0 for
+	// one per hardware thread); return # visible
+
+#endif
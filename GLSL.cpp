@@ -314,6 +314,14 @@ bool GLSL::SetUniform4v(int shader, const char *name, int count, float *v) {
 	return true;
 }
 
+bool GLSL::SetUniform(int shader, const char *name, mat3 m) {
+	GLint id = glGetUniformLocation(shader, name);
+	if (id < 0)
+		return Error(name);
+	glUniformMatrix3fv(id, 1, true, (float *) &m[0][0]);
+	return true;
+}
+
 bool GLSL::SetUniform(int shader, const char *name, mat4 m) {
 	GLint id = glGetUniformLocation(shader, name);
 	if (id < 0)
@@ -47,6 +47,7 @@ bool SetUniform(int shader, const char *name, vec4 *v);
 bool SetUniform3(int shader, const char *name, float *v);
 bool SetUniform3v(int shader, const char *name, int count, float *v);
 bool SetUniform4v(int shader, const char *name, int count, float *v);
+bool SetUniform(int shader, const char *name, mat3 m);
 bool SetUniform(int shader, const char *name, mat4 m);
 
 // Attribute Access
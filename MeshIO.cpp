@@ -5,11 +5,28 @@
    ====================================== */
 
 #include "MeshIO.h"
+#include "Parallel.h"
 #include <assert.h>
+#include <limits.h>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <direct.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHIO_SSE
+#include <emmintrin.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using std::string;
 using std::vector;
@@ -20,8 +37,8 @@ using std::ifstream;
 
 void UpdateMinMax(vec3 p, vec3 &min, vec3 &max) {
 	for (int k = 0; k < 3; k++) {
-		if (p[k] < min[k]) min[k] = p[k];
-		if (p[k] > max[k]) max[k] = p[k];
+		min[k] = p[k] < min[k]? p[k] : min[k];
+		max[k] = p[k] > max[k]? p[k] : max[k];
 	}
 }
 
@@ -34,71 +51,219 @@ float GetScaleCenter(vec3 &min, vec3 &max, float scale, vec3 &center) {
 	return scale*2.f/maxrange;
 }
 
+// bounds and scale/translate kernels, for points stride floats apart (3: packed vec3, else at least 4,
+// as VertexSTL);
+// SSE where the compiler targets it (always on x64), else scalar; blocks of points run in parallel
+
+static const int kernelGrain = 1 << 16;
+
+static void MinMax(float *p, int n, int stride, vec3 &min, vec3 &max, int nThreads) {
+	int nBlocks = (n+kernelGrain-1)/kernelGrain;
+	vector<vec3> mins(nBlocks, vec3(FLT_MAX)), maxs(nBlocks, vec3(-FLT_MAX));
+	ParallelFor(nBlocks, [&](int b0, int b1) {
+		for (int b = b0; b < b1; b++) {
+			int i = b*kernelGrain, end = i+kernelGrain < n? i+kernelGrain : n;
+			vec3 &mn = mins[b], &mx = maxs[b];
+#ifdef MESHIO_SSE
+			__m128 lo = _mm_set1_ps(FLT_MAX), hi = _mm_set1_ps(-FLT_MAX);
+			if (stride == 3) {
+				// four points are three registers: xyzx yzxy zxyz
+				__m128 lo1 = lo, lo2 = lo, hi1 = hi, hi2 = hi;
+				for (; i+4 <= end; i += 4) {
+					float *q = p+3*i;
+					__m128 a = _mm_loadu_ps(q), c = _mm_loadu_ps(q+4), d = _mm_loadu_ps(q+8);
+					lo = _mm_min_ps(lo, a);  hi = _mm_max_ps(hi, a);
+					lo1 = _mm_min_ps(lo1, c); hi1 = _mm_max_ps(hi1, c);
+					lo2 = _mm_min_ps(lo2, d); hi2 = _mm_max_ps(hi2, d);
+				}
+				// fold to xyz_: x from lo 0,3, lo1 2, lo2 1; y from lo 1, lo1 0,3, lo2 2; z from lo 2, lo1 1, lo2 0,3
+				__m128 l3 = _mm_shuffle_ps(_mm_shuffle_ps(lo, lo1, _MM_SHUFFLE(3, 3, 3, 3)), lo2, _MM_SHUFFLE(3, 3, 2, 0));
+				__m128 h3 = _mm_shuffle_ps(_mm_shuffle_ps(hi, hi1, _MM_SHUFFLE(3, 3, 3, 3)), hi2, _MM_SHUFFLE(3, 3, 2, 0));
+				lo = _mm_min_ps(_mm_min_ps(lo, l3), _mm_min_ps(_mm_shuffle_ps(lo1, lo1, _MM_SHUFFLE(0, 1, 0, 2)), _mm_shuffle_ps(lo2, lo2, _MM_SHUFFLE(0, 0, 2, 1))));
+				hi = _mm_max_ps(_mm_max_ps(hi, h3), _mm_max_ps(_mm_shuffle_ps(hi1, hi1, _MM_SHUFFLE(0, 1, 0, 2)), _mm_shuffle_ps(hi2, hi2, _MM_SHUFFLE(0, 0, 2, 1))));
+			}
+			else
+				// each point is one (unaligned) register, its fourth lane (within the element) ignored
+				for (; i < end; i++) {
+					__m128 a = _mm_loadu_ps(p+stride*i);
+					lo = _mm_min_ps(lo, a);
+					hi = _mm_max_ps(hi, a);
+				}
+			float l[4], h[4];
+			_mm_storeu_ps(l, lo);
+			_mm_storeu_ps(h, hi);
+			mn = vec3(l[0], l[1], l[2]);
+			mx = vec3(h[0], h[1], h[2]);
+#endif
+			for (; i < end; i++)
+				UpdateMinMax(*(vec3 *) (p+stride*i), mn, mx);
+		}
+	}, 1, nThreads);
+	min = vec3(FLT_MAX);
+	max = vec3(-FLT_MAX);
+	for (int b = 0; b < nBlocks; b++) {
+		UpdateMinMax(mins[b], min, max);
+		UpdateMinMax(maxs[b], min, max);
+	}
+}
+
+static void ScaleAboutCenter(float *p, int n, int stride, float s, vec3 center, int nThreads) {
+	// p = s*(p-center), in that order so results match the scalar form exactly
+	ParallelFor(n, [&](int i, int end) {
+#ifdef MESHIO_SSE
+		__m128 scale = _mm_set1_ps(s);
+		if (stride == 3) {
+			__m128 c0 = _mm_setr_ps(center.x, center.y, center.z, center.x);
+			__m128 c1 = _mm_setr_ps(center.y, center.z, center.x, center.y);
+			__m128 c2 = _mm_setr_ps(center.z, center.x, center.y, center.z);
+			for (; i+4 <= end; i += 4) {
+				float *q = p+3*i;
+				_mm_storeu_ps(q, _mm_mul_ps(scale, _mm_sub_ps(_mm_loadu_ps(q), c0)));
+				_mm_storeu_ps(q+4, _mm_mul_ps(scale, _mm_sub_ps(_mm_loadu_ps(q+4), c1)));
+				_mm_storeu_ps(q+8, _mm_mul_ps(scale, _mm_sub_ps(_mm_loadu_ps(q+8), c2)));
+			}
+		}
+		else {
+			// the fourth lane (next float in the element) is multiplied by 1 after subtracting 0
+			__m128 c = _mm_setr_ps(center.x, center.y, center.z, 0), sc = _mm_setr_ps(s, s, s, 1);
+			for (; i < end; i++) {
+				float *q = p+stride*i;
+				_mm_storeu_ps(q, _mm_mul_ps(sc, _mm_sub_ps(_mm_loadu_ps(q), c)));
+			}
+		}
+#endif
+		for (; i < end; i++) {
+			vec3 &v = *(vec3 *) (p+stride*i);
+			v = s*(v-center);
+		}
+	}, kernelGrain, nThreads);
+}
+
 // normalize STL models
 
-void MinMax(vector<VertexSTL> &points, vec3 &min, vec3 &max) {
-	min.x = min.y = min.z = FLT_MAX;
-	max.x = max.y = max.z = -FLT_MAX;
-	for (int i = 0; i < (int) points.size(); i++)
-		UpdateMinMax(points[i].point, min, max);
+void MinMax(vector<VertexSTL> &points, vec3 &min, vec3 &max, int nThreads) {
+	MinMax(points.empty()? NULL : &points[0].point.x, (int) points.size(), sizeof(VertexSTL)/sizeof(float), min, max, nThreads);
 }
 
-void Normalize(vector<VertexSTL> &vertices, float scale) {
+void Normalize(vector<VertexSTL> &vertices, float scale, int nThreads) {
 	vec3 min, max, center;
-	MinMax(vertices, min, max);
+	MinMax(vertices, min, max, nThreads);
 	float s = GetScaleCenter(min, max, scale, center);
-	for (int i = 0; i < (int) vertices.size(); i++) {
-		vec3 &v = vertices[i].point;
-		v = s*(v-center);
-	}
+	ScaleAboutCenter(vertices.empty()? NULL : &vertices[0].point.x, (int) vertices.size(), sizeof(VertexSTL)/sizeof(float), s, center, nThreads);
 }
 
 // normalize vec3 models
 
-void MinMax(vector<vec3> &points, vec3 &min, vec3 &max) {
-	min[0] = min[1] = min[2] = FLT_MAX;
-	max[0] = max[1] = max[2] = -FLT_MAX;
-	for (int i = 0; i < (int) points.size(); i++) {
-		vec3 &v = points[i];
-		for (int k = 0; k < 3; k++) {
-			if (v[k] < min[k]) min[k] = v[k];
-			if (v[k] > max[k]) max[k] = v[k];
-		}
-	}
+void MinMax(vector<vec3> &points, vec3 &min, vec3 &max, int nThreads) {
+	MinMax(points.empty()? NULL : &points[0].x, (int) points.size(), 3, min, max, nThreads);
 }
 
-void Normalize(vector<vec3> &points, float scale) {
-	vec3 min, max;
-	MinMax(points, min, max);
-	vec3 center(.5f*(min[0]+max[0]), .5f*(min[1]+max[1]), .5f*(min[2]+max[2]));
-	float maxrange = 0;
-	for (int k = 0; k < 3; k++)
-		if ((max[k]-min[k]) > maxrange)
-			maxrange = max[k]-min[k];
-	float s = scale*2.f/maxrange;
-	for (int i = 0; i < (int) points.size(); i++) {
-		vec3 &v = points[i];
+void Normalize(vector<vec3> &points, float scale, int nThreads) {
+	vec3 min, max, center;
+	MinMax(points, min, max, nThreads);
+	float s = GetScaleCenter(min, max, scale, center);
+	ScaleAboutCenter(points.empty()? NULL : &points[0].x, (int) points.size(), 3, s, center, nThreads);
+}
+
+void VertexTriangles::Set(int nPoints, vector<int3> &triangles) {
+	// count corners per vertex, offset, then fill in triangle order
+	int nTriangles = (int) triangles.size();
+	start.assign(nPoints+1, 0);
+	for (int t = 0; t < nTriangles; t++) {
+		int *vids = &triangles[t].i1;
 		for (int k = 0; k < 3; k++)
-			v[k] = s*(v[k]-center[k]);
+			start[vids[k]+1]++;
 	}
+	for (int v = 0; v < nPoints; v++)
+		start[v+1] += start[v];
+	corners.resize(3*nTriangles);
+	vector<int> next(start.begin(), start.end()-1);
+	for (int t = 0; t < nTriangles; t++) {
+		int *vids = &triangles[t].i1;
+		for (int k = 0; k < 3; k++)
+			corners[next[vids[k]]++] = 3*t+k;
+	}
+}
+
+static inline vec3 FaceNormal(vector<vec3> &points, int3 &t, NormalWeight weight) {
+	// unit normal, or twice-area length if weighted by area
+	vec3 &p1 = points[t.i1], &p2 = points[t.i2], &p3 = points[t.i3];
+	vec3 a(p2-p1), b(p3-p2), n(cross(a, b));
+	return weight == AreaWeight? n : normalize(n);
+}
+
+static inline void CornerAngles(vector<vec3> &points, int3 &t, float *angles) {
+	// interior angles of triangle t at its three vertices, sharing the unit edge vectors
+	vec3 &p1 = points[t.i1], &p2 = points[t.i2], &p3 = points[t.i3];
+	vec3 e[] = {normalize(p2-p1), normalize(p3-p2), normalize(p1-p3)};
+	for (int k = 0; k < 3; k++) {
+		float d = -dot(e[(k+2)%3], e[k]);
+		angles[k] = acos(d < -1? -1 : d > 1? 1 : d);
+	}
+}
+
+static inline vec3 GatherNormal(vector<vec3> &points, vector<int3> &triangles, VertexTriangles &adjacency, int v,
+								NormalWeight weight, vec3 *faceNormals = NULL, float *cornerAngles = NULL) {
+	// sum the weighted normals of triangles about vertex v, in triangle order; use face normals
+	// and corner angles if precomputed
+	vec3 sum(0);
+	for (int c = adjacency.start[v]; c < adjacency.start[v+1]; c++) {
+		int corner = adjacency.corners[c], t = corner/3;
+		vec3 n = faceNormals? faceNormals[t] : FaceNormal(points, triangles[t], weight);
+		if (weight == AngleWeight) {
+			float angles[3];
+			if (!cornerAngles)
+				CornerAngles(points, triangles[t], angles);
+			n *= cornerAngles? cornerAngles[corner] : angles[corner%3];
+		}
+		sum += n;
+	}
+	return normalize(sum);
+}
+
+void SetVertexNormals(vector<vec3> &points, vector<int3> &triangles, vector<vec3> &normals,
+					  VertexTriangles &adjacency, NormalWeight weight, int nThreads) {
+	// face normals in parallel, then each vertex gathers from its own triangles (no write conflicts)
+	int nPoints = (int) points.size(), nTriangles = (int) triangles.size();
+	vector<vec3> faceNormals(nTriangles);
+	vector<float> cornerAngles(weight == AngleWeight? 3*nTriangles : 0);
+	ParallelFor(nTriangles, [&](int t0, int t1) {
+		for (int t = t0; t < t1; t++) {
+			faceNormals[t] = FaceNormal(points, triangles[t], weight);
+			if (weight == AngleWeight)
+				CornerAngles(points, triangles[t], &cornerAngles[3*t]);
+		}
+	}, 1 << 14, nThreads);
+	normals.resize(nPoints);
+	ParallelFor(nPoints, [&](int v0, int v1) {
+		for (int v = v0; v < v1; v++)
+			normals[v] = GatherNormal(points, triangles, adjacency, v, weight, faceNormals.data(), cornerAngles.data());
+	}, 1 << 14, nThreads);
+}
+
+void SetVertexNormals(vector<vec3> &points, vector<int3> &triangles, vector<vec3> &normals, NormalWeight weight, int nThreads) {
+	VertexTriangles adjacency;
+	adjacency.Set((int) points.size(), triangles);
+	SetVertexNormals(points, triangles, normals, adjacency, weight, nThreads);
 }
 
-void SetVertexNormals(vector<vec3> &points, vector<int3> &triangles, vector<vec3> &normals) {
-	// size normals array and initialize to zero
-	int nverts = (int) points.size();
-	normals.resize(nverts, vec3(0));
-	// accumulate each triangle normal into its three vertex normals
-	for (int i = 0; i < (int) triangles.size(); i++) {
-		int3 &t = triangles[i];
-		vec3 &p1 = points[t.i1], &p2 = points[t.i2], &p3 = points[t.i3];
-		vec3 a(p2-p1), b(p3-p2), n(normalize(cross(a, b)));
-		normals[t.i1] += n;
-		normals[t.i2] += n;
-		normals[t.i3] += n;
+void UpdateVertexNormals(vector<vec3> &points, vector<int3> &triangles, vector<vec3> &normals, VertexTriangles &adjacency,
+						 vector<int> &modifiedTriangles, NormalWeight weight, int nThreads) {
+	// gather anew at each vertex of the modified triangles
+	vector<int> vids;
+	vids.reserve(3*modifiedTriangles.size());
+	for (size_t i = 0; i < modifiedTriangles.size(); i++) {
+		int3 &t = triangles[modifiedTriangles[i]];
+		vids.push_back(t.i1);
+		vids.push_back(t.i2);
+		vids.push_back(t.i3);
 	}
-	// set to unit length
-	for (int i = 0; i < nverts; i++)
-		normals[i] = normalize(normals[i]);
+	std::sort(vids.begin(), vids.end());
+	vids.erase(std::unique(vids.begin(), vids.end()), vids.end());
+	ParallelFor((int) vids.size(), [&](int i0, int i1) {
+		for (int i = i0; i < i1; i++)
+			normals[vids[i]] = GatherNormal(points, triangles, adjacency, vids[i], weight);
+	}, 1 << 10, nThreads);
 }
 
 // ASCII support
@@ -115,42 +280,302 @@ bool ReadWord(char* &ptr, char *word, int charLimit) {
 		return true;
 }
 
+// memory-mapped file
+
+class MappedFile {
+public:
+	const char *data;								// NULL if file could not be mapped
+	size_t size;
+	MappedFile(const char *filename) : data(NULL), size(0) {
+#ifdef _WIN32
+		mapping = NULL;
+		file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize))
+			return;
+		size = (size_t) fileSize.QuadPart;
+		if (!size) {
+			data = "";								// can't map an empty file
+			return;
+		}
+		if ((mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)) != NULL)
+			data = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		struct stat s;
+		if ((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &s) < 0)
+			return;
+		size = (size_t) s.st_size;
+		if (!size) {
+			data = "";
+			return;
+		}
+		void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			madvise(p, size, MADV_SEQUENTIAL);
+			data = (const char *) p;
+		}
+#endif
+	}
+	~MappedFile() {
+#ifdef _WIN32
+		if (data && size)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+#else
+		if (data && size)
+			munmap((void *) data, size);
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+private:
+#ifdef _WIN32
+	HANDLE file, mapping;
+#else
+	int fd;
+#endif
+	MappedFile(const MappedFile &);					// not copyable
+	MappedFile &operator=(const MappedFile &);
+};
+
+bool SourceKey(const char *filename, long long &size, long long &time) {
+	// size and modification time of file; 64-bit size on Windows as well
+#ifdef _WIN32
+	struct _stat64 s;
+	if (_stat64(filename, &s) != 0)
+#else
+	struct stat s;
+	if (stat(filename, &s) != 0)
+#endif
+		return false;
+	size = (long long) s.st_size;
+	time = (long long) s.st_mtime;
+	return true;
+}
+
+// scanning (in place, no null terminator required)
+
+static inline bool IsDigit(char c) { return (unsigned) (c-'0') < 10; }
+
+static inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static inline bool IsSpace(char c) { return IsBlank(c) || c == '\n'; }
+
+static inline void SkipBlanks(const char *&p, const char *end) {
+	while (p < end && IsBlank(*p))
+		p++;
+}
+
+static inline void SkipWord(const char *&p, const char *end) {
+	while (p < end && !IsSpace(*p))
+		p++;
+}
+
+static inline void SkipLine(const char *&p, const char *end) {
+	const char *eol = (const char *) memchr(p, '\n', end-p);
+	p = eol? eol+1 : end;
+}
+
+static bool ScanInt(const char *&ptr, const char *end, int &i) {
+	// as atoi, but advance ptr; return false if no digits
+	const char *p = ptr;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	if (p == end || !IsDigit(*p))
+		return false;
+	int n = 0;
+	for (; p < end && IsDigit(*p); p++)
+		n = 10*n+(*p-'0');
+	i = negative? -n : n;
+	ptr = p;
+	return true;
+}
+
+static bool ScanFloat(const char *&ptr, const char *end, float &f) {
+	// skip blanks, convert decimal float and advance ptr; return false if none
+	// up to 15 significant digits and exponents within +/-22 are exact in double,
+	// so one multiply or divide is correctly rounded; otherwise defer to strtod
+	static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	SkipBlanks(ptr, end);
+	const char *p = ptr;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	unsigned long long mantissa = 0;
+	int nDigits = 0, exponent = 0;
+	const char *digits = p;
+	for (; p < end && IsDigit(*p); p++)
+		if (nDigits < 19) {
+			mantissa = 10*mantissa+(*p-'0');
+			nDigits += mantissa != 0;
+		}
+		else
+			exponent++;
+	bool any = p > digits;
+	if (p < end && *p == '.') {
+		const char *fraction = ++p;
+		for (; p < end && IsDigit(*p); p++)
+			if (nDigits < 19) {
+				mantissa = 10*mantissa+(*p-'0');
+				nDigits += mantissa != 0;
+				exponent--;
+			}
+		any = any || p > fraction;
+	}
+	if (any && p < end && (*p == 'e' || *p == 'E')) {
+		const char *e = p+1;
+		int exp = 0;
+		if (ScanInt(e, end, exp)) {
+			exponent += exp;
+			p = e;
+		}
+	}
+	if (any && nDigits <= 15 && exponent >= -22 && exponent <= 22) {
+		double d = (double) mantissa;
+		d = exponent < 0? d/pow10[-exponent] : d*pow10[exponent];
+		f = (float) (negative? -d : d);
+		ptr = p;
+		return true;
+	}
+	// long mantissa, large exponent, inf, nan: copy the word and use strtod
+	char buf[100], *stop;
+	const char *w = ptr;
+	SkipWord(w, end);
+	int n = w-ptr < 99? (int) (w-ptr) : 99;
+	strncpy(buf, ptr, n);
+	buf[n] = 0;
+	double d = strtod(buf, &stop);
+	if (stop == buf)
+		return false;
+	f = (float) d;
+	ptr += stop-buf;
+	return true;
+}
+
+static int ScanKeyword(const char *&p, const char *end, char *word, int charLimit) {
+	// copy lower-case keyword into word (truncated to charLimit-1 chars), return full length
+	SkipBlanks(p, end);
+	const char *start = p;
+	SkipWord(p, end);
+	int nChars = (int) (p-start), n = nChars < charLimit-1? nChars : charLimit-1;
+	for (int i = 0; i < n; i++)
+		word[i] = start[i] >= 'A' && start[i] <= 'Z'? start[i]-'A'+'a' : start[i];
+	word[n] = 0;
+	return nChars;
+}
+
 // STL
 
-int ReadSTL(char *filename, vector<VertexSTL> &vertices) {
+static inline void SetTriangleSTL(VertexSTL *o, vec3 *v, vec3 &n) {
+	// store triangle v with facet normal n, swapping first and last vertex if clockwise about n
+	vec3 a(v[1]-v[0]), b(v[2]-v[1]);
+	int i0 = dot(cross(a, b), n) < 0? 2 : 0;
+	o[0].point = v[i0];
+	o[1].point = v[1];
+	o[2].point = v[2-i0];
+	o[0].normal = o[1].normal = o[2].normal = n;
+}
+
+static bool IsAsciiSTL(const char *data, size_t size, long long fileSize) {
+	// data holds at least the first 84 bytes of the file, or all of it if shorter; binary files
+	// may also begin with "solid", so trust a binary header whose count fits the file size
+	if (size >= 84) {
+		unsigned int n;
+		memcpy(&n, data+80, 4);
+		if (84+50*(long long) n == fileSize)
+			return false;
+	}
+	const char *p = data, *end = data+size;
+	char word[10];
+	while (p < end && IsSpace(*p))
+		p++;
+	return ScanKeyword(p, end, word, 10) == 5 && !strcmp(word, "solid");
+}
+
+class AsciiSTL {
+	// facet records from runs of whole lines; a facet may span runs
+	//   solid name
+	//     facet normal nx ny nz
+	//       outer loop
+	//         vertex x y z          (a loop of more than 3 is fanned)
+	//       endloop
+	//     endfacet
+	//   endsolid name
+public:
+	int lineNum;
+	AsciiSTL() : lineNum(0) { }
+	int Parse(const char *p, const char *end, vector<VertexSTL> &verts) {
+		// append triangles of the facets ended in p to end, return # appended
+		char word[10];
+		vec3 v[3];
+		int nTriangles = 0;
+		for (; p < end; SkipLine(p, end)) {
+			lineNum++;
+			ScanKeyword(p, end, word, 10);
+			if (!strcmp(word, "facet")) {
+				ScanKeyword(p, end, word, 10);		// "normal"
+				if (!ScanFloat(p, end, n.x) || !ScanFloat(p, end, n.y) || !ScanFloat(p, end, n.z))
+					n = vec3(0, 0, 0);
+				loop.resize(0);
+			}
+			else if (!strcmp(word, "vertex")) {
+				vec3 q;
+				if (ScanFloat(p, end, q.x) && ScanFloat(p, end, q.y) && ScanFloat(p, end, q.z))
+					loop.push_back(q);
+				else
+					printf("bad vertex, line %i\n", lineNum);
+			}
+			else if (!strcmp(word, "endfacet")) {
+				for (size_t k = 2; k < loop.size(); k++) {
+					size_t nVerts = verts.size();
+					v[0] = loop[0];
+					v[1] = loop[k-1];
+					v[2] = loop[k];
+					verts.resize(nVerts+3);
+					SetTriangleSTL(verts.data()+nVerts, v, n);
+					nTriangles++;
+				}
+				loop.resize(0);
+			}
+		}
+		return nTriangles;
+	}
+private:
+	vec3 n;
+	vector<vec3> loop;
+};
+
+int ReadSTL(char *filename, vector<VertexSTL> &vertices, int nThreads) {
 	// the facet normal should point outwards from the solid object; if this is zero,
 	// most software will calculate a normal from the ordered triangle vertices using the right-hand rule
     class Helper {
     public:
         bool status;
-		int nTriangles;
+		int nTriangles, nThreads;
 		vector<VertexSTL> *verts;
-        vector<string> vSpecs;                              // ASCII only
-        Helper(char *filename, vector<VertexSTL> *verts) : verts(verts) {
-			char line[1000], word[1000], *ptr = line;
-			ifstream inText(filename, ios::in);				// text default mode
-			inText.getline(line, 10);
-			bool ascii = ReadWord(ptr, word, 10) && !_stricmp(word, "solid");
-			ascii = false; // hmm!
-			if (ascii)
-				status = ReadASCII(inText);
-			inText.close();
-			if (!ascii) {
-				FILE *inBinary = fopen(filename, "rb");		// inText.setmode(ios::binary) fails
-				if (inBinary) {
-					nTriangles = 0;
-					status = ReadBinary(inBinary);
-					fclose(inBinary);
-				}
-				else
-					status = false;
-			}
+        Helper(char *filename, vector<VertexSTL> *verts, int nThreads) : nThreads(nThreads), verts(verts) {
+			nTriangles = 0;
+			MappedFile in(filename);
+			status = in.data != NULL && (IsAsciiSTL(in.data, in.size, in.size)?
+				ReadASCII(in.data, in.size) : ReadBinary(in.data, in.size));
         }
-        bool ReadASCII(ifstream &in) {
-			printf("can't read ASCII STL - tell prof\n");
+        bool ReadASCII(const char *data, size_t size) {
+			clock_t start = clock();
+			AsciiSTL parser;
+			verts->reserve(3*(size/250));				// about 250 bytes per facet
+			nTriangles = parser.Parse(data, data+size, *verts);
+			float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+			printf("read %i ASCII STL triangles in %.2f secs (%.0f/sec)\n", nTriangles, dt, dt > 0? nTriangles/dt : 0.f);
 			return true;
         }
-        bool ReadBinary(FILE *in) {
+        bool ReadBinary(const char *data, size_t size) {
                   // # bytes      use                  significance
                   // -------      ---                  ------------
                   //      80      header               none
@@ -161,246 +586,1748 @@ int ReadSTL(char *filename, vector<VertexSTL> &vertices) {
                   //      12      3 floats             vertex 3
                   //       2      unsigned short int   attribute (0)
                   // endianness is assumed to be little endian
-            // in.setmode(ios::binary); doc says setmode good, but compiler says not so
-			// sizeof(bool)=1, sizeof(char)=1, sizeof(short)=2, sizeof(int)=4, sizeof(float)=4
-            char buf[81];
-            unsigned int nTriangle = 0;//, vid1, vid2, vid3;
-            if (fread(buf, 1, 80, in) != 80) // header
-                return false;
-            if (fread(&nTriangles, sizeof(int), 1, in) != 1)
-                return false;
-            while (!feof(in)) {
-				vec3 v[3], n;
-                if (nTriangle == nTriangles)
-                    break;
-                if (nTriangles > 5000 && nTriangle && nTriangle%1000 == 0)
-					printf("\rread %i/%i triangles", nTriangle, nTriangles);
-                if (fread(&n.x, sizeof(float), 3, in) != 3)
-                    printf("\ncan't read triangle %d normal\n", nTriangle);
-				for (int k = 0; k < 3; k++)
-					if (fread(&v[k].x, sizeof(float), 3, in) != 3)
-                        printf("\ncan't read vid %d\n", verts->size());
-				vec3 a(v[1]-v[0]), b(v[2]-v[1]);
-				vec3 ntmp = cross(a, b);
-				if (dot(ntmp, n) < 0) {
-					vec3 vtmp = v[0];
-					v[0] = v[2];
-					v[2] = vtmp;
-				}
-				for (int k = 0; k < 3; k++)
-					verts->push_back(VertexSTL((float *) &v[k].x, (float *) &n.x));
-				unsigned short attribute;
-			    if (fread(&attribute, sizeof(short), 1, in) != 1)
-				    printf("\ncan't read attribute\n");
-				nTriangle++;
-            }
-			printf("\r\t\t\t\t\t\t\r");
+			// records are packed at 50 bytes, so floats are copied out rather than cast in place
+			const size_t headerSize = 84, recordSize = 50;
+			if (size < headerSize)
+				return false;
+			unsigned int nClaimed;
+			memcpy(&nClaimed, data+80, 4);
+			size_t nAvailable = (size-headerSize)/recordSize;
+			if (nClaimed > nAvailable) {
+				printf("STL header claims %u triangles, file holds %u\n", nClaimed, (unsigned) nAvailable);
+				nClaimed = (unsigned) nAvailable;
+			}
+			nTriangles = (int) nClaimed;
+			verts->resize(3*(size_t) nTriangles);
+			const char *records = data+headerSize;
+			VertexSTL *out = verts->data();
+			// decode and fix winding in blocks; each triangle is independent
+			ParallelFor(nTriangles, [&](int begin, int end) {
+				for (int t = begin; t < end; t++) {
+					const char *r = records+recordSize*t;
+					vec3 v[3], n;
+					memcpy(&n.x, r, 12);
+					for (int k = 0; k < 3; k++)
+						memcpy(&v[k].x, r+12+12*k, 12);
+					SetTriangleSTL(out+3*t, v, n);
+				}
+			}, 1<<14, nThreads);
             return true;
         }
     };
-    Helper h(filename, &vertices);
+    Helper h(filename, &vertices, nThreads);
     return h.nTriangles;
 } // end ReadSTL
 
 // ASCII OBJ
 
-#include <map>
-struct Compare {
-	bool operator() (const int3 &a, const int3 &b) const {
-		return (a.i1==b.i1? (a.i2==b.i2? a.i3 < b.i3 : a.i2 < b.i2) : a.i1 < b.i1);
+class VidMap {
+	// open-addressing (linear probe) hash of int triples (vid/tid/nid, or weld cell) to an index;
+	// one flat array of slots, so no per-corner allocation and at most a few probes per lookup
+public:
+	VidMap(int expected = 0) : count(0) {
+		int capacity = 16;
+		while (capacity < 2*expected)			// keep load under 1/2
+			capacity *= 2;
+		slots.assign(capacity, Slot());
+		mask = capacity-1;
+	}
+	int Find(const int3 &key, int newId) {
+		// return the id stored for key; if absent, store newId and return it
+		for (unsigned i = Hash(key) & mask;; i = (i+1) & mask) {
+			Slot &s = slots[i];
+			if (s.id < 0) {
+				s.key = key;
+				s.id = newId;
+				if (2*++count > (int) slots.size())
+					Grow();
+				return newId;
+			}
+			if (s.key == key)
+				return s.id;
+		}
+	}
+	static unsigned Hash(const int3 &k) {
+		unsigned h = (unsigned) k.i1*0x9e3779b1u+(unsigned) k.i2;
+		h = h*0x85ebca77u+(unsigned) k.i3;
+		h ^= h >> 16;							// finalize (as murmur3)
+		h *= 0x7feb352du;
+		h ^= h >> 15;
+		return h;
+	}
+private:
+	struct Slot {
+		int3 key;
+		int id;									// -1 if empty
+		Slot() : id(-1) { }
+	};
+	vector<Slot> slots;
+	unsigned mask;
+	int count;
+	void Grow() {
+		vector<Slot> old(2*slots.size());
+		old.swap(slots);
+		mask = (unsigned) slots.size()-1;
+		for (size_t k = 0; k < old.size(); k++)
+			if (old[k].id >= 0) {
+				unsigned i = Hash(old[k].key) & mask;
+				while (slots[i].id >= 0)
+					i = (i+1) & mask;
+				slots[i] = old[k];
+			}
 	}
 };
 
-typedef std::map<int3, int, Compare> VidMap;
+struct ObjChunk {
+	// records parsed from a run of whole lines; face corners keep the file's global indices
+	const char		*begin, *end;
+	int				 nLines, errorLine;			// errorLine is chunk-relative, 0 if none
+	vector<vec3>	 vertices, normals;
+	vector<vec2>	 textures;
+	vector<int3>	 corners;					// vid, tid, nid for each face corner, from 0
+	vector<int>		 faceSizes;					// # corners in each face
+	vector<int2>	 groups;					// # faces preceding, group id for each g record
+	vector<int>		 badLines;					// chunk-relative lines with badly formatted faces
+	ObjChunk() : begin(NULL), end(NULL), nLines(0), errorLine(0) { }
+};
+
+static void ParseObjChunk(ObjChunk &c) {
+	const char *ptr = c.begin, *end = c.end;
+	vec2 t;
+	vec3 v;
+	static const int WordLim = 100;
+	char word[WordLim];
+	for (c.nLines = 0; ptr < end; SkipLine(ptr, end)) {
+		int lineNum = ++c.nLines;
+		int nChars = ScanKeyword(ptr, end, word, WordLim);
+		if (!nChars || *word == '#')               // skip blank line, comment
+			continue;
+		if (nChars > 2)                            // unrecognized attribute
+			continue;
+		if (!strcmp(word, "g")) {
+			// this implementation: group field significant only if integer
+			// .obj format, however, supported arbitrary string identifier
+			int group;
+			SkipBlanks(ptr, end);
+			if (ScanInt(ptr, end, group))
+				c.groups.push_back(int2((int) c.faceSizes.size(), group));
+		}
+		else if (!strcmp(word, "v")) {             // read vertex coordinates
+			if (!ScanFloat(ptr, end, v.x) || !ScanFloat(ptr, end, v.y) || !ScanFloat(ptr, end, v.z)) {
+				c.errorLine = lineNum;
+				return;
+			}
+			c.vertices.push_back(v);
+		}
+		else if (!strcmp(word, "vn")) {            // read vertex normal
+			if (!ScanFloat(ptr, end, v.x) || !ScanFloat(ptr, end, v.y) || !ScanFloat(ptr, end, v.z)) {
+				c.errorLine = lineNum;
+				return;
+			}
+			c.normals.push_back(v);
+		}
+		else if (!strcmp(word, "vt")) {            // read vertex texture
+			if (!ScanFloat(ptr, end, t.x) || !ScanFloat(ptr, end, t.y)) {
+				c.errorLine = lineNum;
+				return;
+			}
+			c.textures.push_back(t);
+		}
+		else if (!strcmp(word, "f")) {             // read triangle or polygon
+			int nCorners = 0;
+			for (;;) {                             // read arbitrary # face vid/tid/nid
+				SkipBlanks(ptr, end);
+				if (ptr == end || *ptr == '\n')
+					break;
+				// use of / is optional (ie, '3' is same as '3/3/3')
+				// convert to vid, tid, nid indices (vertex, texture, normal)
+				int vid = 0, tid, nid;
+				if (!ScanInt(ptr, end, vid) || !vid)
+					break;
+				tid = nid = vid;
+				if (ptr < end && *ptr == '/') {
+					if (++ptr < end && *ptr != '/' && !ScanInt(ptr, end, tid))
+						tid = 0;
+					if (ptr < end && *ptr == '/' && ++ptr < end && !IsSpace(*ptr) && !ScanInt(ptr, end, nid))
+						nid = 0;
+				}
+				SkipWord(ptr, end);
+				// standard .obj is indexed from 1, mesh indexes from 0
+				if (vid < 1 || tid < 1 || nid < 1) {
+					c.badLines.push_back(lineNum);
+					break;
+				}
+				c.corners.push_back(int3(vid-1, tid-1, nid-1));
+				nCorners++;
+			}
+			c.faceSizes.push_back(nCorners);
+		}
+		// else unsupported attribute in object file
+	}
+}
+
+static int Triangulate(const int *vids, int nids, vector<vec3> &points, vector<vec3> *normals, int3 *out) {
+	// write face of nids points as nids-2 triangles to out; return # written
+	if (nids == 3) {
+		int id1 = vids[0], id2 = vids[1], id3 = vids[2];
+		if (normals && (int) normals->size() > id1) {
+			vec3 &p1 = points[id1], &p2 = points[id2], &p3 = points[id3];
+			vec3 a(p2-p1), b(p3-p2), n(cross(a, b));
+			if (dot(n, (*normals)[id1]) < 0) {
+				int tmp = id1;
+				id1 = id3;
+				id3 = tmp;
+			}
+		}
+		// create triangle
+		out[0] = int3(id1, id2, id3);
+		return 1;
+	}
+	// create polygon as nvids-2 triangles
+	for (int i = 1; i < nids-1; i++)
+		out[i-1] = int3(vids[0], vids[i], vids[(i+1)%nids]);
+	return nids > 2? nids-2 : 0;
+}
+
+static int AddPolygon(const int *vids, int nids, vector<vec3> &points, vector<int3> &triangles, vector<vec3> *normals) {
+	// append face of nids points as nids-2 triangles; return # appended
+	size_t n = triangles.size();
+	triangles.resize(n+(nids > 2? nids-2 : 0));
+	return Triangulate(vids, nids, points, normals, triangles.data()+n);
+}
+
+template<class T> static void Append(vector<T> &a, vector<T> &b) {
+	a.insert(a.end(), b.begin(), b.end());
+	vector<T>().swap(b);                           // release chunk memory as we go
+}
+
+static void MergeObjFaces(ObjChunk &c, vector<vec3> &tmpVertices, vector<vec3> &tmpNormals, vector<vec2> &tmpTextures,
+						  VidMap &vidMap, int &group, vector<vec3> &points, vector<int3> &triangles,
+						  vector<vec3> *normals, vector<vec2> *textures, vector<int> *triangleGroups) {
+	// append the faces of chunk c, following those of the chunks before it; corners new to vidMap
+	// become points; group is carried from chunk to chunk; c.corners is freed
+	vector<int> vids;
+	const int3 *corner = c.corners.empty()? NULL : &c.corners[0];
+	size_t nGroups = c.groups.size(), g = 0;
+	for (int f = 0; f < (int) c.faceSizes.size(); f++) {
+		for (; g < nGroups && c.groups[g].i1 == f; g++)
+			group = c.groups[g].i2;
+		int nCorners = c.faceSizes[f];
+		vids.resize(0);
+		for (int k = 0; k < nCorners; k++) {
+			int3 key = corner[k];
+			if (key.i1 >= (int) tmpVertices.size()) {
+				printf("bad vertex %d in face\n", key.i1+1);
+				break;
+			}
+			int nvrts = points.size(), id = vidMap.Find(key, nvrts);
+			if (id == nvrts) {
+				points.push_back(tmpVertices[key.i1]);
+				if (normals && (int) tmpNormals.size() > key.i3)
+					normals->push_back(tmpNormals[key.i3]);
+				if (textures && (int) tmpTextures.size() > key.i2)
+					textures->push_back(tmpTextures[key.i2]);
+			}
+			vids.push_back(id);
+		}
+		corner += nCorners;
+		int nTris = AddPolygon(vids.empty()? NULL : &vids[0], (int) vids.size(), points, triangles, normals);
+		if (triangleGroups)
+			triangleGroups->insert(triangleGroups->end(), nTris, group);
+	}
+	for (; g < nGroups; g++)
+		group = c.groups[g].i2;
+	vector<int3>().swap(c.corners);
+}
+
+static bool MergeObjChunks(vector<ObjChunk> &chunks, vector<vec3> &tmpVertices, vector<vec3> &tmpNormals,
+						   vector<vec2> &tmpTextures, vector<vec3> &points, vector<int3> &triangles,
+						   vector<vec3> *normals, vector<vec2> *textures, vector<int> *triangleGroups, int nThreads) {
+	// the face merge of ReadAsciiObj on nThreads threads, with the serial merge's result: corners are
+	// deduplicated within each chunk, then across chunks with their distinct corners spread over buckets
+	// by hash (as WeldSTL); points are numbered in order of first use by a prefix sum over chunks, and
+	// triangles and groups are written at each chunk's offset; return false, having changed nothing, if
+	// the outputs aren't empty or a face has a bad vertex index or normal or texture indices are valid
+	// for some corners only (the serial merge handles these)
+	if (!points.empty() || !triangles.empty() || (normals && !normals->empty()) ||
+		(textures && !textures->empty()) || (triangleGroups && !triangleGroups->empty()))
+		return false;
+	const int nBuckets = 256;
+	int nChunks = (int) chunks.size(), nV = (int) tmpVertices.size(), nN = (int) tmpNormals.size(), nT = (int) tmpTextures.size();
+	vector<vector<int> > cornerIds(nChunks);		// for each corner, its index in its chunk's keys
+	vector<vector<int3> > keys(nChunks);			// each chunk's distinct corners in order of first use
+	vector<int> nBad(nChunks, 0), nValidN(nChunks, 0), nValidT(nChunks, 0), triStart(nChunks+1, 0), keyStart(nChunks+1, 0);
+	ParallelFor(nChunks, [&](int i0, int i1) {
+		for (int i = i0; i < i1; i++) {
+			ObjChunk &c = chunks[i];
+			int nCorners = (int) c.corners.size();
+			VidMap map(nCorners/4);
+			cornerIds[i].resize(nCorners);
+			for (int k = 0; k < nCorners; k++) {
+				int3 &key = c.corners[k];
+				nBad[i] += key.i1 >= nV;
+				nValidN[i] += key.i3 < nN;
+				nValidT[i] += key.i2 < nT;
+				int nKeys = (int) keys[i].size();
+				if ((cornerIds[i][k] = map.Find(key, nKeys)) == nKeys)
+					keys[i].push_back(key);
+			}
+			for (size_t f = 0; f < c.faceSizes.size(); f++)
+				triStart[i+1] += c.faceSizes[f] > 2? c.faceSizes[f]-2 : 0;
+		}
+	}, 1, nThreads);
+	int nCorners = 0, nN0 = 0, nT0 = 0;
+	for (int i = 0; i < nChunks; i++) {
+		if (nBad[i])
+			return false;
+		nCorners += (int) chunks[i].corners.size();
+		nN0 += nValidN[i];
+		nT0 += nValidT[i];
+		keyStart[i+1] = keyStart[i]+(int) keys[i].size();
+		triStart[i+1] += triStart[i];
+	}
+	if ((normals && nN0 && nN0 != nCorners) || (textures && nT0 && nT0 != nCorners))
+		return false;
+	bool setNormals = normals && nN0 > 0, setTextures = textures && nT0 > 0;
+	// all distinct corners, counted per chunk and bucket
+	int nKeys = keyStart[nChunks];
+	vector<int3> allKeys(nKeys);
+	vector<unsigned char> buckets(nKeys);
+	vector<int> counts(nChunks*nBuckets, 0), sorted(nKeys), first(nKeys), ids(nKeys);
+	ParallelFor(nChunks, [&](int i0, int i1) {
+		for (int i = i0; i < i1; i++) {
+			int *count = &counts[i*nBuckets];
+			for (int j = 0, p = keyStart[i]; j < (int) keys[i].size(); j++, p++) {
+				allKeys[p] = keys[i][j];
+				count[buckets[p] = VidMap::Hash(allKeys[p]) >> 24]++;
+			}
+			vector<int3>().swap(keys[i]);
+		}
+	}, 1, nThreads);
+	// counts become offsets: buckets in order, chunks in order within a bucket
+	vector<int> bucketStart(nBuckets+1);
+	int offset = 0;
+	for (int k = 0; k < nBuckets; k++) {
+		bucketStart[k] = offset;
+		for (int i = 0; i < nChunks; i++) {
+			int n = counts[i*nBuckets+k];
+			counts[i*nBuckets+k] = offset;
+			offset += n;
+		}
+	}
+	bucketStart[nBuckets] = offset;
+	ParallelFor(nChunks, [&](int i0, int i1) {
+		for (int i = i0; i < i1; i++) {
+			int *next = &counts[i*nBuckets];
+			for (int p = keyStart[i]; p < keyStart[i+1]; p++)
+				sorted[next[buckets[p]]++] = p;
+		}
+	}, 1, nThreads);
+	// in each bucket, the earliest of equal corners is a point, the others refer to it
+	ParallelFor(nBuckets, [&](int k0, int k1) {
+		for (int k = k0; k < k1; k++) {
+			VidMap map(bucketStart[k+1]-bucketStart[k]);
+			for (int j = bucketStart[k]; j < bucketStart[k+1]; j++)
+				first[sorted[j]] = map.Find(allKeys[sorted[j]], sorted[j]);
+		}
+	}, 1, nThreads);
+	// number the points in file order, then the others from the earlier corner they refer to
+	vector<int> pointStart(nChunks+1, 0);
+	ParallelFor(nChunks, [&](int i0, int i1) {
+		for (int i = i0; i < i1; i++)
+			for (int p = keyStart[i]; p < keyStart[i+1]; p++)
+				pointStart[i+1] += first[p] == p;
+	}, 1, nThreads);
+	for (int i = 0; i < nChunks; i++)
+		pointStart[i+1] += pointStart[i];
+	int nPoints = pointStart[nChunks];
+	points.resize(nPoints);
+	if (setNormals)
+		normals->resize(nPoints);
+	if (setTextures)
+		textures->resize(nPoints);
+	ParallelFor(nChunks, [&](int i0, int i1) {
+		for (int i = i0; i < i1; i++) {
+			int id = pointStart[i];
+			for (int p = keyStart[i]; p < keyStart[i+1]; p++)
+				if (first[p] == p) {
+					int3 &key = allKeys[p];
+					points[id] = tmpVertices[key.i1];
+					if (setNormals)
+						(*normals)[id] = tmpNormals[key.i3];
+					if (setTextures)
+						(*textures)[id] = tmpTextures[key.i2];
+					ids[p] = id++;
+				}
+		}
+	}, 1, nThreads);
+	ParallelFor(nChunks, [&](int i0, int i1) {
+		for (int i = i0; i < i1; i++)
+			for (int p = keyStart[i]; p < keyStart[i+1]; p++)
+				if (first[p] != p)
+					ids[p] = ids[first[p]];
+	}, 1, nThreads);
+	// each chunk starts in the group the previous chunks leave
+	vector<int> startGroup(nChunks);
+	for (int i = 0, group = 0; i < nChunks; i++) {
+		startGroup[i] = group;
+		if (!chunks[i].groups.empty())
+			group = chunks[i].groups.back().i2;
+	}
+	triangles.resize(triStart[nChunks]);
+	if (triangleGroups)
+		triangleGroups->resize(triStart[nChunks]);
+	ParallelFor(nChunks, [&](int i0, int i1) {
+		vector<int> vids;
+		for (int i = i0; i < i1; i++) {
+			ObjChunk &c = chunks[i];
+			const int *cornerId = cornerIds[i].empty()? NULL : &cornerIds[i][0];
+			int group = startGroup[i], t = triStart[i];
+			size_t nGroups = c.groups.size(), g = 0;
+			for (int f = 0; f < (int) c.faceSizes.size(); f++) {
+				for (; g < nGroups && c.groups[g].i1 == f; g++)
+					group = c.groups[g].i2;
+				int nids = c.faceSizes[f];
+				vids.resize(nids);
+				for (int k = 0; k < nids; k++)
+					vids[k] = ids[keyStart[i]+cornerId[k]];
+				cornerId += nids;
+				int nTris = Triangulate(vids.empty()? NULL : &vids[0], nids, points, normals, triangles.data()+t);
+				if (triangleGroups)
+					for (int n = 0; n < nTris; n++)
+						(*triangleGroups)[t+n] = group;
+				t += nTris;
+			}
+			vector<int3>().swap(c.corners);
+			vector<int>().swap(cornerIds[i]);
+		}
+	}, 1, nThreads);
+	return true;
+}
 
 bool ReadAsciiObj(char          *filename,
 				  vector<vec3>	&points,
 				  vector<int3>	&triangles,
 				  vector<vec3>	*normals,
 				  vector<vec2>	*textures,
-				  vector<int>	*triangleGroups) {
+				  vector<int>	*triangleGroups,
+				  int			 nThreads) {
 	// read 'object' file (Alias/Wavefront .obj format); return true if successful;
 	// polygons are assumed simple (ie, no holes and not self-intersecting);
 	// some file attributes are not supported by this implementation;
 	// obj format indexes vertices from 1
-	FILE *in = fopen(filename, "r");
-	if (!in)
+	// the file is memory-mapped and split at line boundaries into chunks that are
+	// scanned in place, concurrently if nThreads != 1; chunks are then merged (concurrently
+	// too, by MergeObjChunks) as if in file order, so the result does not depend on the
+	// number of threads
+	MappedFile file(filename);
+	if (!file.data)
 		return false;
-	vec2 t;
-	vec3 v;
-	int group = 0;
-	static const int LineLim = 1000, WordLim = 100;
-	char line[LineLim], word[WordLim];
+	static const size_t MinChunkSize = 1 << 20;
+	int nChunks = nThreads == 1? 1 : 4*NumThreads(nThreads);
+	if ((size_t) nChunks > file.size/MinChunkSize)
+		nChunks = file.size > MinChunkSize? (int) (file.size/MinChunkSize) : 1;
+	vector<ObjChunk> chunks(nChunks);
+	const char *start = file.data, *end = file.data+file.size;
+	for (int i = 0; i < nChunks; i++) {
+		const char *stop = i == nChunks-1? end : file.data+(file.size/nChunks)*(i+1);
+		if (stop < start)
+			stop = start;
+		if (stop < end)
+			SkipLine(stop, end);                   // end chunk after a newline
+		chunks[i].begin = start;
+		chunks[i].end = start = stop;
+	}
+	ParallelFor(nChunks, [&](int b, int e) {
+		for (int i = b; i < e; i++)
+			ParseObjChunk(chunks[i]);
+	}, 1, nThreads);
+	// report errors in file order
+	for (int i = 0, lineBase = 0; i < nChunks; lineBase += chunks[i++].nLines) {
+		ObjChunk &c = chunks[i];
+		for (size_t k = 0; k < c.badLines.size(); k++)
+			printf("bad format on line %d\n", lineBase+c.badLines[k]);
+		if (c.errorLine) {
+			printf("bad line %d in object file", lineBase+c.errorLine);
+			return false;
+		}
+	}
+	// gather vertices, normals, textures
 	vector<vec3> tmpVertices, tmpNormals;
 	vector<vec2> tmpTextures;
-	VidMap vidMap;
-	for (int lineNum = 0;; lineNum++) {
-		if (feof(in))                              // hit end of file
-			break;
-		fgets(line, LineLim, in);                  // \ line continuation not supported
-		if (strlen(line) >= LineLim-1) {           // getline reads LineLim-1 max
-			printf("line %d too long", lineNum);
+	for (int i = 0; i < nChunks; i++) {
+		Append(tmpVertices, chunks[i].vertices);
+		Append(tmpNormals, chunks[i].normals);
+		Append(tmpTextures, chunks[i].textures);
+	}
+	// merge faces in file order
+	if (nChunks > 1 && MergeObjChunks(chunks, tmpVertices, tmpNormals, tmpTextures, points, triangles,
+									  normals, textures, triangleGroups, nThreads))
+		return true;
+	VidMap vidMap((int) tmpVertices.size());		// most files have about one corner per vertex
+	int group = 0;
+	for (int ic = 0; ic < nChunks; ic++)
+		MergeObjFaces(chunks[ic], tmpVertices, tmpNormals, tmpTextures, vidMap, group, points, triangles,
+					  normals, textures, triangleGroups);
+	//if (vertexNormals)
+	//	SetVertexNormals(vertices, triangles, *vertexNormals);
+	return true;
+} // end ReadAsciiObj
+
+// PLY
+
+enum PlyType {PlyNone, PlyInt8, PlyUint8, PlyInt16, PlyUint16, PlyInt32, PlyUint32, PlyFloat32, PlyFloat64};
+
+static const int PlySizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+
+static PlyType PlyTypeOf(const char *name) {
+	static const char *names[][2] = {
+		{"char", "int8"}, {"uchar", "uint8"}, {"short", "int16"}, {"ushort", "uint16"},
+		{"int", "int32"}, {"uint", "uint32"}, {"float", "float32"}, {"double", "float64"}};
+	for (int i = 0; i < 8; i++)
+		if (!strcmp(name, names[i][0]) || !strcmp(name, names[i][1]))
+			return (PlyType) (i+1);
+	return PlyNone;
+}
+
+static inline double PlyValue(const char *p, PlyType type) {
+	// binary little-endian value (as is the host)
+	switch (type) {
+		case PlyInt8:    return (signed char) *p;
+		case PlyUint8:   return (unsigned char) *p;
+		case PlyInt16:   { short v; memcpy(&v, p, 2); return v; }
+		case PlyUint16:  { unsigned short v; memcpy(&v, p, 2); return v; }
+		case PlyInt32:   { int v; memcpy(&v, p, 4); return v; }
+		case PlyUint32:  { unsigned v; memcpy(&v, p, 4); return v; }
+		case PlyFloat32: { float v; memcpy(&v, p, 4); return v; }
+		case PlyFloat64: { double v; memcpy(&v, p, 8); return v; }
+		default:         return 0;
+	}
+}
+
+static inline int PlyIndex(const char *p, PlyType type) {
+	// as PlyValue, without rounding indices above 2^24 through float
+	switch (type) {
+		case PlyInt32: case PlyUint32: { int v; memcpy(&v, p, 4); return v; }
+		default:       return (int) PlyValue(p, type);
+	}
+}
+
+struct PlyProperty {
+	char	name[32];
+	PlyType	type;							// of the value, or of the list items
+	PlyType	countType;						// of the list count, PlyNone if not a list
+	int		offset;							// in a binary record, -1 if after a list
+};
+
+struct PlyElement {
+	char	name[32];
+	int		count;
+	int		recordSize;						// binary bytes per record, 0 if variable (has a list)
+	vector<PlyProperty> properties;
+	int Find(const char *name1, const char *name2 = NULL, const char *name3 = NULL) {
+		// index of first property with one of the names, -1 if none
+		for (int i = 0; i < (int) properties.size(); i++) {
+			const char *n = properties[i].name;
+			if (!properties[i].countType && (!strcmp(n, name1) || (name2 && !strcmp(n, name2)) || (name3 && !strcmp(n, name3))))
+				return i;
+		}
+		return -1;
+	}
+};
+
+static inline void SkipSpaces(const char *&p, const char *end) {
+	while (p < end && IsSpace(*p))
+		p++;
+}
+
+class PlyReader {
+public:
+	const char *ptr, *end;
+	bool ascii;
+	vector<double> values;					// scalar properties of the current record
+	vector<int> list;						// items of the last list read, as int
+	PlyReader(const char *ptr, const char *end, bool ascii) : ptr(ptr), end(end), ascii(ascii) { }
+	bool Record(PlyElement &e, int listProperty = -1) {
+		// read the next record: scalar values into values (by property), items of listProperty
+		// into list; other lists are skipped; return false if the data end early
+		values.resize(e.properties.size());
+		if (!ascii && e.recordSize) {
+			if (end-ptr < e.recordSize)
+				return false;
+			for (size_t i = 0; i < e.properties.size(); i++)
+				values[i] = PlyValue(ptr+e.properties[i].offset, e.properties[i].type);
+			ptr += e.recordSize;
+			return true;
+		}
+		for (int i = 0; i < (int) e.properties.size(); i++) {
+			PlyProperty &pr = e.properties[i];
+			if (!pr.countType) {
+				if (!Scalar(pr.type, values[i]))
+					return false;
+				continue;
+			}
+			double count;
+			if (!Scalar(pr.countType, count) || count < 0)
+				return false;
+			int n = (int) count;
+			if (i == listProperty)
+				list.resize(n);
+			if (!ascii) {
+				int size = PlySizes[pr.type];
+				if (end-ptr < (long long) n*size)
+					return false;
+				if (i == listProperty)
+					for (int k = 0; k < n; k++)
+						list[k] = PlyIndex(ptr+k*size, pr.type);
+				ptr += n*size;
+				continue;
+			}
+			for (int k = 0; k < n; k++) {
+				SkipSpaces(ptr, end);
+				int v;
+				if (i == listProperty) {
+					if (!ScanInt(ptr, end, v))
+						return false;
+					list[k] = v;
+				}
+				else
+					SkipWord(ptr, end);
+			}
+		}
+		return true;
+	}
+	bool Scalar(PlyType type, double &v) {
+		if (!ascii) {
+			if (end-ptr < PlySizes[type])
+				return false;
+			v = PlyValue(ptr, type);
+			ptr += PlySizes[type];
+			return true;
+		}
+		SkipSpaces(ptr, end);
+		float f;
+		if (!ScanFloat(ptr, end, f))
 			return false;
+		v = f;
+		return true;
+	}
+};
+
+static bool ReadPlyHeader(const char *&ptr, const char *end, bool &ascii, vector<PlyElement> &elements) {
+	// parse header through end_header; set ptr to the data that follow
+	static const int WordLim = 32;
+	char word[WordLim];
+	if (ScanKeyword(ptr, end, word, WordLim) != 3 || strcmp(word, "ply"))
+		return false;
+	bool format = false;
+	for (SkipLine(ptr, end); ptr < end; SkipLine(ptr, end)) {
+		ScanKeyword(ptr, end, word, WordLim);
+		if (!strcmp(word, "end_header")) {
+			SkipLine(ptr, end);
+			return format;
 		}
-		char *ptr = line;
-		if (!ReadWord(ptr, word, WordLim))
-			continue;
-		else if (*word == '#')
-			continue;
-		else if (!_stricmp(word, "g"))
-			// this implementation: group field significant only if integer
-			// .obj format, however, supported arbitrary string identifier
-			sscanf(ptr, "%d", &group);
-		else if (!_stricmp(word, "v")) {           // read vertex coordinates
-			if (sscanf(ptr, "%g%g%g", &v.x, &v.y, &v.z) != 3) {
-				printf("bad line %d in object file", lineNum);
+		if (!strcmp(word, "format")) {
+			ScanKeyword(ptr, end, word, WordLim);
+			ascii = !strcmp(word, "ascii");
+			format = ascii || !strcmp(word, "binary_little_endian");
+			if (!format) {
+				printf("unsupported PLY format %s\n", word);
 				return false;
 			}
-			tmpVertices.push_back(vec3(v.x, v.y, v.z));
 		}
-		else if (!_stricmp(word, "vn")) {          // read vertex normal
-			if (sscanf(ptr, "%g%g%g", &v.x, &v.y, &v.z) != 3) {
-				printf("bad line %d in object file", lineNum);
+		else if (!strcmp(word, "element")) {
+			PlyElement e;
+			ScanKeyword(ptr, end, e.name, WordLim);
+			SkipBlanks(ptr, end);
+			if (!ScanInt(ptr, end, e.count) || e.count < 0)
 				return false;
+			e.recordSize = 0;
+			elements.push_back(e);
+		}
+		else if (!strcmp(word, "property")) {
+			if (elements.empty())
+				return false;
+			PlyElement &e = elements.back();
+			PlyProperty p;
+			p.countType = PlyNone;
+			ScanKeyword(ptr, end, word, WordLim);
+			if (!strcmp(word, "list")) {
+				ScanKeyword(ptr, end, word, WordLim);
+				p.countType = PlyTypeOf(word);
+				ScanKeyword(ptr, end, word, WordLim);
+				if (!p.countType)
+					return false;
 			}
-			tmpNormals.push_back(vec3(v.x, v.y, v.z));
+			if (!(p.type = PlyTypeOf(word)))
+				return false;
+			ScanKeyword(ptr, end, p.name, WordLim);
+			// offsets hold until the first list
+			bool fixed = e.properties.empty() || e.recordSize > 0;
+			p.offset = fixed? e.recordSize : -1;
+			e.recordSize = fixed && !p.countType? e.recordSize+PlySizes[p.type] : 0;
+			e.properties.push_back(p);
 		}
-		else if (!_stricmp(word, "vt")) {          // read vertex texture
-			if (sscanf(ptr, "%g%g", &t.x, &t.y) != 2) {
-				printf("bad line in object file");
+		// else comment, obj_info
+	}
+	return false;
+}
+
+static bool PlyFloats(PlyElement &e, int i1, int i2, int i3) {
+	// are properties i1, i2, (i3, if >= 0) consecutive float32 in a fixed size record?
+	vector<PlyProperty> &p = e.properties;
+	return e.recordSize && p[i1].type == PlyFloat32 && p[i2].type == PlyFloat32 && p[i2].offset == p[i1].offset+4 &&
+		   (i3 < 0 || (p[i3].type == PlyFloat32 && p[i3].offset == p[i1].offset+8));
+}
+
+static void CopyFloats(const char *data, int recordSize, int offset, int count, int dim, float *out) {
+	// dim floats per record, recordSize apart, to out
+	if (recordSize == 4*dim && offset == 0) {
+		memcpy(out, data, (size_t) count*recordSize);
+		return;
+	}
+	for (int i = 0; i < count; i++, out += dim)
+		memcpy(out, data+(size_t) i*recordSize+offset, 4*dim);
+}
+
+bool ReadPly(const char     *filename,
+			 vector<vec3>	&points,
+			 vector<int3>	&triangles,
+			 vector<vec3>	*normals,
+			 vector<vec2>	*textures) {
+	// the file is memory-mapped; binary vertex properties that are consecutive floats are copied
+	// as blocks, and triangle faces with int indices are read without conversion
+	MappedFile file(filename);
+	if (!file.data)
+		return false;
+	points.resize(0);
+	triangles.resize(0);
+	if (normals)
+		normals->resize(0);
+	if (textures)
+		textures->resize(0);
+	const char *ptr = file.data, *end = file.data+file.size;
+	bool ascii = false;
+	vector<PlyElement> elements;
+	if (!ReadPlyHeader(ptr, end, ascii, elements)) {
+		printf("bad PLY header in %s\n", filename);
+		return false;
+	}
+	PlyReader r(ptr, end, ascii);
+	bool haveVertices = false;
+	for (size_t ie = 0; ie < elements.size(); ie++) {
+		PlyElement &e = elements[ie];
+		if (!strcmp(e.name, "vertex")) {
+			int x = e.Find("x"), y = e.Find("y"), z = e.Find("z");
+			int nx = e.Find("nx"), ny = e.Find("ny"), nz = e.Find("nz");
+			int u = e.Find("u", "s", "texture_u"), v = e.Find("v", "t", "texture_v");
+			if (x < 0 || y < 0 || z < 0) {
+				printf("PLY vertex without x, y, z\n");
 				return false;
 			}
-			tmpTextures.push_back(vec2(t.x, t.y));
-		}
-		else if (!_stricmp(word, "f")) {           // read triangle or polygon
-		//	printf("line = %s\n", line);
-			static vector<int> vids;
-			vids.resize(0);
-			while (ReadWord(ptr, word, WordLim)) { // read arbitrary # face vid/tid/nid        
-			//	printf("word = %s\n", word);
-				// set texture and normal pointers to preceding /
-				char *tPtr = strchr(word+1, '/');  // pointer to /, or null if not found
-				char *nPtr = tPtr? strchr(tPtr+1, '/') : NULL;
-				// use of / is optional (ie, '3' is same as '3/3/3')
-				// convert to vid, tid, nid indices (vertex, texture, normal)
-				int vid = atoi(word);
-				if (!vid) // atoi returns 0 if failure to convert
-					break;
-				int tid = tPtr && *++tPtr != '/'? atoi(tPtr) : vid;
-				int nid = nPtr && *++nPtr != 0? atoi(nPtr) : vid;
-				// standard .obj is indexed from 1, mesh indexes from 0
-				vid--;
-				tid--;
-				nid--;
-				if (vid < 0 || tid < 0 || nid < 0) { // atoi = 0 is conversion failure
-					printf("bad format on line %d\n", lineNum);
-					break;
+			bool doNormals = normals && nx >= 0 && ny >= 0 && nz >= 0, doTextures = textures && u >= 0 && v >= 0;
+			points.resize(e.count);
+			if (doNormals)
+				normals->resize(e.count);
+			if (doTextures)
+				textures->resize(e.count);
+			if (!ascii && e.recordSize && PlyFloats(e, x, y, z) && (!doNormals || PlyFloats(e, nx, ny, nz)) &&
+				(!doTextures || PlyFloats(e, u, v, -1))) {
+				// bulk copy
+				if (end-r.ptr < (long long) e.count*e.recordSize) {
+					printf("PLY vertices missing\n");
+					return false;
 				}
-				int3 key(vid, tid, nid);
-				VidMap::iterator it = vidMap.find(key);
-				if (it == vidMap.end()) {
-					int nvrts = points.size();
-					vidMap[key] = nvrts;
-					points.push_back(tmpVertices[vid]);
-					if (normals && (int) tmpNormals.size() > nid)
-						normals->push_back(tmpNormals[nid]);
-					if (textures && (int) tmpTextures.size() > tid)
-						textures->push_back(tmpTextures[tid]);
-					vids.push_back(nvrts);
+				if (e.count) {
+					CopyFloats(r.ptr, e.recordSize, e.properties[x].offset, e.count, 3, &points[0].x);
+					if (doNormals)
+						CopyFloats(r.ptr, e.recordSize, e.properties[nx].offset, e.count, 3, &(*normals)[0].x);
+					if (doTextures)
+						CopyFloats(r.ptr, e.recordSize, e.properties[u].offset, e.count, 2, &(*textures)[0].x);
 				}
-				else
-					vids.push_back(it->second);
-			}
-			int nids = vids.size();
-			if (nids == 3) {
-				int id1 = vids[0], id2 = vids[1], id3 = vids[2];
-				if (normals && (int) normals->size() > id1) {
-					vec3 &p1 = points[id1], &p2 = points[id2], &p3 = points[id3];
-					vec3 a(p2-p1), b(p3-p2), n(cross(a, b));
-					if (dot(n, (*normals)[id1]) < 0) {
-						int tmp = id1;
-						id1 = id3;
-						id3 = id1;
+				r.ptr += (size_t) e.count*e.recordSize;
+			}
+			else
+				for (int i = 0; i < e.count; i++) {
+					if (!r.Record(e)) {
+						printf("PLY vertex %i missing\n", i);
+						return false;
 					}
+					double *d = &r.values[0];
+					points[i] = vec3((float) d[x], (float) d[y], (float) d[z]);
+					if (doNormals)
+						(*normals)[i] = vec3((float) d[nx], (float) d[ny], (float) d[nz]);
+					if (doTextures)
+						(*textures)[i] = vec2((float) d[u], (float) d[v]);
 				}
-				// create triangle
-				triangles.push_back(int3(id1, id2, id3));
-				if (triangleGroups)
-					triangleGroups->push_back(group);
+			haveVertices = true;
+		}
+		else if (!strcmp(e.name, "face")) {
+			int vids = -1;
+			for (int i = 0; i < (int) e.properties.size() && vids < 0; i++)
+				if (e.properties[i].countType && (!strcmp(e.properties[i].name, "vertex_indices") ||
+												  !strcmp(e.properties[i].name, "vertex_index")))
+					vids = i;
+			if (vids < 0 || !haveVertices) {
+				printf("PLY faces without vertex indices, or before vertices\n");
+				return false;
 			}
-			else
-				// create polygon as nvids-2 triangles
-				for (int i = 1; i < nids-1; i++) {
-					triangles.push_back(int3(vids[0], vids[i], vids[(i+1)%nids]));
-					if (triangleGroups)
-						triangleGroups->push_back(group);
+			int nPoints = (int) points.size(), nBad = 0;
+			PlyProperty &pr = e.properties[vids];
+			bool intFaces = !ascii && e.properties.size() == 1 && pr.countType == PlyUint8 &&
+							(pr.type == PlyInt32 || pr.type == PlyUint32);
+			triangles.reserve(e.count);
+			for (int f = 0; f < e.count; f++) {
+				if (intFaces && r.ptr < end && *r.ptr == 3 && end-r.ptr >= 13) {
+					// the usual binary triangle: count byte, then three ints
+					int t[3];
+					memcpy(t, r.ptr+1, 12);
+					r.ptr += 13;
+					if ((unsigned) t[0] < (unsigned) nPoints && (unsigned) t[1] < (unsigned) nPoints &&
+						(unsigned) t[2] < (unsigned) nPoints)
+						AddPolygon(t, 3, points, triangles, normals);
+					else
+						nBad++;
+					continue;
 				}
+				if (!r.Record(e, vids)) {
+					printf("PLY face %i missing\n", f);
+					return false;
+				}
+				bool ok = true;
+				for (size_t k = 0; k < r.list.size(); k++)
+					ok = ok && (unsigned) r.list[k] < (unsigned) nPoints;
+				if (ok)
+					AddPolygon(r.list.empty()? NULL : &r.list[0], (int) r.list.size(), points, triangles, normals);
+				else
+					nBad++;
+			}
+			if (nBad)
+				printf("%i PLY faces with bad vertex indices\n", nBad);
 		}
-		else if (*word == 0 || *word== '\n')                     // skip blank line
-			continue;
-		else {                                     // unrecognized attribute
-			// printf("unsupported attribute in object file: %s", word);
-			continue; // return false;
+		else
+			// skip other elements
+			for (int i = 0; i < e.count; i++)
+				if (!r.Record(e))
+					break;
+	}
+	if (!haveVertices)
+		printf("no vertices in %s\n", filename);
+	return haveVertices;
+} // end ReadPly
+
+// STL welding
+
+static inline int WeldCell(float x, float epsilon) {
+	// floor(x/epsilon) clamped to the int range, as converting a larger value is undefined
+	double q = floor((double) x/epsilon);
+	return q < INT_MIN? INT_MIN : q > INT_MAX? INT_MAX : (int) q;
+}
+
+int WeldSTL(vector<VertexSTL> &vertices, vector<vec3> &points, vector<int3> &triangles, float epsilon, int nThreads) {
+	// each vertex is keyed by its cell in a grid of spacing epsilon (by its exact position if epsilon is 0);
+	// cells are spread over buckets by hash so each bucket is welded by one thread, the lowest vertex
+	// in a cell represents it, and points are numbered in order of first use, independent of nThreads
+	clock_t start = clock();
+	const int nBuckets = 256, grain = 1 << 16;
+	int nVerts = (int) vertices.size(), nBlocks = (nVerts+grain-1)/grain;
+	vector<int3> keys(nVerts);
+	vector<unsigned char> buckets(nVerts);
+	vector<int> counts(nBlocks*nBuckets, 0), sorted(nVerts), reps(nVerts), ids(nVerts), nNonFinite(nBlocks, 0);
+	// key and bucket for each vertex, with counts per block and bucket
+	ParallelFor(nBlocks, [&](int b0, int b1) {
+		for (int b = b0; b < b1; b++) {
+			int *count = &counts[b*nBuckets], end = (b+1)*grain < nVerts? (b+1)*grain : nVerts;
+			for (int i = b*grain; i < end; i++) {
+				vec3 &p = vertices[i].point;
+				int3 &k = keys[i];
+				nNonFinite[b] += !std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z);
+				if (epsilon > 0)
+					k = int3(WeldCell(p.x, epsilon), WeldCell(p.y, epsilon), WeldCell(p.z, epsilon));
+				else {
+					vec3 q = p+vec3(0, 0, 0);			// -0 becomes +0
+					memcpy(&k.i1, &q.x, sizeof(int));
+					memcpy(&k.i2, &q.y, sizeof(int));
+					memcpy(&k.i3, &q.z, sizeof(int));
+				}
+				count[buckets[i] = VidMap::Hash(k) >> 24]++;
+			}
 		}
-	} // end read til end of file
-	//if (vertexNormals)
-	//	SetVertexNormals(vertices, triangles, *vertexNormals);
-	return true;
-} // end ReadAsciiObj
+	}, 1, nThreads);
+	// a NaN or infinite coordinate has no cell
+	int nBad = 0;
+	for (int b = 0; b < nBlocks; b++)
+		nBad += nNonFinite[b];
+	if (nBad) {
+		printf("can't weld: %i vertices with non-finite coordinates\n", nBad);
+		points.resize(0);
+		triangles.resize(0);
+		return 0;
+	}
+	// counts become offsets: buckets in order, blocks in order within a bucket
+	vector<int> bucketStart(nBuckets+1);
+	int offset = 0;
+	for (int k = 0; k < nBuckets; k++) {
+		bucketStart[k] = offset;
+		for (int b = 0; b < nBlocks; b++) {
+			int n = counts[b*nBuckets+k];
+			counts[b*nBuckets+k] = offset;
+			offset += n;
+		}
+	}
+	bucketStart[nBuckets] = offset;
+	// group vertex indices by bucket, ascending within each bucket
+	ParallelFor(nBlocks, [&](int b0, int b1) {
+		for (int b = b0; b < b1; b++) {
+			int *next = &counts[b*nBuckets], end = (b+1)*grain < nVerts? (b+1)*grain : nVerts;
+			for (int i = b*grain; i < end; i++)
+				sorted[next[buckets[i]]++] = i;
+		}
+	}, 1, nThreads);
+	// weld each bucket
+	ParallelFor(nBuckets, [&](int k0, int k1) {
+		for (int k = k0; k < k1; k++) {
+			VidMap cells(bucketStart[k+1]-bucketStart[k]);
+			for (int j = bucketStart[k]; j < bucketStart[k+1]; j++)
+				reps[sorted[j]] = cells.Find(keys[sorted[j]], sorted[j]);
+		}
+	}, 1, nThreads);
+	// number the representatives in vertex order, then point others to their representative's id
+	vector<int> blockStart(nBlocks+1, 0);
+	ParallelFor(nBlocks, [&](int b0, int b1) {
+		for (int b = b0; b < b1; b++)
+			for (int i = b*grain, end = (b+1)*grain < nVerts? (b+1)*grain : nVerts; i < end; i++)
+				blockStart[b+1] += reps[i] == i;
+	}, 1, nThreads);
+	for (int b = 0; b < nBlocks; b++)
+		blockStart[b+1] += blockStart[b];
+	points.resize(blockStart[nBlocks]);
+	ParallelFor(nBlocks, [&](int b0, int b1) {
+		for (int b = b0; b < b1; b++) {
+			int id = blockStart[b];
+			for (int i = b*grain, end = (b+1)*grain < nVerts? (b+1)*grain : nVerts; i < end; i++)
+				if (reps[i] == i) {
+					points[id] = vertices[i].point;
+					ids[i] = id++;
+				}
+		}
+	}, 1, nThreads);
+	ParallelFor(nVerts, [&](int i0, int i1) {
+		for (int i = i0; i < i1; i++)
+			if (reps[i] != i)
+				ids[i] = ids[reps[i]];
+	}, grain, nThreads);
+	// triangles, less any that collapsed
+	triangles.resize(0);
+	triangles.reserve(nVerts/3);
+	for (int i = 0; i+2 < nVerts; i += 3) {
+		int3 t(ids[i], ids[i+1], ids[i+2]);
+		if (t.i1 != t.i2 && t.i2 != t.i3 && t.i3 != t.i1)
+			triangles.push_back(t);
+	}
+	// report against the soup, counting a normal per point as SetVertexNormals will add
+	float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+	double before = (double) nVerts*sizeof(VertexSTL);
+	double after = (double) points.size()*2*sizeof(vec3)+(double) triangles.size()*sizeof(int3);
+	printf("welded %i triangles to %i points (%i dropped): %.1f MB saved, %.3f secs per million triangles\n",
+		nVerts/3, (int) points.size(), nVerts/3-(int) triangles.size(), (before-after)/(1024*1024),
+		nVerts? 3e6f*dt/nVerts : 0.f);
+	return (int) points.size();
+} // end WeldSTL
 
-// texture
+// Out-of-core streaming
 
-char *ReadTexture(const char *filename, int &width, int &height, int &bitsPerPixel) {
-	// open targa file, read header
+static bool StreamLines(const char *filename, size_t blockSize, std::function<bool(const char *, const char *)> lines) {
+	// read filename in blocks of up to blockSize bytes and pass each run of whole lines to lines();
+	// a partial last line is carried into the next block; return false if lines() does
 	FILE *in = fopen(filename, "rb");
-	char *pixels = NULL;
-	if (in) {
-		short tgaHeader[9];
-		fread(tgaHeader, sizeof(tgaHeader), 1, in);
-		// allocate, read pixels
-		width = tgaHeader[6];
-		height = tgaHeader[7];
-		bitsPerPixel = tgaHeader[8];
-		int bytesPerPixel = bitsPerPixel/8;
-		int bytesPerImage = width*height*bytesPerPixel;
-		if (bytesPerPixel == 3) {
-			pixels = new char[bytesPerImage];
-			fread(pixels, bytesPerImage, 1, in);
+	if (!in)
+		return false;
+	vector<char> buf(blockSize);
+	size_t nCarry = 0;
+	bool ok = true;
+	while (ok) {
+		size_t n = nCarry+fread(&buf[nCarry], 1, blockSize-nCarry, in);
+		bool last = n < blockSize;
+		const char *begin = &buf[0], *end = begin+n, *stop = end;
+		if (!last) {
+			while (stop > begin && stop[-1] != '\n')
+				stop--;
+			if (stop == begin) {
+				printf("line longer than %i bytes in %s\n", (int) blockSize, filename);
+				ok = false;
+				break;
+			}
 		}
-		else
-			printf("bytes per pixel = %i!\n", bytesPerPixel);
+		ok = lines(begin, stop);
+		if (last)
+			break;
+		nCarry = end-stop;
+		memmove(&buf[0], stop, nCarry);
+	}
+	fclose(in);
+	return ok;
+}
+
+static size_t StreamBlockSize(size_t memoryBudget) {
+	// parsed records take up to about three times their text, so read a quarter of the budget at a time
+	size_t blockSize = memoryBudget/4;
+	return blockSize < (1 << 16)? 1 << 16 : blockSize;
+}
+
+bool StreamObj(const char *filename, std::function<bool(MeshBatch &)> consume, size_t memoryBudget) {
+	// each block of lines is parsed as one chunk of ReadAsciiObj; faces index points
+	// by their position in the file, so no vertex map (which would grow with the file) is kept
+	MeshBatch batch;
+	int lineBase = 0;
+	return StreamLines(filename, StreamBlockSize(memoryBudget), [&](const char *begin, const char *end) {
+		ObjChunk c;
+		c.begin = begin;
+		c.end = end;
+		ParseObjChunk(c);
+		for (size_t k = 0; k < c.badLines.size(); k++)
+			printf("bad format on line %d\n", lineBase+c.badLines[k]);
+		if (c.errorLine) {
+			printf("bad line %d in object file", lineBase+c.errorLine);
+			return false;
+		}
+		lineBase += c.nLines;
+		batch.firstPoint += batch.points.size();
+		batch.points.swap(c.vertices);
+		if (batch.firstPoint+(long long) batch.points.size() > INT_MAX) {
+			printf("more than %i points in %s, too many to index\n", INT_MAX, filename);
+			return false;
+		}
+		batch.triangles.resize(0);
+		for (size_t f = 0, corner = 0; f < c.faceSizes.size(); corner += c.faceSizes[f++])
+			for (int k = 2; k < c.faceSizes[f]; k++)
+				batch.triangles.push_back(int3(c.corners[corner].i1, c.corners[corner+k-1].i1, c.corners[corner+k].i1));
+		return consume(batch);
+	});
+}
+
+bool StreamSTL(const char *filename, std::function<bool(MeshBatch &)> consume, size_t memoryBudget) {
+	// triangles are unshared: each three points (and facet normals) of a batch are a triangle
+	long long fileSize, time;
+	char header[84];
+	FILE *in = fopen(filename, "rb");
+	if (!in || !SourceKey(filename, fileSize, time)) {
+		if (in)
+			fclose(in);
+		return false;
+	}
+	size_t nHeader = fread(header, 1, 84, in);
+	MeshBatch batch;
+	vector<VertexSTL> verts;
+	auto emit = [&]() {
+		int nVerts = (int) verts.size();
+		batch.firstPoint += batch.points.size();
+		batch.points.resize(nVerts);
+		batch.normals.resize(nVerts);
+		for (int i = 0; i < nVerts; i++) {
+			batch.points[i] = verts[i].point;
+			batch.normals[i] = verts[i].normal;
+		}
+		verts.resize(0);
+		return consume(batch);
+	};
+	if (IsAsciiSTL(header, nHeader, fileSize)) {
 		fclose(in);
+		AsciiSTL parser;
+		return StreamLines(filename, StreamBlockSize(memoryBudget), [&](const char *begin, const char *end) {
+			parser.Parse(begin, end, verts);
+			return emit();
+		});
+	}
+	// binary: whole records per block
+	const int recordSize = 50;
+	bool ok = nHeader == 84;
+	long long nTriangles = ok? (fileSize-84)/recordSize : 0;
+	size_t blockRecords = StreamBlockSize(memoryBudget)/(3*sizeof(VertexSTL));
+	vector<char> records(blockRecords*recordSize);
+	for (long long t = 0; ok && t < nTriangles; t += blockRecords) {
+		size_t n = nTriangles-t < (long long) blockRecords? (size_t) (nTriangles-t) : blockRecords;
+		if (fread(&records[0], recordSize, n, in) != n) {
+			ok = false;
+			break;
+		}
+		verts.resize(3*n);
+		for (size_t i = 0; i < n; i++) {
+			const char *r = &records[recordSize*i];
+			vec3 v[3], nrm;
+			memcpy(&nrm.x, r, 12);
+			for (int k = 0; k < 3; k++)
+				memcpy(&v[k].x, r+12+12*k, 12);
+			SetTriangleSTL(&verts[3*i], v, nrm);
+		}
+		ok = emit();
+	}
+	fclose(in);
+	return ok;
+}
+
+// binary mesh cache
+
+static const char MeshBinMagic[8] = {'M', 'E', 'S', 'H', 'B', 'I', 'N', 0};
+static const unsigned MeshBinVersion = 1, MeshBinAlign = 64;
+
+struct MeshBinHeader {
+	char			magic[8];					// MeshBinMagic, written last
+	unsigned		version, headerSize;
+	unsigned		nPoints, nTriangles;
+	long long		sourceSize, sourceTime;		// cache key: size, mtime of source file
+	unsigned		sourcePathHash, reserved;	// and hash of its name
+	long long		offsets[5];					// points, normals, uvs, triangles, groups (0 if absent)
+};
+
+unsigned PathHash(const char *s) {
+	// FNV-1a, ignoring case and slash direction
+	unsigned h = 2166136261u;
+	for (; *s; s++) {
+		char c = *s == '\\'? '/' : *s >= 'A' && *s <= 'Z'? *s-'A'+'a' : *s;
+		h = (h^(unsigned char) c)*16777619u;
+	}
+	return h;
+}
+
+MeshBin::MeshBin() : file(NULL) { Close(); }
+
+MeshBin::~MeshBin() { Close(); }
+
+void MeshBin::Close() {
+	delete file;
+	file = NULL;
+	nPoints = nTriangles = 0;
+	points = normals = NULL;
+	uvs = NULL;
+	triangles = NULL;
+	triangleGroups = NULL;
+	sourceSize = sourceTime = 0;
+	sourcePathHash = 0;
+}
+
+bool MeshBin::Open(const char *filename) {
+	Close();
+	file = new MappedFile(filename);
+	const char *data = file->data;
+	size_t size = file->size;
+	const MeshBinHeader *h = (const MeshBinHeader *) data;
+	if (!data || size < sizeof(MeshBinHeader) || memcmp(h->magic, MeshBinMagic, 8) ||
+		h->version != MeshBinVersion || h->headerSize != sizeof(MeshBinHeader)) {
+		Close();
+		return false;
+	}
+	// check each array lies within the file
+	size_t elementSizes[] = {sizeof(vec3), sizeof(vec3), sizeof(vec2), sizeof(int3), sizeof(int)};
+	size_t counts[] = {h->nPoints, h->nPoints, h->nPoints, h->nTriangles, h->nTriangles};
+	for (int i = 0; i < 5; i++)
+		if (h->offsets[i] && (h->offsets[i] < 0 || (size_t) h->offsets[i]+counts[i]*elementSizes[i] > size)) {
+			Close();
+			return false;
+		}
+	nPoints = h->nPoints;
+	nTriangles = h->nTriangles;
+	points = (const vec3 *) (data+h->offsets[0]);
+	normals = h->offsets[1]? (const vec3 *) (data+h->offsets[1]) : NULL;
+	uvs = h->offsets[2]? (const vec2 *) (data+h->offsets[2]) : NULL;
+	triangles = (const int3 *) (data+h->offsets[3]);
+	triangleGroups = h->offsets[4]? (const int *) (data+h->offsets[4]) : NULL;
+	sourceSize = h->sourceSize;
+	sourceTime = h->sourceTime;
+	sourcePathHash = h->sourcePathHash;
+	return true;
+}
+
+bool WriteMeshBin(const char    *filename,
+				  vector<vec3>	&points,
+				  vector<int3>	&triangles,
+				  vector<vec3>	*normals,
+				  vector<vec2>	*uvs,
+				  vector<int>	*triangleGroups,
+				  const char	*sourceFilename) {
+	FILE *out = fopen(filename, "wb");
+	if (!out)
+		return false;
+	int nPoints = points.size(), nTriangles = triangles.size();
+	MeshBinHeader h;
+	memset(&h, 0, sizeof(h));					// magic stays zero until all data written
+	h.version = MeshBinVersion;
+	h.headerSize = sizeof(h);
+	h.nPoints = nPoints;
+	h.nTriangles = nTriangles;
+	if (sourceFilename) {
+		SourceKey(sourceFilename, h.sourceSize, h.sourceTime);
+		h.sourcePathHash = PathHash(sourceFilename);
+	}
+	// arrays absent, or of the wrong length, are not stored
+	const void *arrays[] = {
+		nPoints? &points[0] : NULL,
+		normals && (int) normals->size() == nPoints && nPoints? &(*normals)[0] : NULL,
+		uvs && (int) uvs->size() == nPoints && nPoints? &(*uvs)[0] : NULL,
+		nTriangles? &triangles[0] : NULL,
+		triangleGroups && (int) triangleGroups->size() == nTriangles && nTriangles? &(*triangleGroups)[0] : NULL};
+	size_t sizes[] = {nPoints*sizeof(vec3), nPoints*sizeof(vec3), nPoints*sizeof(vec2), nTriangles*sizeof(int3), nTriangles*sizeof(int)};
+	long long offset = sizeof(h);
+	for (int i = 0; i < 5; i++)
+		if (arrays[i] || i == 0 || i == 3) {
+			offset = (offset+MeshBinAlign-1)/MeshBinAlign*MeshBinAlign;
+			h.offsets[i] = offset;
+			offset += sizes[i];
+		}
+	bool ok = fwrite(&h, sizeof(h), 1, out) == 1;
+	static const char zeros[MeshBinAlign] = {0};
+	long long at = sizeof(h);
+	for (int i = 0; i < 5 && ok; i++)
+		if (h.offsets[i]) {
+			size_t pad = (size_t) (h.offsets[i]-at);
+			ok = (!pad || fwrite(zeros, 1, pad, out) == pad) && (!sizes[i] || fwrite(arrays[i], 1, sizes[i], out) == sizes[i]);
+			at = h.offsets[i]+sizes[i];
+		}
+	// now mark the file complete
+	memcpy(h.magic, MeshBinMagic, 8);
+	ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, out) == 1;
+	ok = fclose(out) == 0 && ok;
+	if (!ok)
+		remove(filename);
+	return ok;
+}
+
+static int StreamAsciiObj(char *filename, vector<vec3> &points, vector<int3> &triangles, vector<vec3> *normals,
+						  vector<vec2> *textures, vector<int> *triangleGroups, std::function<bool(int)> merged) {
+	// the serial ReadAsciiObj, but read and merged a block of lines at a time, calling merged(# triangles
+	// before the block) after each; return 1 if read, 0 if not (or merged returned false), -1 if a face
+	// refers to a vertex, normal or uv further on in the file, whose merge needs the whole file
+	vector<vec3> tmpVertices, tmpNormals;
+	vector<vec2> tmpTextures;
+	VidMap vidMap;
+	int group = 0, lineBase = 0, minMissingN = INT_MAX, minMissingT = INT_MAX;
+	bool forward = false;
+	bool ok = StreamLines(filename, StreamBlockSize(1 << 26), [&](const char *begin, const char *end) {
+		ObjChunk c;
+		c.begin = begin;
+		c.end = end;
+		ParseObjChunk(c);
+		for (size_t k = 0; k < c.badLines.size(); k++)
+			printf("bad format on line %d\n", lineBase+c.badLines[k]);
+		if (c.errorLine) {
+			printf("bad line %d in object file", lineBase+c.errorLine);
+			return false;
+		}
+		lineBase += c.nLines;
+		Append(tmpVertices, c.vertices);
+		Append(tmpNormals, c.normals);
+		Append(tmpTextures, c.textures);
+		// a normal or uv index past those read so far is missing unless the file has it later
+		for (size_t k = 0; k < c.corners.size(); k++) {
+			int3 &key = c.corners[k];
+			if (key.i1 >= (int) tmpVertices.size()) {
+				forward = true;
+				return false;
+			}
+			if (key.i3 >= (int) tmpNormals.size() && key.i3 < minMissingN)
+				minMissingN = key.i3;
+			if (key.i2 >= (int) tmpTextures.size() && key.i2 < minMissingT)
+				minMissingT = key.i2;
+		}
+		int nTriangles = (int) triangles.size();
+		MergeObjFaces(c, tmpVertices, tmpNormals, tmpTextures, vidMap, group, points, triangles,
+					  normals, textures, triangleGroups);
+		return merged(nTriangles);
+	});
+	if (forward || minMissingN < (int) tmpNormals.size() || minMissingT < (int) tmpTextures.size())
+		return -1;
+	return ok? 1 : 0;
+}
+
+bool ReadObjCached(char          *filename,
+				   vector<vec3>	 &points,
+				   vector<int3>	 &triangles,
+				   vector<vec3>	 *normals,
+				   vector<vec2>	 *textures,
+				   vector<int>	 *triangleGroups,
+				   int			  nThreads,
+				   std::function<bool(int)> merged) {
+	string cacheName = string(filename)+".mbin";
+	long long size, time;
+	if (!SourceKey(filename, size, time))
+		return false;
+	MeshBin bin;
+	if (bin.Open(cacheName.c_str()) &&
+		bin.sourceSize == size && bin.sourceTime == time && bin.sourcePathHash == PathHash(filename)) {
+		// one bulk copy per array
+		points.assign(bin.points, bin.points+bin.nPoints);
+		triangles.assign(bin.triangles, bin.triangles+bin.nTriangles);
+		if (normals && bin.normals)
+			normals->assign(bin.normals, bin.normals+bin.nPoints);
+		if (textures && bin.uvs)
+			textures->assign(bin.uvs, bin.uvs+bin.nPoints);
+		if (triangleGroups && bin.triangleGroups)
+			triangleGroups->assign(bin.triangleGroups, bin.triangleGroups+bin.nTriangles);
+		return true;
+	}
+	bin.Close();
+	// parse (with all attributes, so the cache serves any later caller) and write the cache
+	vector<vec3> tmpNormals;
+	vector<vec2> tmpTextures;
+	vector<int> tmpGroups;
+	vector<vec3> *n = normals? normals : &tmpNormals;
+	vector<vec2> *t = textures? textures : &tmpTextures;
+	vector<int> *g = triangleGroups? triangleGroups : &tmpGroups;
+	int streamed = merged? StreamAsciiObj(filename, points, triangles, n, t, g, merged) : -1;
+	if (!streamed)
+		return false;
+	if (streamed < 0) {
+		if (merged) {
+			// faces refer ahead: start over
+			points.resize(0);
+			triangles.resize(0);
+			n->resize(0);
+			t->resize(0);
+			g->resize(0);
+		}
+		if (!ReadAsciiObj(filename, points, triangles, n, t, g, nThreads))
+			return false;
+	}
+	if (!WriteMeshBin(cacheName.c_str(), points, triangles, n, t, g, filename))
+		printf("can't write %s\n", cacheName.c_str());
+	return true;
+}
+
+// Writing
+
+static const int MaxItemSize = 128;				// longest formatted line (a face with a group change)
+
+static char *FormatInt(char *s, int i) {
+	char tmp[12];
+	unsigned int u = i < 0? 0u-(unsigned int) i : (unsigned int) i;
+	int n = 0;
+	if (i < 0)
+		*s++ = '-';
+	do
+		tmp[n++] = (char) ('0'+u%10);
+	while (u /= 10);
+	while (n)
+		*s++ = tmp[--n];
+	return s;
+}
+
+static char *FormatFloat(char *s, float f) {
+	// 9 significant digits, less trailing zeros, which ScanFloat (or any correctly rounding
+	// reader) returns as the same float; fixed notation unless the exponent is large
+	static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	if (f != f || f-f != 0)						// nan, inf
+		return s+sprintf(s, "%g", f);
+	if (f < 0 || (f == 0 && 1/f < 0)) {
+		*s++ = '-';
+		f = -f;
+	}
+	if (f == 0) {
+		*s++ = '0';
+		return s;
+	}
+	// decimal exponent e from the binary, then m = 9 digits of f/10^e, correctly rounded
+	int e2, e, scale;
+	frexp((double) f, &e2);
+	e = (int) floor((e2-1)*.30102999566398);	// exact, or one low
+	long long m = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		scale = 8-e;
+		if (scale < -22 || scale > 22)
+			return s+sprintf(s, "%.9g", f);		// denormals and near the float limits
+		double d = scale < 0? f/pow10[-scale] : f*pow10[scale];
+		m = (long long) (d+.5);
+		if (m < 1000000000)
+			break;
+		e++;
+	}
+	char digits[10];
+	for (int i = 8; i >= 0; i--, m /= 10)
+		digits[i] = (char) ('0'+m%10);
+	int nDigits = 9;
+	while (nDigits > 1 && digits[nDigits-1] == '0')
+		nDigits--;
+	if (e < -5 || e > 8) {
+		// d.ddde-x
+		*s++ = digits[0];
+		if (nDigits > 1) {
+			*s++ = '.';
+			for (int i = 1; i < nDigits; i++)
+				*s++ = digits[i];
+		}
+		*s++ = 'e';
+		return FormatInt(s, e);
+	}
+	if (e < 0) {
+		// 0.000ddd
+		*s++ = '0';
+		*s++ = '.';
+		for (int i = -1; i > e; i--)
+			*s++ = '0';
+		for (int i = 0; i < nDigits; i++)
+			*s++ = digits[i];
+		return s;
+	}
+	// ddd.ddd
+	for (int i = 0; i <= e; i++)
+		*s++ = i < nDigits? digits[i] : '0';
+	if (nDigits > e+1) {
+		*s++ = '.';
+		for (int i = e+1; i < nDigits; i++)
+			*s++ = digits[i];
+	}
+	return s;
+}
+
+template<class F>
+static bool WriteBlocks(FILE *out, int n, F format, int nThreads) {
+	// format(i, s) writes item i (at most MaxItemSize bytes) at s and returns its end; blocks of
+	// items are formatted concurrently, one buffer per thread, and written in order
+	static const int BlockItems = 1 << 14;
+	int nWorkers = NumThreads(nThreads);
+	vector<vector<char> > buffers(nWorkers);
+	vector<size_t> lengths(nWorkers);
+	for (int first = 0; first < n; first += nWorkers*BlockItems) {
+		ParallelFor(nWorkers, [&](int b, int e) {
+			for (int w = b; w < e; w++) {
+				int begin = first+w*BlockItems, end = begin+BlockItems < n? begin+BlockItems : n;
+				lengths[w] = 0;
+				if (begin >= end)
+					continue;
+				if (buffers[w].empty())
+					buffers[w].resize(BlockItems*MaxItemSize);
+				char *start = &buffers[w][0], *s = start;
+				for (int i = begin; i < end; i++)
+					s = format(i, s);
+				lengths[w] = s-start;
+			}
+		}, 1, nWorkers);
+		for (int w = 0; w < nWorkers; w++)
+			if (lengths[w] && fwrite(&buffers[w][0], lengths[w], 1, out) != 1)
+				return false;
+	}
+	return true;
+}
+
+static char *FormatVector(char *s, const char *key, const float *v, int n) {
+	// key followed by n floats, one line
+	while (*key)
+		*s++ = *key++;
+	for (int k = 0; k < n; k++) {
+		*s++ = ' ';
+		s = FormatFloat(s, v[k]);
+	}
+	*s++ = '\n';
+	return s;
+}
+
+bool WriteAsciiObj(const char    *filename,
+				   vector<vec3>	 &points,
+				   vector<int3>	 &triangles,
+				   vector<vec3>	 *normals,
+				   vector<vec2>	 *textures,
+				   vector<int>	 *triangleGroups,
+				   int			  nThreads) {
+	clock_t start = clock();
+	FILE *out = fopen(filename, "wb");
+	if (!out)
+		return false;
+	int nPoints = points.size(), nTriangles = triangles.size();
+	bool doNormals = normals && (int) normals->size() == nPoints && nPoints;
+	bool doTextures = textures && (int) textures->size() == nPoints && nPoints;
+	bool doGroups = triangleGroups && (int) triangleGroups->size() == nTriangles;
+	bool ok = fprintf(out, "# %i vertices, %i triangles\n", nPoints, nTriangles) > 0;
+	ok = ok && WriteBlocks(out, nPoints, [&](int i, char *s) {
+		return FormatVector(s, "v", &points[i].x, 3);
+	}, nThreads);
+	ok = ok && (!doTextures || WriteBlocks(out, nPoints, [&](int i, char *s) {
+		return FormatVector(s, "vt", &(*textures)[i].x, 2);
+	}, nThreads));
+	ok = ok && (!doNormals || WriteBlocks(out, nPoints, [&](int i, char *s) {
+		return FormatVector(s, "vn", &(*normals)[i].x, 3);
+	}, nThreads));
+	// v, vt and vn share indices; a g record precedes each change of group
+	ok = ok && WriteBlocks(out, nTriangles, [&](int t, char *s) {
+		if (doGroups && (*triangleGroups)[t] != (t? (*triangleGroups)[t-1] : 0)) {
+			*s++ = 'g';
+			*s++ = ' ';
+			s = FormatInt(s, (*triangleGroups)[t]);
+			*s++ = '\n';
+		}
+		*s++ = 'f';
+		int *vids = &triangles[t].i1;
+		for (int k = 0; k < 3; k++) {
+			*s++ = ' ';
+			s = FormatInt(s, vids[k]+1);
+			if (doTextures || doNormals) {
+				*s++ = '/';
+				if (doTextures)
+					s = FormatInt(s, vids[k]+1);
+				if (doNormals) {
+					*s++ = '/';
+					s = FormatInt(s, vids[k]+1);
+				}
+			}
+		}
+		*s++ = '\n';
+		return s;
+	}, nThreads);
+	ok = fclose(out) == 0 && ok;
+	if (!ok) {
+		remove(filename);
+		return false;
+	}
+	float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+	printf("wrote %i vertices, %i triangles in %.2f secs\n", nPoints, nTriangles, dt);
+	return true;
+}
+
+static bool WriteBinarySTL(const char *filename, int nTriangles, std::function<void(int, float *)> facet, int nThreads) {
+	// facet(t, f) sets normal then three vertices, 12 floats; records are 50 bytes, little-endian
+	clock_t start = clock();
+	FILE *out = fopen(filename, "wb");
+	if (!out)
+		return false;
+	char header[80];
+	memset(header, 0, 80);
+	strcpy(header, "binary STL written by MeshIO");	// must not begin "solid"
+	unsigned int n = nTriangles;
+	bool ok = fwrite(header, 80, 1, out) == 1 && fwrite(&n, 4, 1, out) == 1;
+	ok = ok && WriteBlocks(out, nTriangles, [&](int t, char *s) {
+		float f[12];
+		facet(t, f);
+		memcpy(s, f, 48);
+		s[48] = s[49] = 0;						// attribute byte count
+		return s+50;
+	}, nThreads);
+	ok = fclose(out) == 0 && ok;
+	if (!ok) {
+		remove(filename);
+		return false;
+	}
+	float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+	printf("wrote %i STL triangles in %.2f secs\n", nTriangles, dt);
+	return true;
+}
+
+bool WriteSTL(const char *filename, vector<vec3> &points, vector<int3> &triangles, int nThreads) {
+	return WriteBinarySTL(filename, triangles.size(), [&](int t, float *f) {
+		vec3 &p1 = points[triangles[t].i1], &p2 = points[triangles[t].i2], &p3 = points[triangles[t].i3];
+		vec3 n = cross(p2-p1, p3-p1);
+		float len = length(n);
+		n = len > 0? n/len : vec3(0, 0, 0);
+		memcpy(f, &n, 12);
+		memcpy(f+3, &p1, 12);
+		memcpy(f+6, &p2, 12);
+		memcpy(f+9, &p3, 12);
+	}, nThreads);
+}
+
+bool WriteSTL(const char *filename, vector<VertexSTL> &vertices, int nThreads) {
+	return WriteBinarySTL(filename, vertices.size()/3, [&](int t, float *f) {
+		VertexSTL *v = &vertices[3*t];
+		memcpy(f, &v[0].normal, 12);
+		for (int k = 0; k < 3; k++)
+			memcpy(f+3+3*k, &v[k].point, 12);
+	}, nThreads);
+}
+
+// texture
+
+TargaReader::TargaReader(const char *filename) : width(0), height(0), bitsPerPixel(0), topDown(false),
+	file(NULL), p(NULL), end(NULL), rle(false), packetRun(false), nRowsRead(0), packetLeft(0) {
+	// 18 byte header: id length, color map type, image type, color map spec (5), x, y origin,
+	// width, height, bits per pixel, descriptor (bit 5 set if top down); then id, color map, pixels
+	MappedFile *f = new MappedFile(filename);
+	const unsigned char *h = (const unsigned char *) f->data;
+	if (!h || f->size < 18) {
+		delete f;
+		return;
+	}
+	int imageType = h[2], colorMapBytes = h[1]? (h[5]|(h[6]<<8))*((h[7]+7)/8) : 0;
+	width = h[12]|(h[13]<<8);
+	height = h[14]|(h[15]<<8);
+	bitsPerPixel = h[16];
+	topDown = (h[17]&0x20) != 0;
+	rle = imageType == 10 || imageType == 11;
+	bool grey = imageType == 3 || imageType == 11, color = imageType == 2 || imageType == 10;
+	if (!((grey && bitsPerPixel == 8) || (color && (bitsPerPixel == 24 || bitsPerPixel == 32)))) {
+		printf("%s: unsupported targa type %i with %i bits per pixel\n", filename, imageType, bitsPerPixel);
+		delete f;
+		return;
+	}
+	p = h+18+h[0]+colorMapBytes;
+	end = h+f->size;
+	file = f;
+}
+
+TargaReader::~TargaReader() {
+	delete file;
+}
+
+int TargaReader::ReadRows(char *rows, int nRows) {
+	int bpp = bitsPerPixel/8, rowBytes = RowBytes();
+	if (!file || nRows > height-nRowsRead)
+		nRows = file? height-nRowsRead : 0;
+	unsigned char *d = (unsigned char *) rows, *dEnd = d+(size_t) nRows*rowBytes;
+	if (!rle) {
+		size_t n = (size_t) (end-p) < (size_t) (dEnd-d)? end-p : dEnd-d;
+		memcpy(d, p, n);
+		p += n;
+		d += n;
+	}
+	else {
+		// packets may run across rows, so their state is kept between calls
+		while (d < dEnd) {
+			if (!packetLeft) {
+				if (p >= end)
+					break;
+				packetRun = (*p&0x80) != 0;
+				packetLeft = (*p++&0x7f)+1;
+				if (packetRun) {
+					if (end-p < bpp)
+						break;
+					memcpy(packetPixel, p, bpp);
+					p += bpp;
+				}
+			}
+			int n = (int) ((dEnd-d)/bpp);
+			n = packetLeft < n? packetLeft : n;
+			if (packetRun) {
+				if (bpp == 1)
+					memset(d, packetPixel[0], n);
+				else
+					for (unsigned char *q = d; q < d+n*bpp; q += bpp)
+						memcpy(q, packetPixel, bpp);
+			}
+			else {
+				if (end-p < n*bpp)
+					break;
+				memcpy(d, p, n*bpp);
+				p += n*bpp;
+			}
+			d += n*bpp;
+			packetLeft -= n;
+		}
+	}
+	if (d < dEnd) {
+		printf("targa file truncated\n");
+		memset(d, 0, dEnd-d);
+		nRows = (int) ((d-(unsigned char *) rows)/rowBytes);
+		nRowsRead = height;						// no more
+		return nRows;
+	}
+	nRowsRead += nRows;
+	return nRows;
+}
+
+char *ReadTexture(const char *filename, int &width, int &height, int &bitsPerPixel) {
+	TargaReader tga(filename);
+	if (!tga.Valid())
+		return NULL;
+	width = tga.width;
+	height = tga.height;
+	bitsPerPixel = tga.bitsPerPixel;
+	int rowBytes = tga.RowBytes();
+	char *pixels = new char[(size_t) rowBytes*height];
+	if (!tga.topDown)
+		tga.ReadRows(pixels, height);			// a truncated file's missing rows are zeroed
+	else {
+		int row = 0;
+		while (row < height && tga.ReadRows(pixels+(size_t) rowBytes*tga.ImageRow(row), 1))
+			row++;
+		for (; row < height; row++)				// truncated file: black, as bottom-up
+			memset(pixels+(size_t) rowBytes*tga.ImageRow(row), 0, rowBytes);
 	}
 	return pixels;
 }
 
-GLuint SetHeightfield(const char *filename, int whichTexture) {
-	GLuint textureId = 0;
-	glGenTextures(1, &textureId);
-	// open targa file, read header, store as GL_TEXTURE2
-	int width, height, bitsPerPixel;
+char *ReadTexture(const char *filename, int &width, int &height) {
+	int bitsPerPixel;
 	char *pixels = ReadTexture(filename, width, height, bitsPerPixel);
-	if (!pixels) {
-		printf("No texture!\n");
-		return 0;
-	}
-	if (bitsPerPixel == 24) {
-		char *tmpPixels = new char[width*height];
-		// convert to luminance
-		for (int i = 0; i < width*height; i++) {
-			char *p = pixels+3*i;
-			tmpPixels[i] = (int) (.21*(double)p[2]+.72*(double)p[1]+.07*(double)p[0]);
-		}
-		delete [] pixels;
-		pixels = tmpPixels;
-	}
-	// set and bind active texture corresponding with textureIds[1]
-	glActiveTexture(whichTexture == 1? GL_TEXTURE2 : GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, textureId);
-	// allocate GPU texture buffer; copy, free pixels
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // in case width not multiple of 4
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+	if (!pixels || bitsPerPixel == 24)
+		return pixels;
+	int n = width*height, bpp = bitsPerPixel/8;
+	char *bgr = new char[3*(size_t) n];
+	for (int i = 0; i < n; i++)
+		for (int k = 0; k < 3; k++)
+			bgr[3*i+k] = pixels[bpp*i+(bpp == 1? 0 : k)];
 	delete [] pixels;
-	glGenerateMipmap(GL_TEXTURE_2D);
-	return textureId;
+	return bgr;
+}
+
+// luminance weights in 8 bit fixed point, summing to 256
+static const int LumB = 18, LumG = 184, LumR = 54;
+
+#ifdef MESHIO_SSE
+static inline __m128i Luminance4(__m128i bgrx) {
+	// four 32 bit pixels to four 32 bit luminances; x is weighted by zero
+	__m128i zero = _mm_setzero_si128(), w = _mm_setr_epi16(LumB, LumG, LumR, 0, LumB, LumG, LumR, 0);
+	__m128 lo = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(bgrx, zero), w));
+	__m128 hi = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(bgrx, zero), w));
+	// pixel i is the sum of 32 bit lanes 2i and 2i+1
+	__m128i even = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+	__m128i odd = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+	return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), _mm_set1_epi32(128)), 8);
+}
+
+static inline __m128i Spread3(const unsigned char *p) {
+	// four 24 bit pixels at p to 32 bit lanes (reads 16 bytes)
+	__m128i v = _mm_loadu_si128((const __m128i *) p);
+	__m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+	__m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+	return _mm_unpacklo_epi64(p01, p23);
+}
+#endif
+
+void Luminance(const unsigned char *pixels, unsigned char *lum, int nPixels, int bytesPerPixel) {
+	int i = 0;
+	if (bytesPerPixel == 1) {
+		memcpy(lum, pixels, nPixels);
+		return;
+	}
+#ifdef MESHIO_SSE
+	// sixteen pixels per pass; 24 bit pixels are read 4 bytes past the last, so leave a spare pixel
+	int nVector = bytesPerPixel == 3? nPixels-2 : nPixels;
+	for (; i+16 <= nVector; i += 16) {
+		const unsigned char *p = pixels+i*bytesPerPixel;
+		__m128i l[4];
+		for (int k = 0; k < 4; k++)
+			l[k] = Luminance4(bytesPerPixel == 3? Spread3(p+12*k) : _mm_loadu_si128((const __m128i *) (p+16*k)));
+		__m128i l8 = _mm_packus_epi16(_mm_packs_epi32(l[0], l[1]), _mm_packs_epi32(l[2], l[3]));
+		_mm_storeu_si128((__m128i *) (lum+i), l8);
+	}
+#endif
+	for (; i < nPixels; i++) {
+		const unsigned char *p = pixels+i*bytesPerPixel;
+		lum[i] = (unsigned char) ((LumB*p[0]+LumG*p[1]+LumR*p[2]+128)>>8);
+	}
+}
+
+char *ReadLuminance(const char *filename, int &width, int &height) {
+	// open targa file, convert a block of rows at a time to luminance
+	clock_t start = clock();
+	TargaReader tga(filename);
+	if (!tga.Valid())
+		return NULL;
+	width = tga.width;
+	height = tga.height;
+	int bpp = tga.bitsPerPixel/8, rowBytes = tga.RowBytes();
+	int blockRows = rowBytes? (1<<20)/rowBytes : 1;
+	blockRows = blockRows < 1? 1 : blockRows;
+	vector<char> block((size_t) blockRows*rowBytes);
+	char *pixels = new char[(size_t) width*height];
+	int row = 0;
+	while (row < height) {
+		int n = tga.ReadRows(&block[0], height-row < blockRows? height-row : blockRows);
+		if (!n)
+			break;
+		for (int i = 0; i < n; i++, row++)
+			Luminance((unsigned char *) &block[(size_t) i*rowBytes], (unsigned char *) pixels+(size_t) width*tga.ImageRow(row), width, bpp);
+	}
+	for (; row < height; row++)					// truncated file: black, as ReadTexture
+		memset(pixels+(size_t) width*tga.ImageRow(row), 0, width);
+	float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+	printf("read %ix%i luminance in %.2f secs\n", width, height, dt);
+	return pixels;
 }
@@ -7,6 +7,7 @@
 #ifndef MESH_HDR
 #define MESH_HDR
 
+#include <functional>
 #include <vector>
 #include "mat.h"
 
@@ -20,8 +21,15 @@ struct VertexSTL {
 	VertexSTL(float *p, float *n) : point(vec3(p[0], p[1], p[2])), normal(vec3(n[0], n[1], n[2])) { }
 };
 
-int ReadSTL(char *filename, vector<VertexSTL> &vertices);
-	// return # triangles
+int ReadSTL(char *filename, vector<VertexSTL> &vertices, int nThreads = 1);
+	// return # triangles; binary records are decoded from a mapped file,
+	// nThreads as for ReadAsciiObj
+
+int WeldSTL(vector<VertexSTL> &vertices, vector<vec3> &points, vector<int3> &triangles, float epsilon = 0, int nThreads = 1);
+	// share vertices that fall in the same cell of size epsilon (0: identical positions), giving an
+	// indexed mesh as from ReadAsciiObj; triangles that collapse are dropped; return # points;
+	// cells are clamped to the int range (coordinates beyond 2^31 epsilon share the outer cells),
+	// and vertices with NaN or infinite coordinates fail the weld (return 0, points and triangles empty)
 
 // OBJ format
 
@@ -30,23 +38,187 @@ bool ReadAsciiObj(char          *filename,
 				  vector<int3>	&triangles,
 				  vector<vec3>	*normals  = NULL,
 				  vector<vec2>	*textures = NULL,
-				  vector<int>	*triangleGroups = NULL);
+				  vector<int>	*triangleGroups = NULL,
+				  int			 nThreads = 1);
 	// return true if successful
+	// nThreads > 1 parses line-aligned chunks of the file concurrently (0: one per hardware thread);
+	// the result is identical to the serial read
+
+// PLY format
+
+bool ReadPly(const char     *filename,
+			 vector<vec3>	&points,
+			 vector<int3>	&triangles,
+			 vector<vec3>	*normals  = NULL,
+			 vector<vec2>	*textures = NULL);
+	// read ascii or binary_little_endian PLY; return true if successful
+	// vertex x, y, z and, if requested and present, nx, ny, nz and u, v (or s, t) are one per point,
+	// in file order; faces (vertex_indices) are triangulated as by ReadAsciiObj; other elements
+	// and properties are skipped
+
+// Out-of-core streaming
+
+struct MeshBatch {
+	long long		firstPoint;					// file index of points[0]
+	vector<vec3>	points;
+	vector<vec3>	normals;					// STL only: facet normal of each point
+	vector<int3>	triangles;					// OBJ only: file indices of points (from 0), possibly in
+												// earlier batches; for STL each three points are a triangle
+	MeshBatch() : firstPoint(0) { }
+};
+
+bool StreamObj(const char *filename, std::function<bool(MeshBatch &)> consume, size_t memoryBudget = 1 << 26);
+bool StreamSTL(const char *filename, std::function<bool(MeshBatch &)> consume, size_t memoryBudget = 1 << 26);
+	// read the file front to back, passing consume successive batches of points and triangles,
+	// so a mesh larger than memory can be bounded, converted, etc. in one pass; memory use is
+	// about memoryBudget regardless of file size; consume returns false to stop early;
+	// return true if the whole file was read
+
+// Binary mesh cache
+
+class MappedFile;
+
+class MeshBin {
+	// read-only views of a binary mesh file, mapped into memory (no per-element copy);
+	// arrays are 64-byte aligned and valid until Close or destruction
+public:
+	int			 nPoints, nTriangles;
+	const vec3	*points, *normals;				// normals NULL if not stored
+	const vec2	*uvs;							// NULL if not stored
+	const int3	*triangles;
+	const int	*triangleGroups;				// NULL if not stored
+	long long	 sourceSize, sourceTime;		// size and modification time of the source file
+	unsigned	 sourcePathHash;
+	MeshBin();
+	~MeshBin();
+	bool Open(const char *filename);
+		// return true if filename is a complete binary mesh of the current version
+	void Close();
+private:
+	MappedFile	*file;
+	MeshBin(const MeshBin &);
+	MeshBin &operator=(const MeshBin &);
+};
+
+bool WriteMeshBin(const char    *filename,
+				  vector<vec3>	&points,
+				  vector<int3>	&triangles,
+				  vector<vec3>	*normals = NULL,
+				  vector<vec2>	*uvs = NULL,
+				  vector<int>	*triangleGroups = NULL,
+				  const char	*sourceFilename = NULL);
+	// write binary mesh; per-vertex arrays must have points.size() entries, else they are omitted;
+	// if non-null, sourceFilename's size, modification time and name are recorded as the cache key
+
+bool ReadObjCached(char          *filename,
+				   vector<vec3>	 &points,
+				   vector<int3>	 &triangles,
+				   vector<vec3>	 *normals  = NULL,
+				   vector<vec2>	 *textures = NULL,
+				   vector<int>	 *triangleGroups = NULL,
+				   int			  nThreads = 1,
+				   std::function<bool(int)> merged = nullptr);
+	// as ReadAsciiObj, but use <filename>.mbin if it was written from the present filename;
+	// otherwise parse filename and (re)write <filename>.mbin beside it
+	// if merged is given, a file to be parsed is instead read a block of lines at a time (on one
+	// thread), with merged(index of the block's first triangle) called once its faces are in points
+	// and triangles, so the mesh may be shown as it grows; return false if merged does; faces that
+	// refer to later lines (rare) leave the file to be read whole, after any calls so far
+
+bool SourceKey(const char *filename, long long &size, long long &time);
+unsigned PathHash(const char *filename);
+	// size and modification time of a file, and hash of its name: the key by which a cache file
+	// (as <filename>.mbin) is known to have been made from the present file
+
+// Writing
+
+bool WriteAsciiObj(const char    *filename,
+				   vector<vec3>	 &points,
+				   vector<int3>	 &triangles,
+				   vector<vec3>	 *normals  = NULL,
+				   vector<vec2>	 *textures = NULL,
+				   vector<int>	 *triangleGroups = NULL,
+				   int			  nThreads = 1);
+	// write per-point normals and textures (as from ReadAsciiObj) if given, sharing the point indices,
+	// and a g record at each change of group; floats have at most 9 significant digits, so ReadAsciiObj
+	// returns the same values; nThreads formats blocks of lines concurrently (0: one per hardware thread)
+
+bool WriteSTL(const char *filename, vector<vec3> &points, vector<int3> &triangles, int nThreads = 1);
+	// write binary STL, facet normals from the triangles' right-hand rule
+
+bool WriteSTL(const char *filename, vector<VertexSTL> &vertices, int nThreads = 1);
+	// write binary STL of vertices as from ReadSTL, facet normals from each triangle's first vertex
 
 // Normals
 
-void Normalize(vector<vec3> &points, float scale = 1);
+void MinMax(vector<vec3> &points, vec3 &min, vec3 &max, int nThreads = 1);
+
+void MinMax(vector<VertexSTL> &vertices, vec3 &min, vec3 &max, int nThreads = 1);
+	// bounding box of the points
+
+void Normalize(vector<vec3> &points, float scale = 1, int nThreads = 1);
 
-void Normalize(vector<VertexSTL> &vertices, float scale = 1);
-	// translate and apply uniform scale so that vertices fit in -1,1 in X,Y and 0,1 in Z
+void Normalize(vector<VertexSTL> &vertices, float scale = 1, int nThreads = 1);
+	// translate and apply uniform scale so that vertices fit in -1,1 in X,Y and 0,1 in Z;
+	// nThreads as for ReadAsciiObj
 
-void SetVertexNormals(vector<vec3> &points, vector<int3> &triangles, vector<vec3> &normals);
-	// compute/recompute vertex normals as the average of surrounding triangle normals
+enum NormalWeight { UnitWeight, AreaWeight, AngleWeight };
+	// each triangle normal counts once, in proportion to triangle area, or to the angle at the vertex
+
+class VertexTriangles {
+	// corners about each vertex, as 3*triangle+k, ascending; valid while triangles are unchanged
+public:
+	vector<int> start, corners;					// vertex v's corners are corners[start[v]] to corners[start[v+1]-1]
+	void Set(int nPoints, vector<int3> &triangles);
+};
+
+void SetVertexNormals(vector<vec3> &points, vector<int3> &triangles, vector<vec3> &normals,
+					  NormalWeight weight = UnitWeight, int nThreads = 1);
+void SetVertexNormals(vector<vec3> &points, vector<int3> &triangles, vector<vec3> &normals,
+					  VertexTriangles &adjacency, NormalWeight weight = UnitWeight, int nThreads = 1);
+	// compute/recompute vertex normals as the weighted average of surrounding triangle normals;
+	// each vertex gathers from its triangles, so threads don't conflict and the result doesn't depend on nThreads
+
+void UpdateVertexNormals(vector<vec3> &points, vector<int3> &triangles, vector<vec3> &normals, VertexTriangles &adjacency,
+						 vector<int> &modifiedTriangles, NormalWeight weight = UnitWeight, int nThreads = 1);
+	// after points move, recompute normals only at the vertices of modifiedTriangles, which should
+	// include every triangle that uses a moved point; adjacency must be Set from the current triangles
 
 // Texture
 
+class TargaReader {
+	// targa image, uncompressed or run-length encoded, of 8 (grey), 24 (BGR) or 32 (BGRA) bits per pixel
+public:
+	int width, height, bitsPerPixel;
+	bool topDown;								// rows in the file run top down (else bottom up, as GL expects)
+	TargaReader(const char *filename);
+	~TargaReader();
+	bool Valid() { return file != NULL; }
+	int RowBytes() { return width*(bitsPerPixel/8); }
+	int ImageRow(int fileRow) { return topDown? height-1-fileRow : fileRow; }
+		// bottom up (GL) row of the given row in file order
+	int ReadRows(char *rows, int nRows);
+		// decode the next nRows rows, in file order, to rows (nRows*RowBytes() bytes); return # rows read
+private:
+	MappedFile *file;
+	const unsigned char *p, *end;
+	bool rle, packetRun;
+	int nRowsRead, packetLeft;
+	unsigned char packetPixel[4];
+	TargaReader(const TargaReader &);			// not copyable
+	TargaReader &operator=(const TargaReader &);
+};
+
 char *ReadTexture(const char *filename, int &width, int &height, int &bitsPerPixel);
+	// return pixels as in the file, in bottom up row order; caller frees with delete []
+
+char *ReadTexture(const char *filename, int &width, int &height);
+	// as above, but converted to 24 bit BGR
+
+void Luminance(const unsigned char *pixels, unsigned char *lum, int nPixels, int bytesPerPixel = 3);
+	// convert BGR (or BGRA) pixels to .21 red + .72 green + .07 blue, in 8 bit fixed point
 
-GLuint SetHeightfield(const char *filename, int whichTexture = 0);
+char *ReadLuminance(const char *filename, int &width, int &height);
+	// read targa file as luminance, a block of rows at a time, in bottom up row order
 
 #endif
@@ -0,0 +1,250 @@
+/* ======================================
+   MeshLoader.cpp - background mesh loading, progressive display
+   Copyright (c) Jules Bloomenthal, Seattle, 2012
+   All rights reserved
+   ====================================== */
+
+#include "MeshLoader.h"
+#include "GLSL.h"
+#include "MeshIO.h"
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Loader
+
+static std::string Extension(const std::string &filename) {
+	// lower case, from the last '.' of the name after any directories; empty if none
+	size_t dot = filename.rfind('.'), slash = filename.find_last_of("/\\");
+	std::string ext = dot == std::string::npos || (slash != std::string::npos && dot < slash)? "" : filename.substr(dot);
+	for (size_t i = 0; i < ext.size(); i++)
+		ext[i] = (char) tolower(ext[i]);
+	return ext;
+}
+
+MeshLoader::MeshLoader() : queue(16), cancel(false), finished(true), failed(false) { }
+
+MeshLoader::~MeshLoader() { Stop(); }
+
+bool MeshLoader::Start(const char *filename, std::function<void(MeshChunk &)> prepare, int chunkTriangles) {
+	if (thread.joinable() && Loading())
+		return false;
+	Stop();
+	std::string ext = Extension(filename);
+	if (ext != ".obj" && ext != ".stl" && ext != ".ply")
+		return false;
+	cancel = false;
+	failed = false;
+	finished = false;
+	thread = std::thread(&MeshLoader::Run, this, std::string(filename), prepare, chunkTriangles < 1? 1 : chunkTriangles);
+	return true;
+}
+
+MeshChunk *MeshLoader::Next() {
+	MeshChunk *chunk = NULL;
+	return queue.Pop(chunk)? chunk : NULL;
+}
+
+bool MeshLoader::Loading() {
+	// finished is set after the last push, so test it first
+	return !finished.load(std::memory_order_acquire) || !queue.Empty();
+}
+
+bool MeshLoader::Failed() { return failed; }
+
+void MeshLoader::Stop() {
+	cancel = true;
+	if (thread.joinable())
+		thread.join();
+	for (MeshChunk *chunk; (chunk = Next()) != NULL; )
+		delete chunk;
+	finished = true;
+}
+
+bool MeshLoader::Publish(MeshChunk *chunk) {
+	// queue chunk, waiting while the display catches up; false (and chunk deleted) if cancelled
+	while (!queue.Push(chunk)) {
+		if (cancel) {
+			delete chunk;
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+static MeshChunk *Piece(vector<vec3> &points, vector<int3> &triangles, int first, int count,
+						vector<int> &localIds, vector<int> &stamps, int stamp) {
+	// chunk of triangles[first, first+count) with the points they use, renumbered, and normals
+	// averaged over these triangles only (so seams between chunks may show until the whole mesh)
+	MeshChunk *c = new MeshChunk;
+	c->triangles.resize(count);
+	for (int t = 0; t < count; t++) {
+		int *vids = &triangles[first+t].i1, *local = &c->triangles[t].i1;
+		for (int k = 0; k < 3; k++) {
+			int v = vids[k];
+			if (stamps[v] != stamp) {
+				stamps[v] = stamp;
+				localIds[v] = (int) c->points.size();
+				c->points.push_back(points[v]);
+			}
+			local[k] = localIds[v];
+		}
+	}
+	SetVertexNormals(c->points, c->triangles, c->normals);
+	return c;
+}
+
+void MeshLoader::Run(std::string filename, std::function<void(MeshChunk &)> prepare, int chunkTriangles) {
+	clock_t start = clock();
+	const char *name = filename.c_str();
+	char *cname = (char *) name;				// for readers taking char *
+	std::string ext = Extension(filename);
+	MeshChunk *whole = new MeshChunk;
+	bool ok = false;
+	int nPieces = 0;
+	if (ext == ".stl") {
+		// preview facets as they stream, keep them to weld once all are read
+		vector<VertexSTL> soup;
+		ok = StreamSTL(name, [&](MeshBatch &b) {
+			int nTris = (int) b.points.size()/3;
+			for (int t = 0; t < nTris && !cancel; t += chunkTriangles) {
+				int n = nTris-t < chunkTriangles? nTris-t : chunkTriangles;
+				MeshChunk *c = new MeshChunk;
+				c->points.assign(b.points.begin()+3*t, b.points.begin()+3*(t+n));
+				c->normals.assign(b.normals.begin()+3*t, b.normals.begin()+3*(t+n));
+				c->triangles.resize(n);
+				for (int i = 0; i < n; i++)
+					c->triangles[i] = int3(3*i, 3*i+1, 3*i+2);
+				nPieces++;
+				if (!Publish(c))
+					return false;
+			}
+			for (size_t i = 0; i < b.points.size(); i++)
+				soup.push_back(VertexSTL(&b.points[i].x, &b.normals[i].x));
+			return !cancel;
+		});
+		if (ok && !cancel)
+			WeldSTL(soup, whole->points, whole->triangles);
+	}
+	if (ext == ".obj") {
+		// the whole mesh, with normals, uvs and seams as ReadAsciiObj makes them (and cached); if
+		// the file is parsed, the faces of each block are previewed as they join the mesh
+		vector<int> localIds, stamps;
+		ok = ReadObjCached(cname, whole->points, whole->triangles, &whole->normals, &whole->uvs, NULL, 1, [&](int first) {
+			localIds.resize(whole->points.size());
+			stamps.resize(whole->points.size(), -1);
+			int nTris = (int) whole->triangles.size();
+			for (int t = first; t < nTris && !cancel; t += chunkTriangles) {
+				int n = nTris-t < chunkTriangles? nTris-t : chunkTriangles;
+				nPieces++;
+				if (!Publish(Piece(whole->points, whole->triangles, t, n, localIds, stamps, nPieces)))
+					return false;
+			}
+			return !cancel;
+		});
+		ok = ok && !cancel;
+	}
+	if (ext == ".ply")
+		ok = ReadPly(name, whole->points, whole->triangles, &whole->normals, &whole->uvs);
+	if (ok && !cancel) {
+		if (prepare)
+			prepare(*whole);
+		whole->complete = true;
+		float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+		printf("loaded %s: %i triangles in %.2f secs (%i preview chunks)\n", name, (int) whole->triangles.size(), dt, nPieces);
+		Publish(whole);
+	}
+	else {
+		if (!cancel)
+			printf("can't load %s\n", name);
+		failed = !cancel;
+		delete whole;
+	}
+	finished.store(true, std::memory_order_release);
+}
+
+// Progressive display
+
+MeshChunk *ProgressiveMesh::Upload(MeshLoader &loader, int maxChunks) {
+	for (int i = 0; i < maxChunks; i++) {
+		MeshChunk *c = loader.Next();
+		if (!c)
+			break;
+		if (c->complete)
+			return c;
+		Buffers b;
+		b.nPoints = (int) c->points.size();
+		b.nTriangles = (int) c->triangles.size();
+		int sizePts = b.nPoints*sizeof(vec3), sizeNrms = (int) c->normals.size()*sizeof(vec3);
+		glGenBuffers(1, &b.vBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, b.vBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizePts+sizeNrms, NULL, GL_STATIC_DRAW);
+		if (sizePts)
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizePts, &c->points[0]);
+		if (sizeNrms)
+			glBufferSubData(GL_ARRAY_BUFFER, sizePts, sizeNrms, &c->normals[0]);
+		glGenBuffers(1, &b.eBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.eBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, b.nTriangles*sizeof(int3), b.nTriangles? &c->triangles[0] : NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		buffers.push_back(b);
+		vec3 cmin(FLT_MAX), cmax(-FLT_MAX);
+		for (int k = 0; k < b.nPoints; k++)
+			for (int j = 0; j < 3; j++) {
+				float v = c->points[k][j];
+				cmin[j] = v < cmin[j]? v : cmin[j];
+				cmax[j] = v > cmax[j]? v : cmax[j];
+			}
+		bounds.Add(cmin, cmax);
+		for (int j = 0; j < 3; j++) {
+			min[j] = cmin[j] < min[j]? cmin[j] : min[j];
+			max[j] = cmax[j] > max[j]? cmax[j] : max[j];
+		}
+		nPoints += b.nPoints;
+		nTriangles += b.nTriangles;
+		delete c;
+	}
+	return NULL;
+}
+
+mat4 ProgressiveMesh::Fit(float scale) {
+	if (!nPoints)
+		return mat4();
+	vec3 center = .5f*(min+max), dif(max-min);
+	float range = dif.x > dif.y? (dif.x > dif.z? dif.x : dif.z) : (dif.y > dif.z? dif.y : dif.z);
+	float s = range > 0? scale*2.f/range : 1;
+	return Scale(s, s, s)*Translate(-center);
+}
+
+void ProgressiveMesh::Draw(int shader, bool normals, mat4 *fullview) {
+	int nDraw = (int) buffers.size();
+	if (fullview) {
+		ViewFrustum f(*fullview);
+		nDraw = Cull(f, bounds, visible);
+	}
+	for (int i = 0; i < nDraw; i++) {
+		Buffers &b = buffers[fullview? visible[i] : i];
+		glBindBuffer(GL_ARRAY_BUFFER, b.vBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.eBuffer);
+		GLSL::VertexAttribPointer(shader, "point", 3, GL_FLOAT, GL_FALSE, 0, (void *) 0);
+		if (normals)
+			GLSL::VertexAttribPointer(shader, "normal", 3, GL_FLOAT, GL_FALSE, 0, (void *) (b.nPoints*sizeof(vec3)));
+		glDrawElements(GL_TRIANGLES, 3*b.nTriangles, GL_UNSIGNED_INT, (void *) 0);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void ProgressiveMesh::Clear() {
+	for (size_t i = 0; i < buffers.size(); i++) {
+		glDeleteBuffers(1, &buffers[i].vBuffer);
+		glDeleteBuffers(1, &buffers[i].eBuffer);
+	}
+	buffers.resize(0);
+	bounds.Clear();
+	nPoints = nTriangles = 0;
+	min = vec3(FLT_MAX);
+	max = vec3(-FLT_MAX);
+}
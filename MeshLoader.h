@@ -0,0 +1,123 @@
+/*	==============================
+    MeshLoader.h - read meshes on a background thread, display them as they arrive
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef MESHLOADER_HDR
+#define MESHLOADER_HDR
+
+#include <float.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glew.h"
+#include "mat.h"
+#include "Cull.h"
+
+using std::vector;
+
+// Queue
+
+template<class T> class SpscQueue {
+	// lock-free ring for one producer thread and one consumer thread;
+	// one slot stays empty to tell a full ring from an empty one
+public:
+	SpscQueue(int capacity = 16) : items(capacity+1), size(capacity+1), head(0), tail(0) { }
+	bool Push(const T &t) {
+		// producer: return false if full
+		int h = head.load(std::memory_order_relaxed), next = (h+1)%size;
+		if (next == tail.load(std::memory_order_acquire))
+			return false;
+		items[h] = t;
+		head.store(next, std::memory_order_release);	// publishes items[h]
+		return true;
+	}
+	bool Pop(T &t) {
+		// consumer: return false if empty
+		int tl = tail.load(std::memory_order_relaxed);
+		if (tl == head.load(std::memory_order_acquire))
+			return false;
+		t = items[tl];
+		tail.store((tl+1)%size, std::memory_order_release);
+		return true;
+	}
+	bool Empty() { return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire); }
+private:
+	vector<T> items;
+	int size;
+	alignas(64) std::atomic<int> head;			// written by producer only
+	alignas(64) std::atomic<int> tail;			// written by consumer only
+};
+
+// Background loading
+
+struct MeshChunk {
+	vector<vec3> points, normals;				// normals one per point
+	vector<vec2> uvs;							// one per point, or none
+	vector<int3> triangles;						// index points of this chunk
+	bool complete;								// the whole mesh, not a preview piece
+	MeshChunk() : complete(false) { }
+};
+
+class MeshLoader {
+public:
+	MeshLoader();
+	~MeshLoader();
+	bool Start(const char *filename, std::function<void(MeshChunk &)> prepare = nullptr, int chunkTriangles = 1 << 16);
+		// begin reading filename (.obj, .stl or .ply) on a thread of its own; return false if not
+		// a supported type or already loading
+		// while a file streams, pieces of about chunkTriangles triangles, each with its own points
+		// and (facet or chunk-local) normals, are queued for preview; the whole mesh (welded if STL,
+		// with the file's normals and uvs if OBJ, by way of its .mbin cache) follows as a last chunk
+		// marked complete; prepare, if given, is called on that chunk on the loader thread, so work
+		// such as normalizing or building meshlets stays off the display thread; data prepare writes
+		// elsewhere may be read once the complete chunk has been taken by Next
+		// an OBJ with a current cache, and a PLY, arrive as the complete chunk alone
+	MeshChunk *Next();
+		// return the next chunk, NULL if none is ready; the caller deletes it
+	bool Loading();
+		// true until the last chunk has been taken
+	bool Failed();
+		// true if the file could not be read
+	void Stop();
+		// cancel loading, wait for the thread, delete chunks not taken
+private:
+	std::thread thread;
+	SpscQueue<MeshChunk *> queue;
+	std::atomic<bool> cancel, finished, failed;
+	bool Publish(MeshChunk *chunk);
+	void Run(std::string filename, std::function<void(MeshChunk &)> prepare, int chunkTriangles);
+	MeshLoader(const MeshLoader &);
+	MeshLoader &operator=(const MeshLoader &);
+};
+
+// Progressive display
+
+class ProgressiveMesh {
+	// preview chunks in GPU buffers of their own, drawn as they arrive
+public:
+	int nPoints, nTriangles;
+	vec3 min, max;								// bounds of chunks so far
+	ProgressiveMesh() : nPoints(0), nTriangles(0), min(FLT_MAX), max(-FLT_MAX) { }
+	MeshChunk *Upload(MeshLoader &loader, int maxChunks = 4);
+		// take up to maxChunks preview chunks from loader and upload each; if the complete mesh
+		// arrives, stop and return it (the caller deletes it), else return NULL
+	mat4 Fit(float scale = 1);
+		// uniform scale and translation of the bounds to +/-scale (as Normalize)
+	void Draw(int shader, bool normals = true, mat4 *fullview = NULL);
+		// draw chunks with vec3 "point" and, if normals, vec3 "normal" attributes of shader;
+		// if fullview (including any Fit) is non-null, skip chunks whose bounds are out of its
+		// view; leaves no element buffer bound
+	void Clear();
+		// delete GPU buffers
+private:
+	struct Buffers { GLuint vBuffer, eBuffer; int nPoints, nTriangles; };
+	vector<Buffers> buffers;
+	Boxes bounds;								// one per buffers
+	vector<int> visible;
+};
+
+#endif
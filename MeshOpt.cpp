@@ -0,0 +1,413 @@
+/* ======================================
+   MeshOpt.cpp - vertex cache and vertex fetch ordering
+   Copyright (c) Jules Bloomenthal, Seattle, 2012
+   All rights reserved
+   ====================================== */
+
+#include "MeshOpt.h"
+#include "Cull.h"
+#include "MeshIO.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+// Cache simulation
+
+void VertexCacheStats(vector<int3> &triangles, int nPoints, float &acmr, float &atvr, int cacheSize) {
+	// a vertex is in the FIFO if fewer than cacheSize misses have occurred since it was loaded
+	vector<int> loadedAt(nPoints, -cacheSize-1);
+	int nMisses = 0;
+	for (size_t t = 0; t < triangles.size(); t++) {
+		int *vids = &triangles[t].i1;
+		for (int k = 0; k < 3; k++)
+			if (nMisses-loadedAt[vids[k]] > cacheSize)
+				loadedAt[vids[k]] = nMisses++;
+	}
+	acmr = triangles.size()? (float) nMisses/triangles.size() : 0;
+	atvr = nPoints? (float) nMisses/nPoints : 0;
+}
+
+// Vertex cache optimization
+
+static const int MaxCacheSize = 64;
+
+static float VertexScore(int cachePosition, int nRemaining, int cacheSize) {
+	// Forsyth's score: the last triangle's vertices are a fixed .75 (so its neighbors aren't always
+	// preferred), older entries fall off with position; vertices with few triangles left score high
+	// so they are finished rather than stranded
+	if (!nRemaining)
+		return -1;
+	float score = 0;
+	if (cachePosition >= 0)
+		score = cachePosition < 3? .75f : pow(1-(float) (cachePosition-3)/(cacheSize-3), 1.5f);
+	return score+2/sqrt((float) nRemaining);
+}
+
+void OptimizeVertexCache(vector<int3> &triangles, int nPoints, int cacheSize, vector<int> *triangleGroups) {
+	int nTriangles = (int) triangles.size();
+	if (cacheSize > MaxCacheSize)
+		cacheSize = MaxCacheSize;
+	if (cacheSize < 4)
+		cacheSize = 4;
+	// live triangles about each vertex: the first nRemaining[v] of its adjacency row
+	VertexTriangles adjacency;
+	adjacency.Set(nPoints, triangles);
+	vector<int> &vTriangles = adjacency.corners, nRemaining(nPoints), cachePosition(nPoints, -1);
+	for (size_t c = 0; c < vTriangles.size(); c++)
+		vTriangles[c] /= 3;
+	vector<float> vScores(nPoints), tScores(nTriangles);
+	for (int v = 0; v < nPoints; v++) {
+		nRemaining[v] = adjacency.start[v+1]-adjacency.start[v];
+		vScores[v] = VertexScore(-1, nRemaining[v], cacheSize);
+	}
+	int best = -1;
+	for (int t = 0; t < nTriangles; t++) {
+		int3 &tri = triangles[t];
+		tScores[t] = vScores[tri.i1]+vScores[tri.i2]+vScores[tri.i3];
+		if (best < 0 || tScores[t] > tScores[best])
+			best = t;
+	}
+	vector<bool> emitted(nTriangles, false);
+	vector<int3> order(nTriangles);
+	vector<int> orderIds(nTriangles);
+	int cache[MaxCacheSize+3], newCache[MaxCacheSize+3], nCache = 0, cursor = 0;
+	for (int n = 0; n < nTriangles; n++) {
+		if (best < 0) {
+			// nothing in the cache has triangles left: take the next unused triangle in the input
+			while (emitted[cursor])
+				cursor++;
+			best = cursor;
+		}
+		emitted[best] = true;
+		order[n] = triangles[best];
+		orderIds[n] = best;
+		int *vids = &triangles[best].i1;
+		// take best from its vertices' live triangles
+		for (int k = 0; k < 3; k++) {
+			int v = vids[k], *row = &vTriangles[adjacency.start[v]];
+			for (int i = 0; i < nRemaining[v]; i++)
+				if (row[i] == best) {
+					row[i] = row[--nRemaining[v]];
+					break;
+				}
+		}
+		// best's vertices go to the front of the cache, then older entries
+		int nNew = 0;
+		for (int k = 0; k < 3; k++)
+			newCache[nNew++] = vids[k];
+		for (int i = 0; i < nCache; i++) {
+			int v = cache[i];
+			if (v != vids[0] && v != vids[1] && v != vids[2])
+				newCache[nNew++] = v;
+		}
+		// rescore vertices whose position changed, including those pushed out, then their triangles
+		for (int i = 0; i < nNew; i++) {
+			int v = newCache[i];
+			cachePosition[v] = i < cacheSize? i : -1;
+			vScores[v] = VertexScore(cachePosition[v], nRemaining[v], cacheSize);
+		}
+		best = -1;
+		for (int i = 0; i < nNew; i++) {
+			int v = newCache[i], *row = &vTriangles[adjacency.start[v]];
+			for (int j = 0; j < nRemaining[v]; j++) {
+				int t = row[j];
+				int3 &tri = triangles[t];
+				tScores[t] = vScores[tri.i1]+vScores[tri.i2]+vScores[tri.i3];
+				if (best < 0 || tScores[t] > tScores[best])
+					best = t;
+			}
+		}
+		nCache = nNew < cacheSize? nNew : cacheSize;
+		for (int i = 0; i < nCache; i++)
+			cache[i] = newCache[i];
+	}
+	triangles.swap(order);
+	if (triangleGroups && (int) triangleGroups->size() == nTriangles) {
+		vector<int> groups(nTriangles);
+		for (int n = 0; n < nTriangles; n++)
+			groups[n] = (*triangleGroups)[orderIds[n]];
+		triangleGroups->swap(groups);
+	}
+}
+
+// Vertex fetch optimization
+
+template<class T> static void Permute(vector<T> &a, vector<int> &remap, int nUsed) {
+	// move a[i] to a[remap[i]], dropping entries with remap -1
+	vector<T> b(nUsed);
+	for (size_t i = 0; i < a.size(); i++)
+		if (remap[i] >= 0)
+			b[remap[i]] = a[i];
+	a.swap(b);
+}
+
+void OptimizeVertexFetch(vector<vec3> &points, vector<int3> &triangles, vector<vec3> *normals, vector<vec2> *uvs) {
+	int nPoints = (int) points.size(), nUsed = 0;
+	vector<int> remap(nPoints, -1);
+	for (size_t t = 0; t < triangles.size(); t++) {
+		int *vids = &triangles[t].i1;
+		for (int k = 0; k < 3; k++) {
+			if (remap[vids[k]] < 0)
+				remap[vids[k]] = nUsed++;
+			vids[k] = remap[vids[k]];
+		}
+	}
+	if (normals && (int) normals->size() == nPoints)
+		Permute(*normals, remap, nUsed);
+	if (uvs && (int) uvs->size() == nPoints)
+		Permute(*uvs, remap, nUsed);
+	Permute(points, remap, nUsed);
+}
+
+void OptimizeMesh(vector<vec3> &points, vector<int3> &triangles, vector<vec3> *normals, vector<vec2> *uvs, vector<int> *triangleGroups) {
+	// an already well ordered mesh (as from a previous pass or another tool) can come out slightly
+	// worse, so the new triangle order is kept only if it simulates better
+	float acmr0, atvr0, acmr1, atvr1;
+	int nPoints = (int) points.size();
+	VertexCacheStats(triangles, nPoints, acmr0, atvr0);
+	vector<int3> oldTriangles(triangles);
+	vector<int> oldGroups(triangleGroups? *triangleGroups : vector<int>());
+	OptimizeVertexCache(triangles, nPoints, 32, triangleGroups);
+	VertexCacheStats(triangles, nPoints, acmr1, atvr1);
+	if (acmr1 >= acmr0) {
+		triangles.swap(oldTriangles);
+		if (triangleGroups)
+			triangleGroups->swap(oldGroups);
+	}
+	OptimizeVertexFetch(points, triangles, normals, uvs);
+	VertexCacheStats(triangles, (int) points.size(), acmr1, atvr1);
+	printf("vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", acmr0, acmr1, atvr0, atvr1);
+}
+
+// Meshlets
+
+static void SetMeshletBounds(vector<vec3> &points, vector<int3> &triangles, Meshlet &m, vector<int> &stamps, int stamp) {
+	// sphere about the center of the vertices' bounding box; cone about the average triangle normal
+	vec3 min(FLT_MAX), max(-FLT_MAX), axis(0, 0, 0);
+	vector<vec3> normals(m.nTriangles);
+	m.nVertices = 0;
+	for (int i = 0; i < m.nTriangles; i++) {
+		int *vids = &triangles[m.firstTriangle+i].i1;
+		for (int k = 0; k < 3; k++) {
+			vec3 &p = points[vids[k]];
+			if (stamps[vids[k]] != stamp) {
+				stamps[vids[k]] = stamp;
+				m.nVertices++;
+			}
+			for (int j = 0; j < 3; j++) {
+				min[j] = p[j] < min[j]? p[j] : min[j];
+				max[j] = p[j] > max[j]? p[j] : max[j];
+			}
+		}
+		vec3 &p1 = points[vids[0]], n = cross(points[vids[1]]-p1, points[vids[2]]-p1);
+		float len = length(n);
+		normals[i] = len > 0? n/len : vec3(0, 0, 0);
+		axis += normals[i];
+	}
+	m.center = .5f*(min+max);
+	m.radius = 0;
+	for (int i = 0; i < m.nTriangles; i++) {
+		int *vids = &triangles[m.firstTriangle+i].i1;
+		for (int k = 0; k < 3; k++) {
+			float d = length(points[vids[k]]-m.center);
+			m.radius = d > m.radius? d : m.radius;
+		}
+	}
+	float len = length(axis), minDot = 1;
+	m.coneAxis = len > 0? axis/len : vec3(0, 0, 1);
+	for (int i = 0; i < m.nTriangles; i++) {
+		float d = dot(normals[i], m.coneAxis);
+		minDot = d < minDot? d : minDot;
+	}
+	// a cone much wider than a hemisphere (or a degenerate axis) can't be culled
+	m.coneCutoff = len == 0 || minDot <= .1f? 1 : sqrt(1-minDot*minDot);
+}
+
+void BuildMeshlets(vector<vec3> &points, vector<int3> &triangles, vector<Meshlet> &meshlets,
+				   int maxVertices, int maxTriangles, vector<int> *triangleGroups) {
+	clock_t start = clock();
+	int nPoints = (int) points.size(), nTriangles = (int) triangles.size();
+	VertexTriangles adjacency;
+	adjacency.Set(nPoints, triangles);
+	vector<int> &corners = adjacency.corners, order;
+	vector<bool> used(nTriangles, false);
+	vector<int> inMeshlet(nPoints, -1), candidateOf(nTriangles, -1), candidates, nLiveTriangles(nPoints);
+	for (int v = 0; v < nPoints; v++)
+		nLiveTriangles[v] = adjacency.start[v+1]-adjacency.start[v];
+	order.reserve(nTriangles);
+	meshlets.resize(0);
+	int cursor = 0;
+	while ((int) order.size() < nTriangles) {
+		int id = (int) meshlets.size(), nVertices = 0, next = -1;
+		Meshlet m;
+		m.firstTriangle = (int) order.size();
+		m.nTriangles = 0;
+		// seed with the last meshlet's leftover candidate with fewest unused triangles about its
+		// vertices (so regions are filled from their edges, not left as fragments), else the next unused
+		int fewest = INT_MAX;
+		for (size_t i = 0; i < candidates.size(); i++) {
+			int t = candidates[i], *tv = &triangles[t].i1;
+			if (used[t])
+				continue;
+			int nLive = nLiveTriangles[tv[0]]+nLiveTriangles[tv[1]]+nLiveTriangles[tv[2]];
+			if (nLive < fewest) {
+				fewest = nLive;
+				next = t;
+			}
+		}
+		if (next < 0) {
+			while (used[cursor])
+				cursor++;
+			next = cursor;
+		}
+		candidates.resize(0);
+		vec3 sum(0, 0, 0);
+		while (next >= 0) {
+			used[next] = true;
+			order.push_back(next);
+			m.nTriangles++;
+			int *vids = &triangles[next].i1;
+			for (int k = 0; k < 3; k++) {
+				int v = vids[k];
+				nLiveTriangles[v]--;
+				if (inMeshlet[v] == id)
+					continue;
+				inMeshlet[v] = id;
+				nVertices++;
+				sum += points[v];
+				// the new vertex's triangles become candidates
+				for (int c = adjacency.start[v]; c < adjacency.start[v+1]; c++) {
+					int t = corners[c]/3;
+					if (!used[t] && candidateOf[t] != id) {
+						candidateOf[t] = id;
+						candidates.push_back(t);
+					}
+				}
+			}
+			if (m.nTriangles == maxTriangles)
+				break;
+			// fewest new vertices, then nearest to the meshlet's centroid; drop used candidates
+			vec3 centroid = sum/(float) nVertices;
+			int bestNew = 4, bestLive = INT_MAX, n = 0;
+			float bestDist = FLT_MAX;
+			next = -1;
+			for (size_t i = 0; i < candidates.size(); i++) {
+				int t = candidates[i], nNew = 0;
+				if (used[t])
+					continue;
+				candidates[n++] = t;
+				int *tv = &triangles[t].i1;
+				for (int k = 0; k < 3; k++)
+					nNew += inMeshlet[tv[k]] != id;
+				if (nNew > bestNew || nVertices+nNew > maxVertices)
+					continue;
+				int nLive = nLiveTriangles[tv[0]]+nLiveTriangles[tv[1]]+nLiveTriangles[tv[2]];
+				vec3 d = points[tv[0]]+points[tv[1]]+points[tv[2]]-3*centroid;
+				float dist = dot(d, d);
+				if (nNew < bestNew || (nNew == bestNew && (nLive < bestLive || (nLive == bestLive && dist < bestDist)))) {
+					bestNew = nNew;
+					bestLive = nLive;
+					bestDist = dist;
+					next = t;
+				}
+			}
+			candidates.resize(n);
+		}
+		meshlets.push_back(m);
+	}
+	// reorder triangles (and groups) by meshlet
+	vector<int3> reordered(nTriangles);
+	for (int i = 0; i < nTriangles; i++)
+		reordered[i] = triangles[order[i]];
+	triangles.swap(reordered);
+	if (triangleGroups && (int) triangleGroups->size() == nTriangles) {
+		vector<int> groups(nTriangles);
+		for (int i = 0; i < nTriangles; i++)
+			groups[i] = (*triangleGroups)[order[i]];
+		triangleGroups->swap(groups);
+	}
+	vector<int> stamps(nPoints, -1);
+	int nMeshlets = (int) meshlets.size(), nVertices = 0;
+	for (int i = 0; i < nMeshlets; i++) {
+		SetMeshletBounds(points, triangles, meshlets[i], stamps, i);
+		nVertices += meshlets[i].nVertices;
+	}
+	float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+	printf("%i meshlets in %.2f secs, average %.1f triangles, %.1f vertices\n", nMeshlets, dt,
+		nMeshlets? (float) nTriangles/nMeshlets : 0.f, nMeshlets? (float) nVertices/nMeshlets : 0.f);
+}
+
+void OptimizeMeshlets(vector<int3> &triangles, vector<Meshlet> &meshlets, int nPoints, int cacheSize, vector<int> *triangleGroups) {
+	// renumber each meshlet's vertices from zero so the optimizer's per-vertex tables stay small
+	float acmr0, acmr1, atvr;
+	VertexCacheStats(triangles, nPoints, acmr0, atvr);
+	bool groups = triangleGroups && triangleGroups->size() == triangles.size();
+	vector<int> local(nPoints, -1), global, mGroups;
+	vector<int3> mTriangles;
+	for (size_t i = 0; i < meshlets.size(); i++) {
+		Meshlet &m = meshlets[i];
+		mTriangles.resize(m.nTriangles);
+		global.resize(0);
+		for (int t = 0; t < m.nTriangles; t++) {
+			int *vids = &triangles[m.firstTriangle+t].i1, *mVids = &mTriangles[t].i1;
+			for (int k = 0; k < 3; k++) {
+				int v = vids[k];
+				if (local[v] < 0) {
+					local[v] = (int) global.size();
+					global.push_back(v);
+				}
+				mVids[k] = local[v];
+			}
+		}
+		if (groups)
+			mGroups.assign(triangleGroups->begin()+m.firstTriangle, triangleGroups->begin()+m.firstTriangle+m.nTriangles);
+		int nVertices = (int) global.size();
+		float before, after;
+		VertexCacheStats(mTriangles, nVertices, before, atvr);
+		OptimizeVertexCache(mTriangles, nVertices, cacheSize, groups? &mGroups : NULL);
+		VertexCacheStats(mTriangles, nVertices, after, atvr);
+		if (after < before)
+			for (int t = 0; t < m.nTriangles; t++) {
+				int *vids = &triangles[m.firstTriangle+t].i1, *mVids = &mTriangles[t].i1;
+				for (int k = 0; k < 3; k++)
+					vids[k] = global[mVids[k]];
+				if (groups)
+					(*triangleGroups)[m.firstTriangle+t] = mGroups[t];
+			}
+		for (int v = 0; v < nVertices; v++)
+			local[global[v]] = -1;
+	}
+	VertexCacheStats(triangles, nPoints, acmr1, atvr);
+	printf("meshlet vertex cache: ACMR %.3f -> %.3f\n", acmr0, acmr1);
+}
+
+int CullMeshlets(vector<Meshlet> &meshlets, mat4 &fullview, vec3 *eye, vector<int2> &ranges, float margin) {
+	// the side planes of the frustum (the first four); they meet at the eye, so together they
+	// also reject whatever is behind it
+	ViewFrustum f(fullview);
+	vec4 *planes = f.planes;
+	int nVisible = 0;
+	ranges.resize(0);
+	for (size_t i = 0; i < meshlets.size(); i++) {
+		Meshlet &m = meshlets[i];
+		float r = m.radius+margin;
+		bool visible = true;
+		for (int k = 0; k < 4 && visible; k++)
+			visible = planes[k].x*m.center.x+planes[k].y*m.center.y+planes[k].z*m.center.z+planes[k].w >= -r;
+		if (visible && eye) {
+			// back facing if every normal in the cone points away from every point of the sphere
+			vec3 v = m.center-*eye;
+			visible = dot(v, m.coneAxis) < m.coneCutoff*length(v)+r;
+		}
+		if (!visible)
+			continue;
+		if (ranges.size() && ranges.back().i1+ranges.back().i2 == m.firstTriangle)
+			ranges.back().i2 += m.nTriangles;
+		else
+			ranges.push_back(int2(m.firstTriangle, m.nTriangles));
+		nVisible += m.nTriangles;
+	}
+	return nVisible;
+}
@@ -0,0 +1,65 @@
+/*	==============================
+    MeshOpt.h - reorder meshes for the GPU vertex cache and vertex fetch
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef MESHOPT_HDR
+#define MESHOPT_HDR
+
+#include <vector>
+#include "mat.h"
+
+using std::vector;
+
+// Cache simulation
+
+void VertexCacheStats(vector<int3> &triangles, int nPoints, float &acmr, float &atvr, int cacheSize = 16);
+	// simulate a FIFO post-transform cache of cacheSize vertices; acmr is vertex transforms per triangle
+	// (3 worst, about .5 best for large regular meshes), atvr is transforms per vertex (1 best)
+
+// Optimization
+
+void OptimizeVertexCache(vector<int3> &triangles, int nPoints, int cacheSize = 32, vector<int> *triangleGroups = NULL);
+	// reorder triangles so vertices are reused while in the cache (Forsyth, "Linear-Speed Vertex Cache
+	// Optimisation", 2006); triangleGroups, if one per triangle, is reordered to match
+
+void OptimizeVertexFetch(vector<vec3> &points, vector<int3> &triangles, vector<vec3> *normals = NULL, vector<vec2> *uvs = NULL);
+	// renumber points in order of first use by triangles, so vertex reads move forward through memory;
+	// normals and uvs, if one per point, are permuted to match; unused points are dropped
+
+void OptimizeMesh(vector<vec3> &points, vector<int3> &triangles, vector<vec3> *normals = NULL, vector<vec2> *uvs = NULL,
+				  vector<int> *triangleGroups = NULL);
+	// OptimizeVertexCache (kept only if it lowers ACMR) then OptimizeVertexFetch;
+	// print ACMR and ATVR before and after
+
+// Meshlets
+
+struct Meshlet {
+	int   firstTriangle, nTriangles;			// range of triangles
+	int   nVertices;							// distinct vertices used
+	vec3  center;								// bounding sphere
+	float radius;
+	vec3  coneAxis;								// triangle normals lie within a cone about coneAxis
+	float coneCutoff;							// sine of its half angle (1 if too wide to cull)
+};
+
+void BuildMeshlets(vector<vec3> &points, vector<int3> &triangles, vector<Meshlet> &meshlets,
+				   int maxVertices = 64, int maxTriangles = 124, vector<int> *triangleGroups = NULL);
+	// reorder triangles into meshlets of at most maxVertices distinct vertices and maxTriangles
+	// triangles, each grown from a seed across shared vertices so it is spatially compact (fewest
+	// new vertices first, then fewest triangles left about them, then nearest); set each meshlet's
+	// bounds; triangleGroups, if one per triangle, is reordered to match
+
+void OptimizeMeshlets(vector<int3> &triangles, vector<Meshlet> &meshlets, int nPoints, int cacheSize = 32,
+					   vector<int> *triangleGroups = NULL);
+	// OptimizeVertexCache within each meshlet's range of triangles (kept only if it lowers the meshlet's
+	// ACMR), so the meshlet order from BuildMeshlets is preserved; follow with OptimizeVertexFetch
+
+int CullMeshlets(vector<Meshlet> &meshlets, mat4 &fullview, vec3 *eye, vector<int2> &ranges, float margin = 0);
+	// set ranges to (first triangle, # triangles) of the meshlets that may be within the side planes
+	// of the view frustum of fullview (persp*modelview) and, if eye (in model space) is non-null,
+	// may face it; adjacent meshlets are merged into one range; bounds are enlarged by margin
+	// (as for displacement); return # triangles in ranges
+
+#endif
@@ -0,0 +1,168 @@
+/* ======================================
+   MeshPack.cpp - quantized vertex format
+   Copyright (c) Jules Bloomenthal, Seattle, 2012
+   All rights reserved
+   ====================================== */
+
+#include "MeshPack.h"
+#include "MeshIO.h"
+#include "GLSL.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Half Floats
+
+unsigned short FloatToHalf(float f) {
+	unsigned int x;
+	memcpy(&x, &f, 4);
+	unsigned int sign = (x>>16)&0x8000, m = x&0x7fffff;
+	int e = (int) ((x>>23)&0xff);
+	if (e == 0xff)
+		return (unsigned short) (sign|0x7c00|(m? 0x200 : 0));	// infinity or nan
+	e += 15-127;
+	if (e >= 31)
+		return (unsigned short) (sign|0x7c00);
+	if (e <= 0) {
+		// subnormal half (or zero): shift the implicit 1 into the mantissa
+		if (e < -10)
+			return (unsigned short) sign;
+		m |= 0x800000;
+		int shift = 14-e;
+		unsigned int h = m>>shift, rem = m&((1u<<shift)-1), half = 1u<<(shift-1);
+		if (rem > half || (rem == half && (h&1)))
+			h++;
+		return (unsigned short) (sign|h);
+	}
+	unsigned int h = (e<<10)|(m>>13), rem = m&0x1fff;
+	if (rem > 0x1000 || (rem == 0x1000 && (h&1)))
+		h++;								// a carry into the exponent rounds up correctly, to infinity at most
+	return (unsigned short) (sign|h);
+}
+
+float HalfToFloat(unsigned short h) {
+	unsigned int sign = (h&0x8000)<<16, e = (h>>10)&0x1f, m = h&0x3ff, x;
+	if (e == 0) {
+		float f = ldexp((float) m, -24);
+		return sign? -f : f;
+	}
+	x = e == 31? sign|0x7f800000|(m<<13) : sign|((e+112)<<23)|(m<<13);
+	float f;
+	memcpy(&f, &x, 4);
+	return f;
+}
+
+// Normals
+
+static inline int Snorm(float f, int maxVal) {
+	f = f < -1? -1 : f > 1? 1 : f;
+	return (int) floor(f*maxVal+.5f);
+}
+
+static unsigned int PackNormal(vec3 n) {
+	// SNORM 10:10:10:2, x in the low bits
+	float len = length(n);
+	if (len > 0)
+		n /= len;
+	unsigned int x = Snorm(n.x, 511)&0x3ff, y = Snorm(n.y, 511)&0x3ff, z = Snorm(n.z, 511)&0x3ff;
+	return x|(y<<10)|(z<<20);
+}
+
+static inline float Unsnorm10(unsigned int c) {
+	int i = (int) (c&0x3ff);
+	i = i > 511? i-1024 : i;
+	float f = (float) i/511;
+	return f < -1? -1 : f;
+}
+
+static vec3 UnpackNormal(unsigned int c) {
+	return vec3(Unsnorm10(c), Unsnorm10(c>>10), Unsnorm10(c>>20));
+}
+
+// Packing
+
+void PackMesh(vector<vec3> &points, vector<vec3> *normals, vector<vec2> *uvs, PackedMesh &packed) {
+	int n = (int) points.size();
+	bool doNormals = normals && (int) normals->size() == n, doUvs = uvs && (int) uvs->size() == n;
+	packed.nVertices = n;
+	// points: uniform scale about the center of the bounds, so the decode is a similarity
+	vec3 min, max;
+	MinMax(points, min, max);
+	vec3 dif(max-min);
+	packed.center = .5f*(min+max);
+	packed.scale = .5f*(dif.x > dif.y? (dif.x > dif.z? dif.x : dif.z) : (dif.y > dif.z? dif.y : dif.z));
+	if (!(packed.scale > 0))
+		packed.scale = 1;
+	float s = 1/packed.scale, maxErr = 0;
+	double sumErr2 = 0;
+	packed.points.resize(3*n);
+	for (int i = 0; i < n; i++) {
+		vec3 q = s*(points[i]-packed.center);
+		short *p = &packed.points[3*i];
+		for (int k = 0; k < 3; k++)
+			p[k] = (short) Snorm(q[k], 32767);
+		vec3 d = packed.center+packed.scale*vec3((float) p[0]/32767, (float) p[1]/32767, (float) p[2]/32767);
+		float e = length(d-points[i]);
+		maxErr = e > maxErr? e : maxErr;
+		sumErr2 += e*e;
+	}
+	// normals
+	float maxAngle = 0;
+	packed.normals.resize(doNormals? n : 0);
+	for (int i = 0; doNormals && i < n; i++) {
+		vec3 &v = (*normals)[i];
+		packed.normals[i] = PackNormal(v);
+		vec3 u = UnpackNormal(packed.normals[i]);
+		float lu = length(u), lv = length(v);
+		if (lu > 0 && lv > 0) {
+			float c = dot(u, v)/(lu*lv), a = acos(c > 1? 1 : c < -1? -1 : c);
+			maxAngle = a > maxAngle? a : maxAngle;
+		}
+	}
+	// uvs
+	float maxUv = 0;
+	packed.uvs.resize(doUvs? 2*n : 0);
+	for (int i = 0; doUvs && i < n; i++) {
+		vec2 &t = (*uvs)[i];
+		for (int k = 0; k < 2; k++) {
+			unsigned short h = packed.uvs[2*i+k] = FloatToHalf(t[k]);
+			float e = fabs(HalfToFloat(h)-t[k]);
+			maxUv = e > maxUv? e : maxUv;
+		}
+	}
+	int floatSize = n*(sizeof(vec3)+(doNormals? sizeof(vec3) : 0)+(doUvs? sizeof(vec2) : 0));
+	int packSize = packed.Size();
+	printf("packed %i vertices: %i to %i bytes (%.2fx)\n", n, floatSize, packSize, packSize? (float) floatSize/packSize : 0.f);
+	printf("  point error max %g, rms %g (%g, %g of size)\n", maxErr, n? sqrt(sumErr2/n) : 0.,
+		maxErr/(2*packed.scale), n? sqrt(sumErr2/n)/(2*packed.scale) : 0.);
+	if (doNormals)
+		printf("  normal error max %.3f degrees\n", maxAngle*180/3.1415926f);
+	if (doUvs)
+		printf("  uv error max %g\n", maxUv);
+}
+
+// GPU Buffer
+
+GLuint InitPackedBuffer(PackedMesh &packed) {
+	GLuint id = 0;
+	int sizePts = packed.PointsSize(), sizeNrms = packed.NormalsSize(), sizeUvs = packed.UvsSize();
+	glGenBuffers(1, &id);
+	glBindBuffer(GL_ARRAY_BUFFER, id);
+	glBufferData(GL_ARRAY_BUFFER, packed.Size(), NULL, GL_STATIC_DRAW);
+	if (packed.points.size())
+		glBufferSubData(GL_ARRAY_BUFFER, 0, packed.points.size()*sizeof(short), &packed.points[0]);
+	if (sizeNrms)
+		glBufferSubData(GL_ARRAY_BUFFER, sizePts, sizeNrms, &packed.normals[0]);
+	if (sizeUvs)
+		glBufferSubData(GL_ARRAY_BUFFER, sizePts+sizeNrms, sizeUvs, &packed.uvs[0]);
+	return id;
+}
+
+void PackedAttributes(int shader, PackedMesh &packed) {
+	int sizePts = packed.PointsSize(), sizeNrms = packed.NormalsSize();
+	GLSL::VertexAttribPointer(shader, "point", 3, GL_SHORT, GL_TRUE, 0, (void *) 0);
+	if (sizeNrms)
+		GLSL::VertexAttribPointer(shader, "normal", 4, GL_INT_2_10_10_10_REV, GL_TRUE, 0, (void *) (size_t) sizePts);
+	if (packed.UvsSize())
+		GLSL::VertexAttribPointer(shader, "uv", 2, GL_HALF_FLOAT, GL_FALSE, 0, (void *) (size_t) (sizePts+sizeNrms));
+}
@@ -0,0 +1,53 @@
+/*	==============================
+    MeshPack.h - quantized vertex format for GPU upload
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef MESHPACK_HDR
+#define MESHPACK_HDR
+
+#include <vector>
+#include "glew.h"
+#include "mat.h"
+
+using std::vector;
+
+// Packed vertices: 14 bytes per vertex rather than 32 for float point, normal, uv
+
+struct PackedMesh {
+	int nVertices;
+	vector<short> points;					// 3 per vertex, SNORM16 about center, in units of scale
+	vector<unsigned int> normals;			// 1 per vertex, SNORM 10:10:10:2 (GL_INT_2_10_10_10_REV)
+	vector<unsigned short> uvs;				// 2 per vertex, half floats
+	vec3 center;
+	float scale;
+	PackedMesh() : nVertices(0), center(0, 0, 0), scale(1) { }
+	mat4 Decode() { return Translate(center)*Scale(scale, scale, scale); }
+		// map decoded points (in +/-1) to their original space; the scale is uniform, so the matrix
+		// can be folded into the view, and normals (renormalized in the shader) are unaffected
+	int PointsSize() { return (int) ((points.size()*sizeof(short)+3)&~3); }	// padded to 4 bytes
+	int NormalsSize() { return (int) (normals.size()*sizeof(unsigned int)); }
+	int UvsSize() { return (int) (uvs.size()*sizeof(unsigned short)); }
+	int Size() { return PointsSize()+NormalsSize()+UvsSize(); }
+};
+
+void PackMesh(vector<vec3> &points, vector<vec3> *normals, vector<vec2> *uvs, PackedMesh &packed);
+	// quantize points relative to their bounds, normals and uvs if one per point; print the
+	// size reduction and the maximum and rms position error, maximum normal angle and uv error
+
+// GPU Buffer
+
+GLuint InitPackedBuffer(PackedMesh &packed);
+	// create GPU buffer, make it active, fill with points|normals|uvs blocks; return buffer id
+
+void PackedAttributes(int shader, PackedMesh &packed);
+	// link the active packed buffer to vec3 "point", vec3 "normal", vec2 "uv" in shader;
+	// GL normalizes points and normals as they are fetched, so the shader needs no change
+	// other than applying packed.Decode() to points
+
+unsigned short FloatToHalf(float f);
+float HalfToFloat(unsigned short h);
+	// IEEE 754 binary16, rounded to nearest even; overflow becomes infinity
+
+#endif
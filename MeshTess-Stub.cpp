@@ -5,6 +5,7 @@
 #include "freeglut.h"
 #include "GLSL.h"
 #include "MeshIO.h"
+#include "Mipmap.h"
 #include "UI.h"
 
 // mesh
@@ -1,10 +1,16 @@
 // MeshTess.cpp: displacement mapped mesh
 
 #include <stdio.h>
+#include <chrono>
 #include <glew.h>
 #include <freeglut.h>
+#include "BVH.h"
 #include "GLSL.h"
 #include "MeshIO.h"
+#include "MeshLoader.h"
+#include "MeshOpt.h"
+#include "MeshPack.h"
+#include "Mipmap.h"
 #include "UI.h"
 
 // mesh
@@ -12,6 +18,13 @@ vector<int3> triangles;
 vector<vec3> points;
 vector<vec3> normals;
 vector<vec2> uvs;
+PackedMesh packed;												// quantized for the GPU
+vector<Meshlet> meshlets;										// clusters of triangles, for culling
+vector<int2> ranges;											// triangles of meshlets in view
+BVH bvh;														// for picking the surface
+RayHit surfaceHit;												// picked surface point, if triangle >= 0
+MeshLoader loader;												// reads the mesh in the background
+ProgressiveMesh preview;										// faces read so far, until the mesh is ready
 
 // colors
 vec3	 blk(0), wht(1), cyan(0,1,1);
@@ -43,8 +56,9 @@ char *vShaderCode = "\
 	out vec3 vPoint;															\n\
 	out vec3 vNormal;															\n\
 	out vec2 vUv;																\n\
+	uniform mat4 decode;							// packed point to model	\n\
 	void main()	{																\n\
-		vPoint = point; 														\n\
+		vPoint = (decode*vec4(point, 1)).xyz;									\n\
 		vNormal = normal;														\n\
 		vUv = uv;																\n\
 	}";
@@ -63,6 +77,7 @@ char *teShaderCode = "\
 	uniform float heightScale;													\n\
     uniform mat4 modelview;														\n\
 	uniform mat4 persp;															\n\
+	uniform mat3 normalMatrix;													\n\
 	void main() {																\n\
 		// send uv, point, normal to pixel shader								\n\
 		vec2 t;																	\n\
@@ -77,7 +92,7 @@ char *teShaderCode = "\
 		p += height*normalize(n);												\n\
 		tePoint = (modelview*vec4(p, 1)).xyz;									\n\
 		gl_Position = persp*vec4(tePoint, 1);									\n\
-		teNormal = (modelview*vec4(n, 0)).xyz;									\n\
+		teNormal = normalMatrix*n;												\n\
 	}";
 
 // pixel shader
@@ -120,59 +135,98 @@ void Display() {
 	persp = Perspective(fov, aspect, nearPlane, farPlane);
 	fullview = persp*modelview;
 	screen = ScreenMode();
-	// use tessellation shader
-	glUseProgram(shaderId);
-	// set uniforms for height map and texture map
-	GLSL::SetUniform(shaderId, "heightScale", scl.GetValue());
-	GLSL::SetUniform(shaderId, "heightField", (int) textureId);
-	// update matrices
-	GLSL::SetUniform(shaderId, "modelview", modelview);
-	GLSL::SetUniform(shaderId, "persp", persp);
-	// transform light and send to fragment shader
-	vec4 hLight = modelview*vec4(lightSource, 1);
-	vec3 xlight(hLight.x, hLight.y, hLight.z);
-	glUniform3fv(glGetUniformLocation(shaderId, "light"), 1, (float *) &xlight);
-    // activate vertex buffer and establish shader links
-    glBindBuffer(GL_ARRAY_BUFFER, vBufferId);
-	int sizePts = points.size()*sizeof(vec3);
-	GLSL::VertexAttribPointer(shaderId, "point",  3,  GL_FLOAT, GL_FALSE, 0, (void *) 0);
-	GLSL::VertexAttribPointer(shaderId, "normal", 3,  GL_FLOAT, GL_FALSE, 0, (void *) sizePts);
-	GLSL::VertexAttribPointer(shaderId, "uv",     2,  GL_FLOAT, GL_FALSE, 0, (void *) (2*sizePts));
-	// establish tessellating patch and display
-	float r = 100, outerLevels[] = {r, r, r, r}, innerLevels[] = {r, r};
-	glPatchParameterfv(GL_PATCH_DEFAULT_OUTER_LEVEL, outerLevels);
-	glPatchParameterfv(GL_PATCH_DEFAULT_INNER_LEVEL, innerLevels);
-	glPatchParameteri(GL_PATCH_VERTICES, 3);
-	glDrawElements(GL_PATCHES, 3*triangles.size(), GL_UNSIGNED_INT, &triangles[0]);
+	if (!vBufferId) {
+		// still loading: silhouette of the faces read so far, in view
+		mat4 m = fullview*preview.Fit(.8f);
+		UseDrawShader(m);
+		preview.Draw(GLSL::CurrentShader(), false, &m);
+	}
+	else {
+		// use tessellation shader
+		glUseProgram(shaderId);
+		// set uniforms for height map and texture map
+		GLSL::SetUniform(shaderId, "heightScale", scl.GetValue());
+		GLSL::SetUniform(shaderId, "heightField", (int) textureId);
+		// update matrices
+		GLSL::SetUniform(shaderId, "modelview", modelview);
+		GLSL::SetUniform(shaderId, "normalMatrix", NormalMatrix(modelview));
+		GLSL::SetUniform(shaderId, "persp", persp);
+		GLSL::SetUniform(shaderId, "decode", packed.Decode());
+		// transform light and send to fragment shader
+		vec4 hLight = modelview*vec4(lightSource, 1);
+		vec3 xlight(hLight.x, hLight.y, hLight.z);
+		glUniform3fv(glGetUniformLocation(shaderId, "light"), 1, (float *) &xlight);
+	    // activate vertex buffer and establish shader links
+	    glBindBuffer(GL_ARRAY_BUFFER, vBufferId);
+		PackedAttributes(shaderId, packed);
+		// establish tessellating patch and display
+		float r = 100, outerLevels[] = {r, r, r, r}, innerLevels[] = {r, r};
+		glPatchParameterfv(GL_PATCH_DEFAULT_OUTER_LEVEL, outerLevels);
+		glPatchParameterfv(GL_PATCH_DEFAULT_INNER_LEVEL, innerLevels);
+		glPatchParameteri(GL_PATCH_VERTICES, 3);
+		// display meshlets in view; displacement moves points as much as the height scale
+		CullMeshlets(meshlets, fullview, NULL, ranges, fabs(scl.GetValue()));
+		for (size_t i = 0; i < ranges.size(); i++)
+			glDrawElements(GL_PATCHES, 3*ranges[i].i2, GL_UNSIGNED_INT, &triangles[ranges[i].i1]);
+	}
 	// draw sliders, light in 2D screen space
 	UseDrawShader(screen);
 	if (IsVisible(lightSource, fullview))
 		Sun(ScreenPoint(lightSource, fullview), hover == &lightSource? &cyan : NULL);
 	glDisable(GL_DEPTH_TEST);
+	if (surfaceHit.triangle >= 0) {
+		// picked point is on the undisplaced surface
+		UseDrawShader(fullview);
+		Disk(surfaceHit.point, 8, cyan);
+		UseDrawShader(screen);
+	}
 	scl.Draw();
     glFlush();
 }
 
 // Input
 
-void ReadObject(char *filename) {
-	// read Alias/Wavefront "obj" formatted mesh file
-	if (!ReadAsciiObj(filename, points, triangles, &normals, &uvs)) {
-		printf("Failed to read %s\n", filename);
-		return;
+void Idle() {
+	// upload faces read so far; once the whole mesh is ready, upload it in place of the preview
+	int nBefore = preview.nTriangles;
+	MeshChunk *whole = preview.Upload(loader);
+	if (whole) {
+		delete whole;									// its contents were moved by ReadObject
+		preview.Clear();
+		vBufferId = InitPackedBuffer(packed);
 	}
-	// scale/move model to uniform +/-1
-	int npoints = points.size();
-	int sizepts = npoints*sizeof(vec3), sizenrms = sizepts, sizeuvs = npoints*sizeof(vec2);
-	printf("%i triangles\n", npoints/3);
-	Normalize(points, .8f);
-    // create GPU buffer, make it active, fill
-    glGenBuffers(1, &vBufferId);
-    glBindBuffer(GL_ARRAY_BUFFER, vBufferId);
-	glBufferData(GL_ARRAY_BUFFER, sizepts+sizenrms+sizeuvs, 0, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizepts, &points[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, sizepts, sizenrms, &normals[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, sizepts+sizenrms, sizeuvs, &uvs[0]);
+	if (!loader.Loading()) {
+		if (loader.Failed())
+			printf("Failed to read mesh\n");
+		glutIdleFunc(NULL);
+	}
+	if (whole || preview.nTriangles != nBefore)
+		glutPostRedisplay();
+	else
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+void ReadObject(char *filename) {
+	// read Alias/Wavefront "obj" formatted mesh file (or its binary cache), or scanned PLY, on the
+	// loader thread, which also prepares the mesh; the display thread leaves the mesh alone until
+	// Idle takes the complete chunk and sets vBufferId
+	loader.Start(filename, [](MeshChunk &mesh) {
+		points.swap(mesh.points);
+		triangles.swap(mesh.triangles);
+		normals.swap(mesh.normals);
+		uvs.swap(mesh.uvs);
+		// scale/move model to uniform +/-1
+		printf("%i triangles\n", triangles.size());
+		Normalize(points, .8f);
+		// meshlets first, then the vertex cache order within each, then points in order of use
+		BuildMeshlets(points, triangles, meshlets);
+		OptimizeMeshlets(triangles, meshlets, (int) points.size());
+		OptimizeVertexFetch(points, triangles, &normals, &uvs);
+		bvh.Build(points, triangles, 0);
+		// quantize points, normals, uvs for the GPU buffer
+		PackMesh(points, &normals, &uvs, packed);
+	});
+	glutIdleFunc(Idle);
 }
 
 // Interactive Rotation
@@ -201,6 +255,12 @@ void MouseButton(int butn, int state, int x, int y) {
 		}
 		else if (scl.Hit(x, y))
 			picked = &scl;
+		else if (glutGetModifiers() & GLUT_ACTIVE_SHIFT) {
+			// shift-click: pick the surface, once loaded
+			if (vBufferId && PickTriangle(bvh, x, y, modelview, persp, surfaceHit))
+				printf("picked triangle %i at (%.3f, %.3f, %.3f)\n", surfaceHit.triangle,
+					surfaceHit.point.x, surfaceHit.point.y, surfaceHit.point.z);
+		}
 		else {
 			picked = &rotOld;
 			mouseDown = vec2((float) x, (float) y);
@@ -230,7 +290,9 @@ void MouseWheel(int wheel, int direction, int x, int y) {
 // Application
 
 void Close() {
-	// unbind vertex buffer, free GPU memory
+	// stop loading, unbind vertex buffer, free GPU memory
+	loader.Stop();
+	preview.Clear();
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glDeleteBuffers(1, &vBufferId);
 	glDeleteBuffers(1, &textureId);
@@ -0,0 +1,261 @@
+/* ======================================
+   Mipmap.cpp - box filtered mipmaps and their cache
+   Copyright (c) Jules Bloomenthal, Seattle, 2012
+   All rights reserved
+   ====================================== */
+
+#include "Mipmap.h"
+#include "MeshIO.h"
+#include "Parallel.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAP_SSE
+#include <emmintrin.h>
+#endif
+
+// Box filter
+
+static void SumRows(const unsigned char *r0, const unsigned char *r1, unsigned short *sum, int n) {
+	// sum[i] = r0[i]+r1[i]
+	int i = 0;
+#ifdef MIPMAP_SSE
+	__m128i zero = _mm_setzero_si128();
+	for (; i+16 <= n; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (r0+i)), b = _mm_loadu_si128((const __m128i *) (r1+i));
+		_mm_storeu_si128((__m128i *) (sum+i), _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+		_mm_storeu_si128((__m128i *) (sum+i+8), _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+	}
+#endif
+	for (; i < n; i++)
+		sum[i] = r0[i]+r1[i];
+}
+
+static void SumColumns(const unsigned short *sum, unsigned char *d, int nPixels, int channels) {
+	// d = (sum of horizontally adjacent pixels in sum +2)/4, rounded the same by every path
+	int x = 0;
+#ifdef MIPMAP_SSE
+	__m128i two = _mm_set1_epi16(2);
+	if (channels == 1) {
+		// pairs of adjacent 16 bit sums, via multiply-add by one
+		__m128i one = _mm_set1_epi16(1);
+		for (; x+8 <= nPixels; x += 8) {
+			__m128i p0 = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (sum+2*x)), one);
+			__m128i p1 = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (sum+2*x+8)), one);
+			__m128i s = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(p0, p1), two), 2);
+			_mm_storel_epi64((__m128i *) (d+x), _mm_packus_epi16(s, s));
+		}
+	}
+	if (channels == 3) {
+		// four pixels are 24 sums in three registers; adding to each sum the sum three on leaves the
+		// pixels in lanes 0-2 and 6-7 of t0, 0 and 4-6 of t1, 2-4 of t2, which shift and mask gather
+		__m128i m012 = _mm_setr_epi16(-1, -1, -1, 0, 0, 0, 0, 0), m34 = _mm_setr_epi16(0, 0, 0, -1, -1, 0, 0, 0);
+		__m128i m5 = _mm_setr_epi16(0, 0, 0, 0, 0, -1, 0, 0), m67 = _mm_setr_epi16(0, 0, 0, 0, 0, 0, -1, -1);
+		__m128i m0 = _mm_setr_epi16(-1, 0, 0, 0, 0, 0, 0, 0), m123 = _mm_setr_epi16(0, -1, -1, -1, 0, 0, 0, 0);
+		for (; x+4 <= nPixels; x += 4) {
+			const unsigned short *s = sum+6*x;
+			__m128i v2 = _mm_loadu_si128((const __m128i *) (s+16));
+			__m128i t0 = _mm_add_epi16(_mm_loadu_si128((const __m128i *) s), _mm_loadu_si128((const __m128i *) (s+3)));
+			__m128i t1 = _mm_add_epi16(_mm_loadu_si128((const __m128i *) (s+8)), _mm_loadu_si128((const __m128i *) (s+11)));
+			__m128i t2 = _mm_add_epi16(v2, _mm_srli_si128(v2, 6));
+			__m128i lo = _mm_or_si128(_mm_or_si128(_mm_and_si128(t0, m012), _mm_and_si128(_mm_srli_si128(t0, 6), m34)),
+									  _mm_or_si128(_mm_and_si128(_mm_slli_si128(t1, 10), m5), _mm_and_si128(_mm_slli_si128(t1, 4), m67)));
+			__m128i hi = _mm_or_si128(_mm_and_si128(_mm_srli_si128(t1, 12), m0), _mm_and_si128(_mm_srli_si128(t2, 2), m123));
+			lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+			hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+			// 12 bytes: 8, then 4
+			__m128i b = _mm_packus_epi16(lo, hi);
+			int last = _mm_cvtsi128_si32(_mm_srli_si128(b, 8));
+			_mm_storel_epi64((__m128i *) (d+3*x), b);
+			memcpy(d+3*x+8, &last, 4);
+		}
+	}
+	if (channels == 4) {
+		// a pair of pixels is the low and high halves of a register
+		for (; x+4 <= nPixels; x += 4) {
+			const __m128i *s = (const __m128i *) (sum+8*x);
+			__m128i v0 = _mm_loadu_si128(s), v1 = _mm_loadu_si128(s+1), v2 = _mm_loadu_si128(s+2), v3 = _mm_loadu_si128(s+3);
+			__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi64(v0, v1), _mm_unpackhi_epi64(v0, v1));
+			__m128i s1 = _mm_add_epi16(_mm_unpacklo_epi64(v2, v3), _mm_unpackhi_epi64(v2, v3));
+			s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+			s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+			_mm_storeu_si128((__m128i *) (d+4*x), _mm_packus_epi16(s0, s1));
+		}
+	}
+#endif
+	for (; x < nPixels; x++)
+		for (int k = 0; k < channels; k++)
+			d[channels*x+k] = (unsigned char) ((sum[2*channels*x+k]+sum[2*channels*x+channels+k]+2)>>2);
+}
+
+static void Downsample(MipLevel &src, MipLevel &dst, int channels, int nThreads) {
+	int sw = src.width, sh = src.height, dw = sw > 1? sw/2 : 1, dh = sh > 1? sh/2 : 1, c = channels;
+	dst.width = dw;
+	dst.height = dh;
+	dst.pixels.resize((size_t) dw*dh*c);
+	ParallelFor(dh, [&](int begin, int end) {
+		vector<unsigned short> sum(2*dw*c);
+		for (int y = begin; y < end; y++) {
+			// an odd last row or column is dropped; a single row or column is averaged with itself
+			const unsigned char *r0 = &src.pixels[(size_t) 2*y*sw*c], *r1 = sh > 1? r0+(size_t) sw*c : r0;
+			unsigned char *d = &dst.pixels[(size_t) y*dw*c];
+			if (sw == 1)
+				for (int k = 0; k < c; k++)
+					d[k] = (unsigned char) ((r0[k]+r1[k]+1)>>1);
+			else {
+				SumRows(r0, r1, &sum[0], 2*dw*c);
+				SumColumns(&sum[0], d, dw, c);
+			}
+		}
+	}, 16, nThreads);
+}
+
+void BuildMipmaps(vector<MipLevel> &levels, int channels, int nThreads) {
+	if (levels.empty())
+		return;
+	levels.resize(1);
+	while (levels.back().width > 1 || levels.back().height > 1) {
+		levels.push_back(MipLevel());
+		Downsample(levels[levels.size()-2], levels.back(), channels, nThreads);
+	}
+}
+
+// Cache
+
+static const char MipmapMagic[8] = {'M', 'I', 'P', 'M', 'A', 'P', 0, 0};
+static const unsigned MipmapVersion = 1;
+
+struct MipmapHeader {
+	char			magic[8];					// MipmapMagic, written last
+	unsigned		version, headerSize;
+	int				width, height, channels, nLevels;
+	long long		sourceSize, sourceTime;		// cache key: size, mtime of source file
+	unsigned		sourcePathHash, reserved;	// and hash of its name
+};
+
+bool WriteMipmaps(const char *filename, vector<MipLevel> &levels, int channels, const char *sourceFilename) {
+	FILE *out = fopen(filename, "wb");
+	if (!out || levels.empty()) {
+		if (out)
+			fclose(out);
+		return false;
+	}
+	MipmapHeader h;
+	memset(&h, 0, sizeof(h));					// magic stays zero until all data written
+	h.version = MipmapVersion;
+	h.headerSize = sizeof(h);
+	h.width = levels[0].width;
+	h.height = levels[0].height;
+	h.channels = channels;
+	h.nLevels = (int) levels.size();
+	if (sourceFilename) {
+		SourceKey(sourceFilename, h.sourceSize, h.sourceTime);
+		h.sourcePathHash = PathHash(sourceFilename);
+	}
+	bool ok = fwrite(&h, sizeof(h), 1, out) == 1;
+	for (size_t i = 0; i < levels.size() && ok; i++)
+		ok = levels[i].pixels.empty() || fwrite(&levels[i].pixels[0], levels[i].pixels.size(), 1, out) == 1;
+	// now mark the file complete
+	memcpy(h.magic, MipmapMagic, 8);
+	ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, out) == 1;
+	ok = fclose(out) == 0 && ok;
+	if (!ok)
+		remove(filename);
+	return ok;
+}
+
+bool ReadMipmaps(const char *filename, vector<MipLevel> &levels, int &channels, const char *sourceFilename) {
+	FILE *in = fopen(filename, "rb");
+	if (!in)
+		return false;
+	MipmapHeader h;
+	bool ok = fread(&h, sizeof(h), 1, in) == 1 && !memcmp(h.magic, MipmapMagic, 8) &&
+			  h.version == MipmapVersion && h.headerSize == sizeof(h) && h.width > 0 && h.height > 0 &&
+			  (h.channels == 1 || h.channels == 3 || h.channels == 4);
+	if (ok && sourceFilename) {
+		long long size, time;
+		ok = SourceKey(sourceFilename, size, time) && h.sourceSize == size && h.sourceTime == time &&
+			 h.sourcePathHash == PathHash(sourceFilename);
+	}
+	levels.resize(0);
+	for (int w = h.width, ht = h.height; ok; w = w > 1? w/2 : 1, ht = ht > 1? ht/2 : 1) {
+		// level sizes follow from the first
+		levels.push_back(MipLevel());
+		MipLevel &l = levels.back();
+		l.width = w;
+		l.height = ht;
+		l.pixels.resize((size_t) w*ht*h.channels);
+		ok = fread(&l.pixels[0], l.pixels.size(), 1, in) == 1;
+		if (w == 1 && ht == 1)
+			break;
+	}
+	fclose(in);
+	ok = ok && (int) levels.size() == h.nLevels;
+	if (!ok)
+		levels.resize(0);
+	channels = h.channels;
+	return ok;
+}
+
+bool ReadMipmapsCached(const char *filename, vector<MipLevel> &levels, int &channels, bool luminance, int nThreads) {
+	std::string cacheName = std::string(filename)+(luminance? ".lum.mip" : ".mip");
+	clock_t start = clock();
+	if (ReadMipmaps(cacheName.c_str(), levels, channels, filename)) {
+		float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+		printf("read %i mipmap levels from %s in %.2f secs\n", (int) levels.size(), cacheName.c_str(), dt);
+		return true;
+	}
+	int width, height, bitsPerPixel = 8;
+	char *pixels = luminance? ReadLuminance(filename, width, height) : ReadTexture(filename, width, height, bitsPerPixel);
+	if (!pixels)
+		return false;
+	channels = bitsPerPixel/8;
+	levels.resize(1);
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].pixels.assign((unsigned char *) pixels, (unsigned char *) pixels+(size_t) width*height*channels);
+	delete [] pixels;
+	start = clock();
+	BuildMipmaps(levels, channels, nThreads);
+	float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+	printf("built %i mipmap levels for %ix%i in %.2f secs\n", (int) levels.size(), width, height, dt);
+	if (!WriteMipmaps(cacheName.c_str(), levels, channels, filename))
+		printf("can't write %s\n", cacheName.c_str());
+	return true;
+}
+
+// GPU Texture
+
+GLuint UploadMipmaps(vector<MipLevel> &levels, int channels) {
+	GLuint textureId = 0;
+	if (levels.empty())
+		return 0;
+	GLenum format = channels == 1? GL_RED : channels == 3? GL_BGR : GL_BGRA;
+	GLint internalFormat = channels == 1? GL_RED : channels == 3? GL_RGB : GL_RGBA;
+	glGenTextures(1, &textureId);
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);		// in case width not multiple of 4
+	for (size_t i = 0; i < levels.size(); i++) {
+		MipLevel &l = levels[i];
+		glTexImage2D(GL_TEXTURE_2D, (GLint) i, internalFormat, l.width, l.height, 0, format, GL_UNSIGNED_BYTE, &l.pixels[0]);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) levels.size()-1);
+	return textureId;
+}
+
+GLuint SetHeightfield(const char *filename, int whichTexture) {
+	// luminance and its mipmaps, from the cache if current
+	vector<MipLevel> levels;
+	int channels;
+	if (!ReadMipmapsCached(filename, levels, channels, true, 0)) {
+		printf("No texture!\n");
+		return 0;
+	}
+	// set and bind active texture corresponding with textureIds[1]
+	glActiveTexture(whichTexture == 1? GL_TEXTURE2 : GL_TEXTURE1);
+	// allocate GPU texture buffer; copy each level
+	return UploadMipmaps(levels, channels);
+}
@@ -0,0 +1,43 @@
+/*	==============================
+    Mipmap.h - texture mipmaps built on the CPU, with a file cache
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef MIPMAP_HDR
+#define MIPMAP_HDR
+
+#include <vector>
+#include "glew.h"
+
+using std::vector;
+
+struct MipLevel {
+	int width, height;
+	vector<unsigned char> pixels;				// width*height pixels of 1, 3 or 4 bytes, bottom row first
+};
+
+void BuildMipmaps(vector<MipLevel> &levels, int channels, int nThreads = 1);
+	// replace levels after levels[0] with successive 2x2 box filterings, down to 1x1 (each size is
+	// half the last, rounded down, as GL expects); channels is 1 (grey), 3 (BGR) or 4 (BGRA);
+	// nThreads as for ReadAsciiObj, the result doesn't depend on it
+
+bool WriteMipmaps(const char *filename, vector<MipLevel> &levels, int channels, const char *sourceFilename = NULL);
+	// write mipmap cache; if non-null, sourceFilename's size, modification time and name are the key
+
+bool ReadMipmaps(const char *filename, vector<MipLevel> &levels, int &channels, const char *sourceFilename = NULL);
+	// return true if filename is a complete mipmap cache of the current version and, if sourceFilename
+	// is non-null, was written from the present sourceFilename
+
+bool ReadMipmapsCached(const char *filename, vector<MipLevel> &levels, int &channels, bool luminance = false, int nThreads = 1);
+	// read targa file (converted to luminance, if requested) and its mipmaps from <filename>.mip
+	// (or .lum.mip) if written from the present file; otherwise read filename, build mipmaps and
+	// (re)write the cache beside it
+
+GLuint UploadMipmaps(vector<MipLevel> &levels, int channels);
+	// create a texture, bind it to the active texture unit, copy every level; return texture id
+
+GLuint SetHeightfield(const char *filename, int whichTexture = 0);
+	// read targa file as luminance with its mipmaps (see ReadMipmapsCached); store as GL_TEXTURE1 (or 2)
+
+#endif
@@ -0,0 +1,49 @@
+/*	==============================
+    Parallel.h - spread a loop over threads
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef PARALLEL_HDR
+#define PARALLEL_HDR
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+inline int NumThreads(int nThreads = 0) {
+	// nThreads if positive, else one per hardware thread
+	if (nThreads > 0)
+		return nThreads;
+	int n = (int) std::thread::hardware_concurrency();
+	return n > 0? n : 1;
+}
+
+template<class F>
+void ParallelFor(int n, F f, int grain = 1, int nThreads = 0) {
+	// call f(begin, end) for blocks of up to grain indices covering [0, n);
+	// threads take the next block as they finish, the caller is one of the threads
+	if (grain < 1)
+		grain = 1;
+	int nBlocks = (n+grain-1)/grain, nWorkers = NumThreads(nThreads);
+	if (nWorkers > nBlocks)
+		nWorkers = nBlocks;
+	if (nWorkers <= 1) {
+		for (int i = 0; i < n; i += grain)
+			f(i, i+grain < n? i+grain : n);
+		return;
+	}
+	std::atomic<int> next(0);
+	auto work = [&]() {
+		for (int i; (i = next.fetch_add(grain)) < n; )
+			f(i, i+grain < n? i+grain : n);
+	};
+	std::vector<std::thread> threads;
+	for (int t = 1; t < nWorkers; t++)
+		threads.push_back(std::thread(work));
+	work();
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+}
+
+#endif
@@ -0,0 +1,244 @@
+/* ======================================
+   Simplify.cpp - quadric error edge collapse
+   Copyright (c) Jules Bloomenthal, Seattle, 2012
+   All rights reserved
+   ====================================== */
+
+#include "Simplify.h"
+#include <algorithm>
+#include <queue>
+#include <stdio.h>
+#include <time.h>
+
+// Quadrics
+
+struct Quadric {
+	// sum of squared distances to planes ax+by+cz+d = 0, as the symmetric 4x4 matrix's upper triangle
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+	Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) { }
+	Quadric(vec3 n, float d, double w) : a2(w*n.x*n.x), ab(w*n.x*n.y), ac(w*n.x*n.z), ad(w*n.x*d),
+		b2(w*n.y*n.y), bc(w*n.y*n.z), bd(w*n.y*d), c2(w*n.z*n.z), cd(w*n.z*d), d2(w*d*d) { }
+	void operator+=(const Quadric &q) {
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+		bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+	}
+	double Error(const vec3 &p) const {
+		double x = p.x, y = p.y, z = p.z;
+		return a2*x*x+2*ab*x*y+2*ac*x*z+2*ad*x+b2*y*y+2*bc*y*z+2*bd*y+c2*z*z+2*cd*z+d2;
+	}
+};
+
+// Edge collapse
+
+struct Collapse {
+	float error;
+	int from, to, fromVersion, toVersion;		// stale if either vertex has changed since
+	bool operator<(const Collapse &c) const { return error > c.error; }	// least error on top
+};
+
+class Simplifier {
+public:
+	vector<vec3> &points;
+	vector<int3> &triangles;
+	int nPoints, nTriangles, nAlive;
+	vector<Quadric> quadrics;
+	vector<vector<int> > vTriangles;			// triangles about each vertex (some may have died)
+	vector<int> versions, marks;				// marks of a pass are its own (unique) stamp
+	int nStamps;
+	vector<bool> locked, removed, dead;
+	std::priority_queue<Collapse> heap;
+	Simplifier(vector<vec3> &points, vector<int3> &triangles) : points(points), triangles(triangles) {
+		nPoints = (int) points.size();
+		nAlive = nTriangles = (int) triangles.size();
+		quadrics.resize(nPoints);
+		vTriangles.resize(nPoints);
+		versions.assign(nPoints, 0);
+		marks.assign(nPoints, 0);
+		nStamps = 0;
+		locked.assign(nPoints, false);
+		removed.assign(nPoints, false);
+		dead.assign(nTriangles, false);
+		// plane quadrics, weighted by area, summed at vertices
+		for (int t = 0; t < nTriangles; t++) {
+			int *vids = &triangles[t].i1;
+			vec3 &p1 = points[vids[0]], n = cross(points[vids[1]]-p1, points[vids[2]]-p1);
+			float len = length(n);
+			if (len > 0) {
+				n /= len;
+				Quadric q(n, -dot(n, p1), .5*len);
+				for (int k = 0; k < 3; k++)
+					quadrics[vids[k]] += q;
+			}
+			for (int k = 0; k < 3; k++)
+				vTriangles[vids[k]].push_back(t);
+		}
+		// lock vertices of edges not shared by exactly two triangles: mesh borders, and seams
+		// where ReadAsciiObj split a position into vertices with different uvs or normals
+		vector<int2> edges;
+		edges.reserve(3*nTriangles);
+		for (int t = 0; t < nTriangles; t++) {
+			int *vids = &triangles[t].i1;
+			for (int k = 0; k < 3; k++) {
+				int a = vids[k], b = vids[(k+1)%3];
+				edges.push_back(a < b? int2(a, b) : int2(b, a));
+			}
+		}
+		std::sort(edges.begin(), edges.end(), [](const int2 &e1, const int2 &e2) {
+			return e1.i1 < e2.i1 || (e1.i1 == e2.i1 && e1.i2 < e2.i2);
+		});
+		vector<int2> interior;
+		for (size_t i = 0, j; i < edges.size(); i = j) {
+			for (j = i+1; j < edges.size() && edges[j].i1 == edges[i].i1 && edges[j].i2 == edges[i].i2; j++)
+				;
+			if (j-i != 2)
+				locked[edges[i].i1] = locked[edges[i].i2] = true;
+			else
+				interior.push_back(edges[i]);
+		}
+		// queue once all locks are known
+		for (size_t i = 0; i < interior.size(); i++)
+			Push(interior[i].i1, interior[i].i2);
+	}
+	float Cost(int from, int to) {
+		Quadric q = quadrics[from];
+		q += quadrics[to];
+		return (float) q.Error(points[to]);
+	}
+	void Push(int a, int b) {
+		// queue the cheaper direction of edge ab, if either is allowed
+		float ab = locked[a]? FLT_MAX : Cost(a, b), ba = locked[b]? FLT_MAX : Cost(b, a);
+		if (ab == FLT_MAX && ba == FLT_MAX)
+			return;
+		Collapse c;
+		c.from = ab <= ba? a : b;
+		c.to = ab <= ba? b : a;
+		c.error = ab <= ba? ab : ba;
+		c.fromVersion = versions[c.from];
+		c.toVersion = versions[c.to];
+		heap.push(c);
+	}
+	bool Valid(int from, int to) {
+		// the neighbors common to from and to must be just the third vertices of their two shared
+		// triangles (else the collapse pinches the surface), and no triangle of from may flip
+		int nShared = 0, nCommon = 0, stamp = ++nStamps, counted = ++nStamps;
+		for (size_t i = 0; i < vTriangles[from].size(); i++) {
+			int t = vTriangles[from][i];
+			if (dead[t])
+				continue;
+			int *vids = &triangles[t].i1;
+			for (int k = 0; k < 3; k++)
+				marks[vids[k]] = stamp;
+			if (vids[0] == to || vids[1] == to || vids[2] == to) {
+				nShared++;
+				continue;
+			}
+			// moving from to to must not turn the triangle over
+			int k = vids[0] == from? 0 : vids[1] == from? 1 : 2;
+			vec3 &a = points[vids[(k+1)%3]], &b = points[vids[(k+2)%3]];
+			vec3 n0 = cross(a-points[from], b-points[from]), n1 = cross(a-points[to], b-points[to]);
+			if (dot(n0, n1) <= .25f*length(n0)*length(n1))	// turned more than 75 degrees, or degenerate
+				return false;
+		}
+		for (size_t i = 0; i < vTriangles[to].size(); i++) {
+			int t = vTriangles[to][i];
+			if (dead[t])
+				continue;
+			int *vids = &triangles[t].i1;
+			for (int k = 0; k < 3; k++)
+				if (vids[k] != to && vids[k] != from && marks[vids[k]] == stamp) {
+					marks[vids[k]] = counted;		// count each common neighbor once
+					nCommon++;
+				}
+		}
+		return nShared == 2 && nCommon == 2;
+	}
+	void Apply(int from, int to) {
+		// retarget from's triangles to to, kill those that shared the edge, requeue to's edges
+		vector<int> &tTo = vTriangles[to];
+		for (size_t i = 0; i < vTriangles[from].size(); i++) {
+			int t = vTriangles[from][i];
+			if (dead[t])
+				continue;
+			int *vids = &triangles[t].i1;
+			if (vids[0] == to || vids[1] == to || vids[2] == to) {
+				dead[t] = true;
+				nAlive--;
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+				if (vids[k] == from)
+					vids[k] = to;
+			tTo.push_back(t);
+		}
+		vector<int>().swap(vTriangles[from]);
+		removed[from] = true;
+		quadrics[to] += quadrics[from];
+		versions[to]++;
+		// drop dead triangles from to's list, then queue each neighbor once
+		size_t n = 0;
+		for (size_t i = 0; i < tTo.size(); i++)
+			if (!dead[tTo[i]])
+				tTo[n++] = tTo[i];
+		tTo.resize(n);
+		int stamp = ++nStamps;
+		for (size_t i = 0; i < tTo.size(); i++) {
+			int *vids = &triangles[tTo[i]].i1;
+			for (int k = 0; k < 3; k++)
+				if (vids[k] != to && marks[vids[k]] != stamp) {
+					marks[vids[k]] = stamp;
+					Push(to, vids[k]);			// any queued before are stale, as to's version changed
+				}
+		}
+	}
+	float Run(int targetTriangles, float maxError, int &nCollapses) {
+		float error = 0;
+		nCollapses = 0;
+		while (nAlive > targetTriangles && !heap.empty()) {
+			Collapse c = heap.top();
+			heap.pop();
+			if (removed[c.from] || removed[c.to] || c.fromVersion != versions[c.from] || c.toVersion != versions[c.to])
+				continue;
+			if (c.error > maxError)
+				break;
+			if (!Valid(c.from, c.to))
+				continue;
+			Apply(c.from, c.to);
+			error = c.error > error? c.error : error;
+			nCollapses++;
+		}
+		// keep live triangles, in their original order
+		int n = 0;
+		for (int t = 0; t < nTriangles; t++)
+			if (!dead[t])
+				triangles[n++] = triangles[t];
+		triangles.resize(n);
+		return error;
+	}
+};
+
+float SimplifyMesh(vector<vec3> &points, vector<int3> &triangles, int targetTriangles, float maxError) {
+	clock_t start = clock();
+	int nIn = (int) triangles.size(), nCollapses;
+	Simplifier s(points, triangles);
+	float error = s.Run(targetTriangles, maxError, nCollapses);
+	float dt = (float) (clock()-start)/CLOCKS_PER_SEC;
+	printf("simplified %i to %i triangles: %i collapses in %.2f secs (%.0f/sec)\n",
+		nIn, (int) triangles.size(), nCollapses, dt, dt > 0? nCollapses/dt : 0.f);
+	return error;
+}
+
+void SimplifyLODs(vector<vec3> &points, vector<int3> &triangles, vector<float> &ratios,
+				  vector<vector<int3> > &lods, vector<float> *errors) {
+	lods.resize(ratios.size());
+	if (errors)
+		errors->resize(ratios.size());
+	vector<int3> level(triangles);
+	float error = 0;
+	for (size_t i = 0; i < ratios.size(); i++) {
+		float e = SimplifyMesh(points, level, (int) (ratios[i]*triangles.size()));
+		error = e > error? e : error;
+		lods[i] = level;
+		if (errors)
+			(*errors)[i] = error;
+	}
+}
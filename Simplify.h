@@ -0,0 +1,29 @@
+/*	==============================
+    Simplify.h - quadric error mesh simplification and levels of detail
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef SIMPLIFY_HDR
+#define SIMPLIFY_HDR
+
+#include <float.h>
+#include <vector>
+#include "mat.h"
+
+using std::vector;
+
+float SimplifyMesh(vector<vec3> &points, vector<int3> &triangles, int targetTriangles, float maxError = FLT_MAX);
+	// collapse edges, least quadric error first, until there are no more than targetTriangles or the
+	// next collapse would exceed maxError (Garland and Heckbert, "Surface Simplification Using Quadric
+	// Error Metrics", 1997); a vertex collapses onto a neighbor, so points (and any normals or uvs
+	// indexed with them) are unchanged and remain valid for the new triangles; vertices on open edges,
+	// including the splits ReadAsciiObj makes at uv and normal seams, are never moved;
+	// return the largest error of a collapse (area-weighted sum of squared distances to planes)
+
+void SimplifyLODs(vector<vec3> &points, vector<int3> &triangles, vector<float> &ratios,
+				  vector<vector<int3> > &lods, vector<float> *errors = NULL);
+	// set lods[i] to triangles simplified to ratios[i] of their number (ratios decreasing);
+	// each level is made from the one before, and all index the same points
+
+#endif
@@ -0,0 +1,136 @@
+// Test-Cull.cpp: Cull of spheres and boxes against a plane-by-plane test of each, on random bounds,
+// including bounds that straddle a plane and counts that aren't a multiple of four
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Cull.h"
+
+float Random(float min, float max) { return min+(max-min)*rand()/RAND_MAX; }
+
+// Scalar reference
+
+double PlaneDistance(vec4 &p, double x, double y, double z) { return p.x*x+p.y*y+p.z*z+p.w; }
+
+double PlaneScale(vec4 &p, double x, double y, double z) { return fabs(p.x*x)+fabs(p.y*y)+fabs(p.z*z)+fabs(p.w); }
+	// size of the terms of PlaneDistance, to which float rounding is proportional
+
+bool SphereVisible(ViewFrustum &f, vec3 c, float r, bool &close) {
+	// in double; close if the sphere nearly touches a plane from outside or in, within a small
+	// fraction of the terms' size, where float rounding may decide either way
+	bool visible = true;
+	close = false;
+	for (int k = 0; k < 6; k++) {
+		double d = PlaneDistance(f.planes[k], c.x, c.y, c.z)+r;
+		close = close || fabs(d) < 1e-6*(PlaneScale(f.planes[k], c.x, c.y, c.z)+r);
+		visible = visible && d >= 0;
+	}
+	return visible;
+}
+
+bool BoxVisible(ViewFrustum &f, vec3 min, vec3 max, bool &close) {
+	// in double: out if the corner furthest along a plane's normal is behind it
+	bool visible = true;
+	close = false;
+	for (int k = 0; k < 6; k++) {
+		vec4 &p = f.planes[k];
+		double x = p.x > 0? max.x : min.x, y = p.y > 0? max.y : min.y, z = p.z > 0? max.z : min.z;
+		double d = PlaneDistance(p, x, y, z);
+		close = close || fabs(d) < 1e-6*(PlaneScale(p, x, y, z)+PlaneScale(p, min.x, min.y, min.z));
+		visible = visible && d >= 0;
+	}
+	return visible;
+}
+
+// Test bounds
+
+vec3 PointByPlane(ViewFrustum &f, float offset) {
+	// a point offset from a random frustum plane (negative is outside)
+	vec4 &p = f.planes[rand()%6];
+	vec3 q(Random(-50, 50), Random(-50, 50), Random(-150, 50)), n(p.x, p.y, p.z);
+	return q-(float) (PlaneDistance(p, q.x, q.y, q.z)-offset)*n;
+}
+
+void RandomBounds(ViewFrustum &f, int n, Spheres &spheres, Boxes &boxes) {
+	// a third scattered about the frustum, a third just inside or outside a plane,
+	// a third straddling a plane
+	spheres.Clear();
+	boxes.Clear();
+	for (int i = 0; i < n; i++) {
+		vec3 c, e(Random(0, 3), Random(0, 3), Random(0, 3));
+		float r = Random(0, 3);
+		switch (i%3) {
+			case 0: c = vec3(Random(-100, 100), Random(-100, 100), Random(-150, 50)); break;
+			case 1: c = PointByPlane(f, (rand()%2? 1 : -1)*(r+Random(.001f, .1f))); break;
+			default: c = PointByPlane(f, Random(-r, r));
+		}
+		vec3 min = c-e, max = c+e;
+		spheres.Add(c, r);
+		boxes.Add(min, max);
+	}
+}
+
+// Test
+
+bool Ascending(vector<int> &ids) {
+	for (size_t i = 1; i < ids.size(); i++)
+		if (ids[i] <= ids[i-1])
+			return false;
+	return true;
+}
+
+bool Test(const char *name, mat4 fullview, int n) {
+	// Cull, on one and four threads, must list exactly the bounds ViewFrustum::Visible passes (the
+	// same float arithmetic), and agree with the double precision test except very near a plane
+	ViewFrustum f(fullview);
+	Spheres spheres;
+	Boxes boxes;
+	RandomBounds(f, n, spheres, boxes);
+	vector<int> visible, visible4;
+	int nSpheresDiffer = 0, nBoxesDiffer = 0, nClose = 0;
+	Cull(f, spheres, visible, 1);
+	Cull(f, spheres, visible4, 4);
+	bool ok = Ascending(visible) && visible == visible4;
+	for (int i = 0, k = 0; i < n; i++) {
+		vec3 c(spheres.x[i], spheres.y[i], spheres.z[i]);
+		bool listed = k < (int) visible.size() && visible[k] == i, close;
+		k += listed;
+		ok = ok && listed == f.Visible(c, spheres.r[i]);
+		if (listed != SphereVisible(f, c, spheres.r[i], close))
+			close? nClose++ : nSpheresDiffer++;
+	}
+	int nSpheres = (int) visible.size();
+	Cull(f, boxes, visible, 1);
+	Cull(f, boxes, visible4, 4);
+	ok = ok && Ascending(visible) && visible == visible4;
+	for (int i = 0, k = 0; i < n; i++) {
+		vec3 min(boxes.x0[i], boxes.y0[i], boxes.z0[i]), max(boxes.x1[i], boxes.y1[i], boxes.z1[i]);
+		bool listed = k < (int) visible.size() && visible[k] == i, close;
+		k += listed;
+		ok = ok && listed == f.Visible(min, max);
+		if (listed != BoxVisible(f, min, max, close))
+			close? nClose++ : nBoxesDiffer++;
+	}
+	ok = ok && !nSpheresDiffer && !nBoxesDiffer;
+	printf("  %s, %6i: %6i spheres, %6i boxes visible; %i, %i differ from the plane test, %i more within rounding %s\n",
+		name, n, nSpheres, (int) visible.size(), nSpheresDiffer, nBoxesDiffer, nClose, ok? "" : "FAILED");
+	return ok;
+}
+
+int main() {
+	// Test-Cull
+	mat4 views[] = {
+		Perspective(60, 1.5f, -.1f, -100)*LookAt(vec3(0, 0, 0), vec3(0, 0, -1), vec3(0, 1, 0)),
+		Perspective(45, 1, -.01f, -500)*Translate(0, 0, -50)*RotateY(30)*RotateX(-20)
+	};
+	const char *names[] = {"view 1", "view 2"};
+	// tails of 1 to 3 after groups of four, and more than one block of 1 << 14
+	int sizes[] = {0, 1, 2, 3, 4, 5, 7, 4099, 40003};
+	bool ok = true;
+	srand(1);
+	for (int v = 0; v < 2; v++)
+		for (int s = 0; s < (int) (sizeof(sizes)/sizeof(sizes[0])); s++)
+			ok = Test(names[v], views[v], sizes[s]) && ok;
+	printf("%s\n", ok? "passed" : "FAILED");
+	return ok? 0 : 1;
+}
@@ -0,0 +1,106 @@
+// Test-MatInverse.cpp: inverse, affineInverse, rigidInverse and NormalMatrix on random matrices;
+// build as is for SSE, and with VEC_NO_SIMD for scalar
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "mat.h"
+
+float Random() { return 2*(float) rand()/RAND_MAX-1; }
+
+mat4 RandomMatrix() {
+	// random entries plus 5I: each diagonal entry outweighs the rest of its row, so the matrix
+	// is well conditioned
+	mat4 m(5);
+	for (int i = 0; i < 4; i++)
+		m[i] += vec4(Random(), Random(), Random(), Random());
+	return m;
+}
+
+mat4 RandomRigid() {
+	// rotation and translation only
+	return Translate(5*Random(), 5*Random(), 5*Random())*RotateZ(180*Random())*RotateY(180*Random())*RotateX(180*Random());
+}
+
+mat4 RandomAffine() {
+	// rigid with a non-uniform scale
+	return RandomRigid()*Scale(1.5f+.4f*Random(), 1+.9f*Random(), 2+Random());
+}
+
+double ProductError(const mat4 &a, const mat4 &b) {
+	// largest entry of a*b-I, in double so only the inverse's error is measured
+	double e = 0;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++) {
+			double s = 0;
+			for (int k = 0; k < 4; k++)
+				s += (double) a[i][k]*b[k][j];
+			e = fmax(e, fabs(s-(i == j)));
+		}
+	return e;
+}
+
+double NormalError(const mat4 &a, const mat3 &n) {
+	// largest difference of n from transpose(inverse(upper 3x3 of a)), computed in double from
+	// cofactors, relative to the largest entry
+	double m[3][3], c[3][3];
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			m[i][j] = a[i][j];
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++) {
+			int i1 = (i+1)%3, i2 = (i+2)%3, j1 = (j+1)%3, j2 = (j+2)%3;
+			c[i][j] = m[i1][j1]*m[i2][j2]-m[i1][j2]*m[i2][j1];
+		}
+	double det = m[0][0]*c[0][0]+m[0][1]*c[0][1]+m[0][2]*c[0][2], e = 0, max = 0;
+	// inverse = transpose(c)/det, so its transpose is c/det
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++) {
+			e = fmax(e, fabs(n[i][j]-c[i][j]/det));
+			max = fmax(max, fabs(c[i][j]/det));
+		}
+	return e/max;
+}
+
+bool Check(const char *name, double error, double tolerance) {
+	bool ok = error < tolerance;
+	printf("  %-34s max error %8.2g %s\n", name, error, ok? "" : "FAILED");
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	// Test-MatInverse [# matrices of each kind]
+	int n = argc > 1? atoi(argv[1]) : 100000;
+	double eInverse = 0, eInverseAffine = 0, eInverseRigid = 0, eAffine = 0, eAffineRigid = 0, eRigid = 0, eNormal = 0;
+	srand(1);
+	for (int i = 0; i < n; i++) {
+		mat4 g = RandomMatrix(), a = RandomAffine(), r = RandomRigid();
+		eInverse = fmax(eInverse, ProductError(g, inverse(g)));
+		eInverseAffine = fmax(eInverseAffine, ProductError(a, inverse(a)));
+		eInverseRigid = fmax(eInverseRigid, ProductError(r, inverse(r)));
+		eAffine = fmax(eAffine, ProductError(a, affineInverse(a)));
+		eAffineRigid = fmax(eAffineRigid, ProductError(r, affineInverse(r)));
+		eRigid = fmax(eRigid, ProductError(r, rigidInverse(r)));
+		eNormal = fmax(eNormal, fmax(NormalError(a, NormalMatrix(a)), NormalError(g, NormalMatrix(g))));
+	}
+#ifdef VEC_SSE
+	printf("%i matrices of each kind, SSE\n", n);
+#else
+	printf("%i matrices of each kind, scalar\n", n);
+#endif
+	bool ok = true;
+	ok &= Check("A*inverse(A), random", eInverse, 1e-5);
+	ok &= Check("A*inverse(A), affine", eInverseAffine, 1e-5);
+	ok &= Check("A*inverse(A), rigid", eInverseRigid, 1e-5);
+	ok &= Check("A*affineInverse(A), affine", eAffine, 1e-5);
+	ok &= Check("A*affineInverse(A), rigid", eAffineRigid, 1e-5);
+	ok &= Check("A*rigidInverse(A), rigid", eRigid, 1e-5);
+	ok &= Check("NormalMatrix, random and affine", eNormal, 1e-5);
+	// a singular matrix gives non-finite entries rather than a wrong inverse
+	mat4 s = inverse(mat4(vec4(1, 2, 3, 4), vec4(2, 4, 6, 8), vec4(0, 1, 0, 0), vec4(0, 0, 0, 1)));
+	bool nonFinite = !(s[0][0]-s[0][0] == 0);
+	printf("  %-34s %s\n", "singular A", nonFinite? "non-finite inverse" : "finite inverse, FAILED");
+	ok &= nonFinite;
+	printf("%s\n", ok? "passed" : "FAILED");
+	return ok? 0 : 1;
+}
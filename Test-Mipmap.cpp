@@ -0,0 +1,134 @@
+// Test-Mipmap.cpp: BuildMipmaps on one and more threads against a scalar box filter, for 1, 3 and 4
+// channels and odd, single row and single column sizes; WriteMipmaps/ReadMipmaps round trip, with
+// the cache refused once its source changes
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Mipmap.h"
+
+// Scalar reference
+
+void Downsample(MipLevel &src, MipLevel &dst, int c) {
+	// 2x2 box filter, an odd last row or column dropped, a single row or column averaged with itself
+	int sw = src.width, sh = src.height, dw = sw > 1? sw/2 : 1, dh = sh > 1? sh/2 : 1;
+	dst.width = dw;
+	dst.height = dh;
+	dst.pixels.resize((size_t) dw*dh*c);
+	for (int y = 0; y < dh; y++) {
+		int y0 = 2*y, y1 = sh > 1? 2*y+1 : 2*y;
+		for (int x = 0; x < dw; x++)
+			for (int k = 0; k < c; k++) {
+				unsigned char *d = &dst.pixels[((size_t) y*dw+x)*c+k];
+				if (sw == 1)
+					*d = (unsigned char) ((src.pixels[(size_t) y0*c+k]+src.pixels[(size_t) y1*c+k]+1)>>1);
+				else {
+					size_t r0 = (size_t) y0*sw, r1 = (size_t) y1*sw;
+					int s = src.pixels[(r0+2*x)*c+k]+src.pixels[(r0+2*x+1)*c+k]+
+							src.pixels[(r1+2*x)*c+k]+src.pixels[(r1+2*x+1)*c+k];
+					*d = (unsigned char) ((s+2)>>2);
+				}
+			}
+	}
+}
+
+void RandomLevel(MipLevel &l, int width, int height, int channels) {
+	l.width = width;
+	l.height = height;
+	l.pixels.resize((size_t) width*height*channels);
+	for (size_t i = 0; i < l.pixels.size(); i++)
+		l.pixels[i] = (unsigned char) (rand()%4 == 0? 255 : rand()&255);	// many 255s, the largest sums
+}
+
+bool Same(vector<MipLevel> &a, vector<MipLevel> &b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+		if (a[i].width != b[i].width || a[i].height != b[i].height || a[i].pixels != b[i].pixels)
+			return false;
+	return true;
+}
+
+// Tests
+
+bool TestBuild(int width, int height, int channels) {
+	// every level, on 1, 3 and 4 threads, must equal the scalar filter's
+	vector<MipLevel> ref(1), levels;
+	RandomLevel(ref[0], width, height, channels);
+	while (ref.back().width > 1 || ref.back().height > 1) {
+		ref.push_back(MipLevel());
+		Downsample(ref[ref.size()-2], ref.back(), channels);
+	}
+	int threads[] = {1, 3, 4};
+	bool ok = true;
+	for (int t = 0; t < 3; t++) {
+		levels.assign(1, ref[0]);
+		BuildMipmaps(levels, channels, threads[t]);
+		ok = ok && Same(levels, ref);
+	}
+	printf("  BuildMipmaps %4ix%-4i %i channel%s %2i levels %s\n", width, height, channels, channels > 1? "s" : " ",
+		(int) ref.size(), ok? "" : "FAILED");
+	return ok;
+}
+
+bool WriteSource(const char *filename, int nBytes) {
+	FILE *out = fopen(filename, "wb");
+	if (!out)
+		return false;
+	for (int i = 0; i < nBytes; i++)
+		fputc(i&255, out);
+	return fclose(out) == 0;
+}
+
+bool Check(const char *name, bool ok) {
+	printf("  %-44s %s\n", name, ok? "" : "FAILED");
+	return ok;
+}
+
+bool TestCache() {
+	// a cache reads back as written while its source is unchanged, and not after
+	const char *cacheName = "Test-Mipmap.mip", *sourceName = "Test-Mipmap.src";
+	vector<MipLevel> levels(1), read;
+	RandomLevel(levels[0], 37, 20, 3);
+	BuildMipmaps(levels, 3);
+	int channels = 0;
+	bool ok = WriteSource(sourceName, 100);
+	ok = Check("write with source key", ok && WriteMipmaps(cacheName, levels, 3, sourceName)) && ok;
+	ok = Check("read, source unchanged", ReadMipmaps(cacheName, read, channels, sourceName) && channels == 3 && Same(read, levels)) && ok;
+	ok = Check("read, source not checked", ReadMipmaps(cacheName, read, channels) && Same(read, levels)) && ok;
+	ok = Check("read, other source", !ReadMipmaps(cacheName, read, channels, cacheName) && read.empty()) && ok;
+	WriteSource(sourceName, 101);
+	ok = Check("read, source changed", !ReadMipmaps(cacheName, read, channels, sourceName) && read.empty()) && ok;
+	// a cache cut short is incomplete
+	ok = Check("write without source key", WriteMipmaps(cacheName, levels, 3)) && ok;
+	FILE *in = fopen(cacheName, "rb");
+	vector<char> bytes;
+	if (in) {
+		for (int c; (c = fgetc(in)) != EOF; )
+			bytes.push_back((char) c);
+		fclose(in);
+	}
+	FILE *out = fopen(cacheName, "wb");
+	if (out && !bytes.empty()) {
+		fwrite(&bytes[0], bytes.size()-1, 1, out);
+		fclose(out);
+	}
+	ok = Check("read, truncated", !bytes.empty() && !ReadMipmaps(cacheName, read, channels) && read.empty()) && ok;
+	remove(cacheName);
+	remove(sourceName);
+	return ok;
+}
+
+int main() {
+	// Test-Mipmap
+	int sizes[][2] = {{256, 256}, {257, 131}, {1000, 3}, {3, 1000}, {1, 77}, {77, 1}, {2, 1}, {1, 1}, {33, 65}};
+	bool ok = true;
+	srand(1);
+	for (int s = 0; s < (int) (sizeof(sizes)/sizeof(sizes[0])); s++)
+		for (int channels = 1; channels <= 4; channels++)
+			if (channels != 2)
+				ok = TestBuild(sizes[s][0], sizes[s][1], channels) && ok;
+	ok = TestCache() && ok;
+	printf("%s\n", ok? "passed" : "FAILED");
+	return ok? 0 : 1;
+}
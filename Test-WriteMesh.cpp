@@ -0,0 +1,186 @@
+// Test-WriteMesh.cpp: WriteAsciiObj and WriteSTL read back exactly; round-trip timing
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include "MeshIO.h"
+
+// Test data
+
+unsigned Random32() {
+	// xorshift, so the floats cover every exponent and mantissa bit
+	static unsigned s = 2463534242u;
+	s ^= s << 13;
+	s ^= s >> 17;
+	s ^= s << 5;
+	return s;
+}
+
+float RandomFloat() {
+	// any finite float, denormals and signed zeros included
+	for (;;) {
+		unsigned u = Random32();
+		float f;
+		memcpy(&f, &u, 4);
+		if (f-f == 0)
+			return f;
+	}
+}
+
+void RandomMesh(int nTriangles, vector<vec3> &points, vector<vec3> &normals, vector<vec2> &uvs,
+				vector<int3> &triangles, vector<int> &groups) {
+	// each triangle has three points of its own, in order, so ReadAsciiObj numbers them the same
+	int n = 3*nTriangles;
+	points.resize(n);
+	normals.resize(n);
+	uvs.resize(n);
+	triangles.resize(nTriangles);
+	groups.resize(nTriangles);
+	for (int i = 0; i < n; i++) {
+		points[i] = vec3(RandomFloat(), RandomFloat(), RandomFloat());
+		normals[i] = vec3(RandomFloat(), RandomFloat(), RandomFloat());
+		uvs[i] = vec2(RandomFloat(), RandomFloat());
+	}
+	for (int t = 0, g = 0; t < nTriangles; t++) {
+		triangles[t] = int3(3*t, 3*t+1, 3*t+2);
+		g += Random32()%100 == 0;
+		groups[t] = g;
+	}
+}
+
+// Comparison
+
+template<class T> bool Same(vector<T> &a, vector<T> &b, const char *name) {
+	// bit for bit
+	bool same = a.size() == b.size() && (a.empty() || !memcmp(&a[0], &b[0], a.size()*sizeof(T)));
+	if (!same)
+		printf("  %s differ\n", name);
+	return same;
+}
+
+bool SameTriangles(vector<int3> &a, vector<int3> &b) {
+	// ReadAsciiObj may reverse a triangle to agree with its first vertex normal
+	bool same = a.size() == b.size();
+	for (size_t t = 0; t < a.size() && same; t++)
+		same = a[t] == b[t] || (a[t].i1 == b[t].i3 && a[t].i2 == b[t].i2 && a[t].i3 == b[t].i1);
+	if (!same)
+		printf("  triangles differ\n");
+	return same;
+}
+
+bool SameSTL(vector<VertexSTL> &a, vector<VertexSTL> &b) {
+	// ReadSTL may reverse a triangle to agree with its facet normal
+	bool same = a.size() == b.size();
+	for (size_t i = 0; i+2 < a.size() && same; i += 3) {
+		VertexSTL *u = &a[i], *v = &b[i];
+		same = !memcmp(u, v, 3*sizeof(VertexSTL)) || (!memcmp(u, v+2, sizeof(VertexSTL)) &&
+			   !memcmp(u+1, v+1, sizeof(VertexSTL)) && !memcmp(u+2, v, sizeof(VertexSTL)));
+	}
+	if (!same)
+		printf("  STL vertices differ\n");
+	return same;
+}
+
+// Timing
+
+float Seconds(std::function<bool()> f) {
+	auto start = std::chrono::steady_clock::now();
+	if (!f())
+		return -1;
+	return std::chrono::duration<float>(std::chrono::steady_clock::now()-start).count();
+}
+
+long long FileSize(const char *filename) {
+	long long size = 0, time;
+	SourceKey(filename, size, time);
+	return size;
+}
+
+bool PrintfObj(const char *filename, vector<vec3> &points, vector<int3> &triangles) {
+	// a line per fprintf, as the ad hoc writers did
+	FILE *out = fopen(filename, "w");
+	if (!out)
+		return false;
+	for (size_t i = 0; i < points.size(); i++)
+		fprintf(out, "v %.9g %.9g %.9g\n", points[i].x, points[i].y, points[i].z);
+	for (size_t t = 0; t < triangles.size(); t++)
+		fprintf(out, "f %i %i %i\n", triangles[t].i1+1, triangles[t].i2+1, triangles[t].i3+1);
+	return fclose(out) == 0;
+}
+
+int main(int argc, char **argv) {
+	// Test-WriteMesh [# triangles]
+	int nTriangles = argc > 1? atoi(argv[1]) : 1000000;
+	char *objName = (char *) "Test-WriteMesh.obj", *stlName = (char *) "Test-WriteMesh.stl";
+	vector<vec3> points, normals, points2, normals2;
+	vector<vec2> uvs, uvs2;
+	vector<int3> triangles, triangles2;
+	vector<int> groups, groups2;
+	RandomMesh(nTriangles, points, normals, uvs, triangles, groups);
+	bool ok = true;
+	// OBJ: random bit patterns must read back as the same floats
+	for (int nThreads = 1; nThreads <= 4; nThreads *= 3) {
+		printf("OBJ, %i thread%s:\n", nThreads, nThreads > 1? "s" : "");
+		bool pass = WriteAsciiObj(objName, points, triangles, &normals, &uvs, &groups, nThreads) &&
+					ReadAsciiObj(objName, points2, triangles2, &normals2, &uvs2, &groups2, nThreads);
+		pass = pass && Same(points, points2, "points") && Same(normals, normals2, "normals") &&
+			   Same(uvs, uvs2, "uvs") && SameTriangles(triangles, triangles2) && Same(groups, groups2, "groups");
+		printf("  %i floats %s\n", 8*3*nTriangles, pass? "read back exactly" : "FAILED");
+		ok = ok && pass;
+		points2.resize(0); normals2.resize(0); uvs2.resize(0); triangles2.resize(0); groups2.resize(0);
+	}
+	// STL: binary records are copied, so any float goes through
+	vector<VertexSTL> vertices(3*nTriangles), vertices2;
+	for (int i = 0; i < 3*nTriangles; i++) {
+		vertices[i].point = points[i];
+		vertices[i].normal = normals[3*(i/3)];
+	}
+	bool pass = WriteSTL(stlName, vertices) && ReadSTL(stlName, vertices2) == nTriangles;
+	pass = pass && SameSTL(vertices, vertices2);
+	printf("STL: %s\n", pass? "read back exactly" : "FAILED");
+	ok = ok && pass;
+	// round trip timing, on a mesh of ordinary values (a 1000x1000 grid)
+	int res = 1000;
+	points.resize(res*res);
+	normals.resize(res*res);
+	uvs.resize(res*res);
+	triangles.resize(0);
+	for (int j = 0; j < res; j++)
+		for (int i = 0; i < res; i++) {
+			float u = (float) i/(res-1), v = (float) j/(res-1);
+			points[j*res+i] = vec3(2*u-1, 2*v-1, .1f*u*v);
+			normals[j*res+i] = normalize(vec3(-.1f*v, -.1f*u, 2));
+			uvs[j*res+i] = vec2(u, v);
+		}
+	for (int j = 0; j < res-1; j++)
+		for (int i = 0; i < res-1; i++) {
+			int a = j*res+i, b = a+1, c = a+res, d = c+1;
+			triangles.push_back(int3(a, b, d));
+			triangles.push_back(int3(a, d, c));
+		}
+	printf("round trip, %i points, %i triangles:\n", res*res, (int) triangles.size());
+	float t = Seconds([&]() { return PrintfObj(objName, points, triangles); });
+	float mb = FileSize(objName)/(float) (1 << 20);
+	printf("  fprintf obj (v and f only)  %6.3f secs %7.1f MB/s\n", t, mb/t);
+	for (int nThreads = 1; nThreads <= 4; nThreads *= 4) {
+		t = Seconds([&]() { return WriteAsciiObj(objName, points, triangles, &normals, &uvs, NULL, nThreads); });
+		mb = FileSize(objName)/(float) (1 << 20);
+		printf("  WriteAsciiObj, %i thread%s    %6.3f secs %7.1f MB/s\n", nThreads, nThreads > 1? "s" : " ", t, mb/t);
+		t = Seconds([&]() {
+			points2.resize(0); normals2.resize(0); uvs2.resize(0); triangles2.resize(0);
+			return ReadAsciiObj(objName, points2, triangles2, &normals2, &uvs2, NULL, nThreads);
+		});
+		printf("  ReadAsciiObj, %i thread%s     %6.3f secs %7.1f MB/s\n", nThreads, nThreads > 1? "s" : " ", t, mb/t);
+		t = Seconds([&]() { return WriteSTL(stlName, points, triangles, nThreads); });
+		mb = FileSize(stlName)/(float) (1 << 20);
+		printf("  WriteSTL, %i thread%s         %6.3f secs %7.1f MB/s\n", nThreads, nThreads > 1? "s" : " ", t, mb/t);
+		t = Seconds([&]() { vertices2.resize(0); return ReadSTL(stlName, vertices2, nThreads) > 0; });
+		printf("  ReadSTL, %i thread%s          %6.3f secs %7.1f MB/s\n", nThreads, nThreads > 1? "s" : " ", t, mb/t);
+	}
+	remove(objName);
+	remove(stlName);
+	printf("%s\n", ok? "passed" : "FAILED");
+	return ok? 0 : 1;
+}
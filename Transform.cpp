@@ -0,0 +1,158 @@
+/* ======================================
+   Transform.cpp - transform arrays of points to clip, NDC or screen space
+   Copyright (c) Jules Bloomenthal, Seattle, 2012
+   All rights reserved
+   ====================================== */
+
+#include "Transform.h"
+#include "Parallel.h"
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XFORM_SSE
+#include <emmintrin.h>
+#endif
+
+using std::vector;
+
+static const int xformGrain = 1 << 14;
+
+// after the divide by w, screen = ndc*scale+offset (scale 1, offset 0 for NDC)
+
+static void Viewport(XformSpace space, int width, int height, float scale[2], float offset[2]) {
+	bool screen = space == ScreenSpace;
+	scale[0] = screen? .5f*(float) width : 1;
+	scale[1] = screen? .5f*(float) height : 1;
+	offset[0] = screen? scale[0] : 0;
+	offset[1] = screen? scale[1] : 0;
+}
+
+static void XformPoint(mat4 &m, float x, float y, float z, XformSpace space, float scale[2], float offset[2], float out[4]) {
+	for (int k = 0; k < 4; k++)
+		out[k] = m[k][0]*x+m[k][1]*y+m[k][2]*z+m[k][3];
+	if (space != ClipSpace) {
+		float w = out[3];
+		out[0] = (out[0]/w)*scale[0]+offset[0];
+		out[1] = (out[1]/w)*scale[1]+offset[1];
+		out[2] = out[2]/w;
+	}
+}
+
+static void Xform(mat4 &m, const vec3 *points, int i, int end, vec4 *out, XformSpace space, float scale[2], float offset[2]) {
+#ifdef XFORM_SSE
+	// one point per register: the columns of m weighted by x, y, z, plus the fourth column;
+	// then x, y, z times scale/w (w times 1) plus offset
+	__m128 c0 = _mm_loadu_ps(m[0]), c1 = _mm_loadu_ps(m[1]), c2 = _mm_loadu_ps(m[2]), c3 = _mm_loadu_ps(m[3]);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	if (space == ClipSpace)
+		for (; i < end; i++) {
+			const vec3 &p = points[i];
+			__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p.x)), _mm_mul_ps(c1, _mm_set1_ps(p.y))),
+								  _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p.z)), c3));
+			_mm_storeu_ps(out[i], v);
+		}
+	else {
+		__m128 sc = _mm_setr_ps(scale[0], scale[1], 1, 1), of = _mm_setr_ps(offset[0], offset[1], 0, 0);
+		__m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)), w1 = _mm_setr_ps(0, 0, 0, 1);
+		for (; i < end; i++) {
+			const vec3 &p = points[i];
+			__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p.x)), _mm_mul_ps(c1, _mm_set1_ps(p.y))),
+								  _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p.z)), c3));
+			__m128 s = _mm_div_ps(sc, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+			s = _mm_or_ps(_mm_and_ps(s, xyz), w1);
+			_mm_storeu_ps(out[i], _mm_add_ps(_mm_mul_ps(v, s), of));
+		}
+	}
+#endif
+	for (; i < end; i++)
+		XformPoint(m, points[i].x, points[i].y, points[i].z, space, scale, offset, out[i]);
+}
+
+void PointXform::Transform(const vec3 *points, int n, vec4 *out, XformSpace space, int nThreads) {
+	float scale[2], offset[2];
+	Viewport(space, width, height, scale, offset);
+	ParallelFor(n, [&](int i, int end) {
+		Xform(m, points, i, end, out, space, scale, offset);
+	}, xformGrain, nThreads);
+}
+
+void PointXform::Transform(const float *x, const float *y, const float *z, int n,
+						   float *ox, float *oy, float *oz, float *ow, XformSpace space, int nThreads) {
+	float scale[2], offset[2];
+	Viewport(space, width, height, scale, offset);
+	ParallelFor(n, [&](int i, int end) {
+#ifdef XFORM_SSE
+		// four points per register, each matrix element broadcast
+		__m128 e[4][4];
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				e[r][c] = _mm_set1_ps(m[r][c]);
+		__m128 sx = _mm_set1_ps(scale[0]), sy = _mm_set1_ps(scale[1]);
+		__m128 offx = _mm_set1_ps(offset[0]), offy = _mm_set1_ps(offset[1]), one = _mm_set1_ps(1);
+		for (; i+4 <= end; i += 4) {
+			__m128 px = _mm_loadu_ps(x+i), py = _mm_loadu_ps(y+i), pz = _mm_loadu_ps(z+i), v[4];
+			for (int r = 0; r < 4; r++)
+				v[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e[r][0], px), _mm_mul_ps(e[r][1], py)),
+								  _mm_add_ps(_mm_mul_ps(e[r][2], pz), e[r][3]));
+			if (space != ClipSpace) {
+				__m128 rw = _mm_div_ps(one, v[3]);
+				v[0] = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(v[0], rw), sx), offx);
+				v[1] = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(v[1], rw), sy), offy);
+				v[2] = _mm_mul_ps(v[2], rw);
+			}
+			_mm_storeu_ps(ox+i, v[0]);
+			_mm_storeu_ps(oy+i, v[1]);
+			if (oz)
+				_mm_storeu_ps(oz+i, v[2]);
+			if (ow)
+				_mm_storeu_ps(ow+i, v[3]);
+		}
+#endif
+		for (; i < end; i++) {
+			float o[4];
+			XformPoint(m, x[i], y[i], z[i], space, scale, offset, o);
+			ox[i] = o[0];
+			oy[i] = o[1];
+			if (oz)
+				oz[i] = o[2];
+			if (ow)
+				ow[i] = o[3];
+		}
+	}, xformGrain, nThreads);
+}
+
+int PointXform::Nearest(int x, int y, const vec3 *points, int n, float maxDistSq, float *distSq, int nThreads) {
+	// each block transforms its points a few at a time into a local buffer, then keeps its nearest
+	const int nBuf = 256;
+	int nBlocks = (n+xformGrain-1)/xformGrain;
+	vector<int> ids(nBlocks, -1);
+	vector<float> dists(nBlocks, maxDistSq);
+	float scale[2], offset[2], fx = (float) x, fy = (float) y;
+	Viewport(ScreenSpace, width, height, scale, offset);
+	ParallelFor(nBlocks, [&](int b0, int b1) {
+		vec4 buf[nBuf];
+		for (int b = b0; b < b1; b++) {
+			int i0 = b*xformGrain, i1 = i0+xformGrain < n? i0+xformGrain : n;
+			for (int i = i0; i < i1; i += nBuf) {
+				int end = i+nBuf < i1? i+nBuf : i1;
+				Xform(m, points+i, 0, end-i, buf, ScreenSpace, scale, offset);
+				for (int k = 0; k < end-i; k++) {
+					float dx = fx-buf[k].x, dy = fy-buf[k].y, d = dx*dx+dy*dy;
+					if (buf[k].w > 0 && d < dists[b]) {
+						dists[b] = d;
+						ids[b] = i+k;
+					}
+				}
+			}
+		}
+	}, 1, nThreads);
+	int id = -1;
+	float dist = maxDistSq;
+	for (int b = 0; b < nBlocks; b++)
+		if (ids[b] >= 0 && dists[b] < dist) {
+			dist = dists[b];
+			id = ids[b];
+		}
+	if (distSq && id >= 0)
+		*distSq = dist;
+	return id;
+}
@@ -0,0 +1,37 @@
+/*	==============================
+    Transform.h - transform arrays of points to clip, NDC or screen space
+    Copyright (c) Jules Bloomenthal, 2012-2016
+    All rights reserved
+	=============================== */
+
+#ifndef TRANSFORM_HDR
+#define TRANSFORM_HDR
+
+#include "mat.h"
+
+enum XformSpace { ClipSpace, NDCSpace, ScreenSpace };
+
+class PointXform {
+	// the per-point ScreenPoint, ScreenDistSq and IsVisible in bulk: one matrix and one window size
+	// (no glutGet per point), SSE where the compiler targets it, blocks of points on nThreads threads
+	// (0 for one per hardware thread)
+public:
+	mat4  m;								// object to clip space, as fullview
+	int   width, height;					// window, in pixels, for ScreenSpace
+	PointXform(const mat4 &m, int width = 1, int height = 1) : m(m), width(width), height(height) { }
+	void Transform(const vec3 *points, int n, vec4 *out, XformSpace space = ScreenSpace, int nThreads = 1);
+		// set out[i] to points[i] transformed by m:
+		//   ClipSpace:   (x, y, z, w)
+		//   NDCSpace:    (x/w, y/w, z/w, w)
+		//   ScreenSpace: ((x/w+1)*width/2, (y/w+1)*height/2, z/w, w), in pixels as ScreenPoint
+		// a point with w <= 0 is behind the eye; its NDC and screen x, y, z are not meaningful
+	void Transform(const float *x, const float *y, const float *z, int n,
+				   float *ox, float *oy, float *oz, float *ow, XformSpace space = ScreenSpace, int nThreads = 1);
+		// as above for points and results in separate arrays of components; oz and ow may be NULL
+	int Nearest(int x, int y, const vec3 *points, int n, float maxDistSq = 100, float *distSq = NULL, int nThreads = 1);
+		// return the index of the point whose screen location is nearest pixel (x, y) and closer than
+		// maxDistSq (squared pixels), -1 if none; points behind the eye are skipped; if non-null, set distSq
+		// (for a set of points, what ScreenDistSq(x, y, p, m) < maxDistSq is for one)
+};
+
+#endif
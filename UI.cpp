@@ -22,23 +22,17 @@ float ScreenDistSq(int x, int y, vec3 p, mat4 m) {
 void ScreenLine(float xscreen, float yscreen, mat4 &modelview, mat4 &persp, float p1[], float p2[]) {
     // compute 3D world space line, given by p1 and p2, that transforms
     // to a line perpendicular to the screen at (xscreen, yscreen)
+	// unproject the pixel at depths .25 and .5 (as gluUnProject) by the inverse of persp*modelview
 	int vp[4];
-	double tpersp[4][4], tmodelview[4][4], a[3], b[3];
-	// get viewport
 	glGetIntegerv(GL_VIEWPORT, vp);
-	// create transposes
-	for (int i = 0; i < 4; i++)
-		for (int j = 0; j < 4; j++) {
-			tmodelview[i][j] = modelview[j][i];
-			tpersp[i][j] = persp[j][i];
-		}
-	if (gluUnProject(xscreen, yscreen, .25, (const double*) tmodelview, (const double*) tpersp, vp, &a[0], &a[1], &a[2]) == GL_FALSE)
-        printf("UnProject false\n");
-	if (gluUnProject(xscreen, yscreen, .50, (const double*) tmodelview, (const double*) tpersp, vp, &b[0], &b[1], &b[2]) == GL_FALSE)
+	mat4 inv = inverse(persp*modelview);
+	float x = 2*(xscreen-vp[0])/vp[2]-1, y = 2*(yscreen-vp[1])/vp[3]-1;
+	vec4 a = inv*vec4(x, y, -.5f, 1), b = inv*vec4(x, y, 0, 1);
+	if (a.w == 0 || b.w == 0)
         printf("UnProject false\n");
 	for (int i = 0; i < 3; i++) {
-		p1[i] = (float) a[i];
-		p2[i] = (float) b[i];
+		p1[i] = a[i]/a.w;
+		p2[i] = b[i]/b.w;
 	}
 }
 
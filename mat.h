@@ -25,49 +25,42 @@ class mat2 {
     //  --- Constructors and Destructors ---
     //
 
-    mat2( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;   }
+    constexpr mat2( const GLfloat d = GLfloat(1.0) ) :  // Create a diagional matrix
+	_m{ vec2( d, 0 ), vec2( 0, d ) } {}
 
-    mat2( const vec2& a, const vec2& b )
-	{ _m[0] = a;  _m[1] = b;  }
+    constexpr mat2( const vec2& a, const vec2& b ) :
+	_m{ a, b } {}
 
-    mat2( GLfloat m00, GLfloat m10, GLfloat m01, GLfloat m11 )
-	{ _m[0] = vec2( m00, m01 ); _m[1] = vec2( m10, m11 ); }
-
-    mat2( const mat2& m ) {
-	if ( *this != m ) {
-	    _m[0] = m._m[0];
-	    _m[1] = m._m[1];
-	} 
-    }
+    constexpr mat2( GLfloat m00, GLfloat m10, GLfloat m01, GLfloat m11 ) :
+	_m{ vec2( m00, m01 ), vec2( m10, m11 ) } {}
 
     //
     //  --- Indexing Operator ---
     //
 
     vec2& operator [] ( int i ) { return _m[i]; }
-    const vec2& operator [] ( int i ) const { return _m[i]; }
+    constexpr const vec2& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithmetic Operators ---
     //
 
-    mat2 operator + ( const mat2& m ) const
+    constexpr mat2 operator + ( const mat2& m ) const
 	{ return mat2( _m[0]+m[0], _m[1]+m[1] ); }
 
-    mat2 operator - ( const mat2& m ) const
+    constexpr mat2 operator - ( const mat2& m ) const
 	{ return mat2( _m[0]-m[0], _m[1]-m[1] ); }
 
-    mat2 operator * ( const GLfloat s ) const 
+    constexpr mat2 operator * ( const GLfloat s ) const 
 	{ return mat2( s*_m[0], s*_m[1] ); }
 
-    mat2 operator / ( const GLfloat s ) const {
+    constexpr mat2 operator / ( const GLfloat s ) const {
 	
 	GLfloat r = GLfloat(1.0) / s;
 	return *this * r;
     }
 
-    friend mat2 operator * ( const GLfloat s, const mat2& m )
+    friend constexpr mat2 operator * ( const GLfloat s, const mat2& m )
 	{ return m * s; }
 	
     mat2 operator * ( const mat2& m ) const {
@@ -127,9 +120,9 @@ class mat2 {
     //  --- Matrix / Vector operators ---
     //
 
-    vec2 operator * ( const vec2& v ) const {  // m * v
-	return vec2( _m[0][0]*v.x + _m[0][1]*v.y,
-		     _m[1][0]*v.x + _m[1][1]*v.y );
+    constexpr vec2 operator * ( const vec2& v ) const {  // m * v
+	return vec2( _m[0].x*v.x + _m[0].y*v.y,
+		     _m[1].x*v.x + _m[1].y*v.y );
     }
 	
     //
@@ -140,7 +133,7 @@ class mat2 {
 	{ return os << std::endl << m[0] << std::endl << m[1] << std::endl; }
 
     friend std::istream& operator >> ( std::istream& is, mat2& m )
-	{ return is >> m._m[0] >> m._m[1] ; }
+	{ return is >> m[0] >> m[1] ; }
 
     //
     //  --- Conversion Operators ---
@@ -165,8 +158,8 @@ mat2 matrixCompMult( const mat2& A, const mat2& B ) {
 
 inline
 mat2 transpose( const mat2& A ) {
-    return mat2( A[0][0], A[1][0],
-		 A[0][1], A[1][1] );
+    return mat2( vec2( A[0][0], A[1][0] ),
+		 vec2( A[0][1], A[1][1] ) );
 }
 
 //----------------------------------------------------------------------------
@@ -183,56 +176,45 @@ class mat3 {
     //  --- Constructors and Destructors ---
     //
 
-    mat3( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;  _m[2].z = d;   }
-
-    mat3( const vec3& a, const vec3& b, const vec3& c )
-	{ _m[0] = a;  _m[1] = b;  _m[2] = c;  }
+    constexpr mat3( const GLfloat d = GLfloat(1.0) ) :  // Create a diagional matrix
+	_m{ vec3( d, 0, 0 ), vec3( 0, d, 0 ), vec3( 0, 0, d ) } {}
 
-    mat3( GLfloat m00, GLfloat m10, GLfloat m20,
-	  GLfloat m01, GLfloat m11, GLfloat m21,
-	  GLfloat m02, GLfloat m12, GLfloat m22 ) 
-	{
-	    _m[0] = vec3( m00, m01, m02 );
-	    _m[1] = vec3( m10, m11, m12 );
-	    _m[2] = vec3( m20, m21, m22 );
-	}
+    constexpr mat3( const vec3& a, const vec3& b, const vec3& c ) :
+	_m{ a, b, c } {}
 
-    mat3( const mat3& m )
-	{
-	    if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-		_m[2] = m._m[2];
-	    } 
-	}
+    constexpr mat3( GLfloat m00, GLfloat m10, GLfloat m20,
+		    GLfloat m01, GLfloat m11, GLfloat m21,
+		    GLfloat m02, GLfloat m12, GLfloat m22 ) :
+	_m{ vec3( m00, m01, m02 ),
+	    vec3( m10, m11, m12 ),
+	    vec3( m20, m21, m22 ) } {}
 
     //
     //  --- Indexing Operator ---
     //
 
     vec3& operator [] ( int i ) { return _m[i]; }
-    const vec3& operator [] ( int i ) const { return _m[i]; }
+    constexpr const vec3& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithmatic Operators ---
     //
 
-    mat3 operator + ( const mat3& m ) const
+    constexpr mat3 operator + ( const mat3& m ) const
 	{ return mat3( _m[0]+m[0], _m[1]+m[1], _m[2]+m[2] ); }
 
-    mat3 operator - ( const mat3& m ) const
+    constexpr mat3 operator - ( const mat3& m ) const
 	{ return mat3( _m[0]-m[0], _m[1]-m[1], _m[2]-m[2] ); }
 
-    mat3 operator * ( const GLfloat s ) const 
+    constexpr mat3 operator * ( const GLfloat s ) const 
 	{ return mat3( s*_m[0], s*_m[1], s*_m[2] ); }
 
-    mat3 operator / ( const GLfloat s ) const {
+    constexpr mat3 operator / ( const GLfloat s ) const {
 	GLfloat r = GLfloat(1.0) / s;
 	return *this * r;
     }
 
-    friend mat3 operator * ( const GLfloat s, const mat3& m )
+    friend constexpr mat3 operator * ( const GLfloat s, const mat3& m )
 	{ return m * s; }
 	
     mat3 operator * ( const mat3& m ) const {
@@ -291,10 +273,8 @@ class mat3 {
     //  --- Matrix / Vector operators ---
     //
 
-    vec3 operator * ( const vec3& v ) const {  // m * v
-	return vec3( _m[0][0]*v.x + _m[0][1]*v.y + _m[0][2]*v.z,
-		     _m[1][0]*v.x + _m[1][1]*v.y + _m[1][2]*v.z,
-		     _m[2][0]*v.x + _m[2][1]*v.y + _m[2][2]*v.z );
+    constexpr vec3 operator * ( const vec3& v ) const {  // m * v
+	return vec3( dot( _m[0], v ), dot( _m[1], v ), dot( _m[2], v ) );
     }
 	
     //
@@ -309,7 +289,7 @@ class mat3 {
     }
 
     friend std::istream& operator >> ( std::istream& is, mat3& m )
-	{ return is >> m._m[0] >> m._m[1] >> m._m[2] ; }
+	{ return is >> m[0] >> m[1] >> m[2] ; }
 
     //
     //  --- Conversion Operators ---
@@ -335,9 +315,9 @@ mat3 matrixCompMult( const mat3& A, const mat3& B ) {
 
 inline
 mat3 transpose( const mat3& A ) {
-    return mat3( A[0][0], A[1][0], A[2][0],
-		 A[0][1], A[1][1], A[2][1],
-		 A[0][2], A[1][2], A[2][2] );
+    return mat3( vec3( A[0][0], A[1][0], A[2][0] ),
+		 vec3( A[0][1], A[1][1], A[2][1] ),
+		 vec3( A[0][2], A[1][2], A[2][2] ) );
 }
 
 //----------------------------------------------------------------------------
@@ -354,73 +334,77 @@ class mat4 {
     //  --- Constructors and Destructors ---
     //
 
-    mat4( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;  _m[2].z = d;  _m[3].w = d; }
+    constexpr mat4( const GLfloat d = GLfloat(1.0) ) :  // Create a diagional matrix
+	_m{ vec4( d, 0, 0, 0 ), vec4( 0, d, 0, 0 ), vec4( 0, 0, d, 0 ), vec4( 0, 0, 0, d ) } {}
 
-    mat4( const vec4& a, const vec4& b, const vec4& c, const vec4& d )
-	{ _m[0] = a;  _m[1] = b;  _m[2] = c;  _m[3] = d; }
+    constexpr mat4( const vec4& a, const vec4& b, const vec4& c, const vec4& d ) :
+	_m{ a, b, c, d } {}
 
-    mat4( GLfloat m00, GLfloat m10, GLfloat m20, GLfloat m30,
-	  GLfloat m01, GLfloat m11, GLfloat m21, GLfloat m31,
-	  GLfloat m02, GLfloat m12, GLfloat m22, GLfloat m32,
-	  GLfloat m03, GLfloat m13, GLfloat m23, GLfloat m33 )
-	{
-	    _m[0] = vec4( m00, m01, m02, m03 );
-	    _m[1] = vec4( m10, m11, m12, m13 );
-	    _m[2] = vec4( m20, m21, m22, m23 );
-	    _m[3] = vec4( m30, m31, m32, m33 );
-	}
-
-    mat4( const mat4& m )
-	{
-	    if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-		_m[2] = m._m[2];
-		_m[3] = m._m[3];
-	    } 
-	}
+    constexpr mat4( GLfloat m00, GLfloat m10, GLfloat m20, GLfloat m30,
+		    GLfloat m01, GLfloat m11, GLfloat m21, GLfloat m31,
+		    GLfloat m02, GLfloat m12, GLfloat m22, GLfloat m32,
+		    GLfloat m03, GLfloat m13, GLfloat m23, GLfloat m33 ) :
+	_m{ vec4( m00, m01, m02, m03 ),
+	    vec4( m10, m11, m12, m13 ),
+	    vec4( m20, m21, m22, m23 ),
+	    vec4( m30, m31, m32, m33 ) } {}
 
     //
     //  --- Indexing Operator ---
     //
 
     vec4& operator [] ( int i ) { return _m[i]; }
-    const vec4& operator [] ( int i ) const { return _m[i]; }
+    constexpr const vec4& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    mat4 operator + ( const mat4& m ) const
+    constexpr mat4 operator + ( const mat4& m ) const
 	{ return mat4( _m[0]+m[0], _m[1]+m[1], _m[2]+m[2], _m[3]+m[3] ); }
 
-    mat4 operator - ( const mat4& m ) const
+    constexpr mat4 operator - ( const mat4& m ) const
 	{ return mat4( _m[0]-m[0], _m[1]-m[1], _m[2]-m[2], _m[3]-m[3] ); }
 
-    mat4 operator * ( const GLfloat s ) const 
+    constexpr mat4 operator * ( const GLfloat s ) const 
 	{ return mat4( s*_m[0], s*_m[1], s*_m[2], s*_m[3] ); }
 
-    mat4 operator / ( const GLfloat s ) const {
+    constexpr mat4 operator / ( const GLfloat s ) const {
 	GLfloat r = GLfloat(1.0) / s;
 	return *this * r;
     }
 
-    friend mat4 operator * ( const GLfloat s, const mat4& m )
+    friend constexpr mat4 operator * ( const GLfloat s, const mat4& m )
 	{ return m * s; }
 	
     mat4 operator * ( const mat4& m ) const {
+#ifdef VEC_SSE
+	// row i of the product is the sum of the rows of m weighted by row i of this;
+	// each row is stored once and the result built from them, with no fill beforehand
+	__m128 r0 = _mm_loadu_ps( m[0] ), r1 = _mm_loadu_ps( m[1] );
+	__m128 r2 = _mm_loadu_ps( m[2] ), r3 = _mm_loadu_ps( m[3] );
+	GLfloat  a[4][4];
+	for ( int i = 0; i < 4; ++i ) {
+	    const vec4& r = _m[i];
+	    __m128 s = _mm_add_ps( _mm_mul_ps( _mm_set1_ps(r.x), r0 ), _mm_mul_ps( _mm_set1_ps(r.y), r1 ) );
+	    __m128 t = _mm_add_ps( _mm_mul_ps( _mm_set1_ps(r.z), r2 ), _mm_mul_ps( _mm_set1_ps(r.w), r3 ) );
+	    _mm_storeu_ps( a[i], _mm_add_ps( s, t ) );
+	}
+	return mat4( vec4( a[0][0], a[0][1], a[0][2], a[0][3] ), vec4( a[1][0], a[1][1], a[1][2], a[1][3] ),
+		     vec4( a[2][0], a[2][1], a[2][2], a[2][3] ), vec4( a[3][0], a[3][1], a[3][2], a[3][3] ) );
+#else
 	mat4  a( 0.0 );
-
 	for ( int i = 0; i < 4; ++i ) {
 	    for ( int j = 0; j < 4; ++j ) {
+		GLfloat  sum = 0;
 		for ( int k = 0; k < 4; ++k ) {
-		    a[i][j] += _m[i][k] * m[k][j];
+		    sum += _m[i][k] * m[k][j];
 		}
+		a[i][j] = sum;
 	    }
 	}
-
 	return a;
+#endif
     }
 
     //
@@ -442,19 +426,8 @@ class mat4 {
 	return *this;
     }
 
-    mat4& operator *= ( const mat4& m ) {
-	mat4  a( 0.0 );
-
-	for ( int i = 0; i < 4; ++i ) {
-	    for ( int j = 0; j < 4; ++j ) {
-		for ( int k = 0; k < 4; ++k ) {
-		    a[i][j] += _m[i][k] * m[k][j];
-		}
-	    }
-	}
-
-	return *this = a;
-    }
+    mat4& operator *= ( const mat4& m )
+	{ return *this = *this * m; }
 
     mat4& operator /= ( const GLfloat s ) {
 	GLfloat r = GLfloat(1.0) / s;
@@ -466,11 +439,23 @@ class mat4 {
     //
 
     vec4 operator * ( const vec4& v ) const {  // m * v
+#ifdef VEC_SSE
+	// transpose, then sum the columns weighted by v
+	__m128 c0 = _mm_loadu_ps( _m[0] ), c1 = _mm_loadu_ps( _m[1] );
+	__m128 c2 = _mm_loadu_ps( _m[2] ), c3 = _mm_loadu_ps( _m[3] );
+	_MM_TRANSPOSE4_PS( c0, c1, c2, c3 );
+	__m128 s = _mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps(v.x) ), _mm_mul_ps( c1, _mm_set1_ps(v.y) ) );
+	__m128 t = _mm_add_ps( _mm_mul_ps( c2, _mm_set1_ps(v.z) ), _mm_mul_ps( c3, _mm_set1_ps(v.w) ) );
+	vec4 r;
+	_mm_storeu_ps( r, _mm_add_ps( s, t ) );
+	return r;
+#else
 	return vec4( _m[0][0]*v.x + _m[0][1]*v.y + _m[0][2]*v.z + _m[0][3]*v.w,
 		     _m[1][0]*v.x + _m[1][1]*v.y + _m[1][2]*v.z + _m[1][3]*v.w,
 		     _m[2][0]*v.x + _m[2][1]*v.y + _m[2][2]*v.z + _m[2][3]*v.w,
 		     _m[3][0]*v.x + _m[3][1]*v.y + _m[3][2]*v.z + _m[3][3]*v.w
 	    );
+#endif
     }
 	
     //
@@ -486,7 +471,7 @@ class mat4 {
     }
 
     friend std::istream& operator >> ( std::istream& is, mat4& m )
-	{ return is >> m._m[0] >> m._m[1] >> m._m[2] >> m._m[3]; }
+	{ return is >> m[0] >> m[1] >> m[2] >> m[3]; }
 
     //
     //  --- Conversion Operators ---
@@ -514,12 +499,192 @@ mat4 matrixCompMult( const mat4& A, const mat4& B ) {
 
 inline
 mat4 transpose( const mat4& A ) {
-    return mat4( A[0][0], A[1][0], A[2][0], A[3][0],
-		 A[0][1], A[1][1], A[2][1], A[3][1],
-		 A[0][2], A[1][2], A[2][2], A[3][2],
-		 A[0][3], A[1][3], A[2][3], A[3][3] );
+#ifdef VEC_SSE
+    __m128 r0 = _mm_loadu_ps( A[0] ), r1 = _mm_loadu_ps( A[1] );
+    __m128 r2 = _mm_loadu_ps( A[2] ), r3 = _mm_loadu_ps( A[3] );
+    _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+    mat4 c;
+    _mm_storeu_ps( c[0], r0 );  _mm_storeu_ps( c[1], r1 );
+    _mm_storeu_ps( c[2], r2 );  _mm_storeu_ps( c[3], r3 );
+    return c;
+#else
+    return mat4( vec4( A[0][0], A[1][0], A[2][0], A[3][0] ),
+		 vec4( A[0][1], A[1][1], A[2][1], A[3][1] ),
+		 vec4( A[0][2], A[1][2], A[2][2], A[3][2] ),
+		 vec4( A[0][3], A[1][3], A[2][3], A[3][3] ) );
+#endif
+}
+
+//----------------------------------------------------------------------------
+//
+//  Inverse and normal matrix generators
+//
+//    inverse is general (non-finite if A is singular); affineInverse assumes a
+//    bottom row of (0, 0, 0, 1), rigidInverse also an orthonormal upper 3x3
+//    (rotation and translation only, as most modelviews here)
+//
+
+#ifdef VEC_SSE
+#define VEC_SWIZZLE( v, x, y, z, w ) _mm_shuffle_ps( v, v, _MM_SHUFFLE(w, z, y, x) )
+#define VEC_SHUFFLE( a, b, x, y, z, w ) _mm_shuffle_ps( a, b, _MM_SHUFFLE(w, z, y, x) )
+
+// 2x2 blocks, row-major in one register: AB, adj(A)B and A adj(B)
+#define VEC_MAT2MUL( a, b ) _mm_add_ps( _mm_mul_ps( a, VEC_SWIZZLE(b, 0, 3, 0, 3) ), \
+					_mm_mul_ps( VEC_SWIZZLE(a, 1, 0, 3, 2), VEC_SWIZZLE(b, 2, 1, 2, 1) ) )
+#define VEC_MAT2ADJMUL( a, b ) _mm_sub_ps( _mm_mul_ps( VEC_SWIZZLE(a, 3, 3, 0, 0), b ), \
+					   _mm_mul_ps( VEC_SWIZZLE(a, 1, 1, 2, 2), VEC_SWIZZLE(b, 2, 3, 0, 1) ) )
+#define VEC_MAT2MULADJ( a, b ) _mm_sub_ps( _mm_mul_ps( a, VEC_SWIZZLE(b, 3, 0, 3, 0) ), \
+					   _mm_mul_ps( VEC_SWIZZLE(a, 1, 0, 3, 2), VEC_SWIZZLE(b, 2, 1, 2, 1) ) )
+
+// a.yzx*b.zxy - a.zxy*b.yzx, lane 3 left 0 (w*w - w*w)
+#define VEC_CROSS( a, b ) _mm_sub_ps( _mm_mul_ps( VEC_SWIZZLE(a, 1, 2, 0, 3), VEC_SWIZZLE(b, 2, 0, 1, 3) ), \
+				      _mm_mul_ps( VEC_SWIZZLE(a, 2, 0, 1, 3), VEC_SWIZZLE(b, 1, 2, 0, 3) ) )
+
+inline
+mat4 VEC_InverseUpper( __m128 c0, __m128 c1, __m128 c2, __m128 t )
+{
+    // rows of the inverse upper 3x3 are the transposed c0, c1, c2 (lane 3 ignored);
+    // the inverse translation is -(c0*t.x + c1*t.y + c2*t.z); the bottom row stays 0, 0, 0, 1
+    __m128 it = _mm_add_ps( _mm_mul_ps( c0, VEC_SWIZZLE(t, 0, 0, 0, 0) ), _mm_mul_ps( c1, VEC_SWIZZLE(t, 1, 1, 1, 1) ) );
+    it = _mm_sub_ps( _mm_setzero_ps(), _mm_add_ps( it, _mm_mul_ps( c2, VEC_SWIZZLE(t, 2, 2, 2, 2) ) ) );
+    _MM_TRANSPOSE4_PS( c0, c1, c2, it );
+    mat4 c;
+    _mm_storeu_ps( c[0], c0 );  _mm_storeu_ps( c[1], c1 );  _mm_storeu_ps( c[2], c2 );
+    return c;
+}
+#endif
+
+inline
+mat4 inverse( const mat4& A )
+{
+#ifdef VEC_SSE
+    // 2x2 block method: A = | P Q |, inverse = 1/|A| | X Y |, from adjugates of the blocks
+    //                       | R S |                  | Z W |
+    __m128 r0 = _mm_loadu_ps( A[0] ), r1 = _mm_loadu_ps( A[1] );
+    __m128 r2 = _mm_loadu_ps( A[2] ), r3 = _mm_loadu_ps( A[3] );
+    __m128 P = _mm_movelh_ps( r0, r1 ), Q = _mm_movehl_ps( r1, r0 );
+    __m128 R = _mm_movelh_ps( r2, r3 ), S = _mm_movehl_ps( r3, r2 );
+    // block determinants |P| |Q| |R| |S|
+    __m128 dets = _mm_sub_ps( _mm_mul_ps( VEC_SHUFFLE(r0, r2, 0, 2, 0, 2), VEC_SHUFFLE(r1, r3, 1, 3, 1, 3) ),
+			      _mm_mul_ps( VEC_SHUFFLE(r0, r2, 1, 3, 1, 3), VEC_SHUFFLE(r1, r3, 0, 2, 0, 2) ) );
+    __m128 detP = VEC_SWIZZLE(dets, 0, 0, 0, 0), detQ = VEC_SWIZZLE(dets, 1, 1, 1, 1);
+    __m128 detR = VEC_SWIZZLE(dets, 2, 2, 2, 2), detS = VEC_SWIZZLE(dets, 3, 3, 3, 3);
+    __m128 SR = VEC_MAT2ADJMUL( S, R ), PQ = VEC_MAT2ADJMUL( P, Q );
+    __m128 X = _mm_sub_ps( _mm_mul_ps( detS, P ), VEC_MAT2MUL( Q, SR ) );
+    __m128 W = _mm_sub_ps( _mm_mul_ps( detP, S ), VEC_MAT2MUL( R, PQ ) );
+    __m128 Y = _mm_sub_ps( _mm_mul_ps( detQ, R ), VEC_MAT2MULADJ( S, PQ ) );
+    __m128 Z = _mm_sub_ps( _mm_mul_ps( detR, Q ), VEC_MAT2MULADJ( P, SR ) );
+    // |A| = |P||S| + |Q||R| - trace(adj(P)Q adj(S)R)
+    __m128 tr = _mm_mul_ps( PQ, VEC_SWIZZLE(SR, 0, 2, 1, 3) );
+    tr = _mm_add_ps( tr, _mm_movehl_ps( tr, tr ) );
+    tr = _mm_add_ss( tr, VEC_SWIZZLE(tr, 1, 1, 1, 1) );
+    __m128 det = _mm_sub_ss( _mm_add_ss( _mm_mul_ss( detP, detS ), _mm_mul_ss( detQ, detR ) ), tr );
+    __m128 rdet = _mm_div_ps( _mm_setr_ps( 1, -1, -1, 1 ), VEC_SWIZZLE(det, 0, 0, 0, 0) );
+    X = _mm_mul_ps( X, rdet );  Y = _mm_mul_ps( Y, rdet );
+    Z = _mm_mul_ps( Z, rdet );  W = _mm_mul_ps( W, rdet );
+    // adjugate the blocks as they are stored
+    mat4 c;
+    _mm_storeu_ps( c[0], VEC_SHUFFLE(X, Y, 3, 1, 3, 1) );
+    _mm_storeu_ps( c[1], VEC_SHUFFLE(X, Y, 2, 0, 2, 0) );
+    _mm_storeu_ps( c[2], VEC_SHUFFLE(Z, W, 3, 1, 3, 1) );
+    _mm_storeu_ps( c[3], VEC_SHUFFLE(Z, W, 2, 0, 2, 0) );
+    return c;
+#else
+    // cofactors from the 2x2 determinants of the top and bottom pairs of rows
+    const vec4 &a = A[0], &b = A[1], &c = A[2], &d = A[3];
+    GLfloat s0 = a.x*b.y - b.x*a.y, s1 = a.x*b.z - b.x*a.z, s2 = a.x*b.w - b.x*a.w;
+    GLfloat s3 = a.y*b.z - b.y*a.z, s4 = a.y*b.w - b.y*a.w, s5 = a.z*b.w - b.z*a.w;
+    GLfloat c5 = c.z*d.w - d.z*c.w, c4 = c.y*d.w - d.y*c.w, c3 = c.y*d.z - d.y*c.z;
+    GLfloat c2 = c.x*d.w - d.x*c.w, c1 = c.x*d.z - d.x*c.z, c0 = c.x*d.y - d.x*c.y;
+    GLfloat r = GLfloat(1.0) / ( s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0 );
+    return mat4( vec4(  b.y*c5 - b.z*c4 + b.w*c3, -a.y*c5 + a.z*c4 - a.w*c3,  d.y*s5 - d.z*s4 + d.w*s3, -c.y*s5 + c.z*s4 - c.w*s3 )*r,
+		 vec4( -b.x*c5 + b.z*c2 - b.w*c1,  a.x*c5 - a.z*c2 + a.w*c1, -d.x*s5 + d.z*s2 - d.w*s1,  c.x*s5 - c.z*s2 + c.w*s1 )*r,
+		 vec4(  b.x*c4 - b.y*c2 + b.w*c0, -a.x*c4 + a.y*c2 - a.w*c0,  d.x*s4 - d.y*s2 + d.w*s0, -c.x*s4 + c.y*s2 - c.w*s0 )*r,
+		 vec4( -b.x*c3 + b.y*c1 - b.z*c0,  a.x*c3 - a.y*c1 + a.z*c0, -d.x*s3 + d.y*s1 - d.z*s0,  c.x*s3 - c.y*s1 + c.z*s0 )*r );
+#endif
 }
 
+inline
+mat4 affineInverse( const mat4& A )
+{
+    // inverse upper 3x3 (transposed cofactors over the determinant) and translation
+#ifdef VEC_SSE
+    __m128 r0 = _mm_loadu_ps( A[0] ), r1 = _mm_loadu_ps( A[1] ), r2 = _mm_loadu_ps( A[2] );
+    __m128 t = _mm_setr_ps( A[0].w, A[1].w, A[2].w, 0 );
+    __m128 c0 = VEC_CROSS( r1, r2 ), c1 = VEC_CROSS( r2, r0 ), c2 = VEC_CROSS( r0, r1 );
+    __m128 det = _mm_mul_ps( r0, c0 );
+    det = _mm_add_ss( _mm_add_ss( det, VEC_SWIZZLE(det, 1, 1, 1, 1) ), VEC_SWIZZLE(det, 2, 2, 2, 2) );
+    __m128 rdet = _mm_div_ps( _mm_set1_ps(1), VEC_SWIZZLE(det, 0, 0, 0, 0) );
+    return VEC_InverseUpper( _mm_mul_ps( c0, rdet ), _mm_mul_ps( c1, rdet ), _mm_mul_ps( c2, rdet ), t );
+#else
+    vec3 r0( A[0].x, A[0].y, A[0].z ), r1( A[1].x, A[1].y, A[1].z ), r2( A[2].x, A[2].y, A[2].z );
+    vec3 c0 = cross( r1, r2 ), c1 = cross( r2, r0 ), c2 = cross( r0, r1 ), t( A[0].w, A[1].w, A[2].w );
+    GLfloat r = GLfloat(1.0) / dot( r0, c0 );
+    c0 *= r;  c1 *= r;  c2 *= r;
+    vec3 it = -( c0*t.x + c1*t.y + c2*t.z );
+    return mat4( vec4( c0.x, c1.x, c2.x, it.x ),
+		 vec4( c0.y, c1.y, c2.y, it.y ),
+		 vec4( c0.z, c1.z, c2.z, it.z ),
+		 vec4( 0, 0, 0, 1 ) );
+#endif
+}
+
+inline
+mat4 rigidInverse( const mat4& A )
+{
+    // transposed rotation and rotated, negated translation
+#ifdef VEC_SSE
+    __m128 r0 = _mm_loadu_ps( A[0] ), r1 = _mm_loadu_ps( A[1] ), r2 = _mm_loadu_ps( A[2] );
+    return VEC_InverseUpper( r0, r1, r2, _mm_setr_ps( A[0].w, A[1].w, A[2].w, 0 ) );
+#else
+    vec3 r0( A[0].x, A[0].y, A[0].z ), r1( A[1].x, A[1].y, A[1].z ), r2( A[2].x, A[2].y, A[2].z );
+    vec3 it = -( r0*A[0].w + r1*A[1].w + r2*A[2].w );
+    return mat4( vec4( r0.x, r1.x, r2.x, it.x ),
+		 vec4( r0.y, r1.y, r2.y, it.y ),
+		 vec4( r0.z, r1.z, r2.z, it.z ),
+		 vec4( 0, 0, 0, 1 ) );
+#endif
+}
+
+inline
+mat3 NormalMatrix( const mat4& A )
+{
+    // inverse transpose of the upper 3x3: its cofactors over its determinant;
+    // use as normal = NormalMatrix(modelview)*n, correct under non-uniform scale
+#ifdef VEC_SSE
+    // a*b.yzx - a.yzx*b is cross(a, b).zxy, so each row is rotated once for all three products,
+    // and the determinant is the dot of the rotated cross with r0.zxy
+    __m128 r0 = _mm_loadu_ps( A[0] ), r1 = _mm_loadu_ps( A[1] ), r2 = _mm_loadu_ps( A[2] );
+    __m128 s0 = VEC_SWIZZLE(r0, 1, 2, 0, 3), s1 = VEC_SWIZZLE(r1, 1, 2, 0, 3), s2 = VEC_SWIZZLE(r2, 1, 2, 0, 3);
+    __m128 c0 = _mm_sub_ps( _mm_mul_ps( r1, s2 ), _mm_mul_ps( s1, r2 ) );
+    __m128 c1 = _mm_sub_ps( _mm_mul_ps( r2, s0 ), _mm_mul_ps( s2, r0 ) );
+    __m128 c2 = _mm_sub_ps( _mm_mul_ps( r0, s1 ), _mm_mul_ps( s0, r1 ) );
+    __m128 det = _mm_mul_ps( VEC_SWIZZLE(r0, 2, 0, 1, 3), c0 );
+    det = _mm_add_ss( _mm_add_ss( det, VEC_SWIZZLE(det, 1, 1, 1, 1) ), VEC_SWIZZLE(det, 2, 2, 2, 2) );
+    __m128 rdet = _mm_div_ss( _mm_set_ss(1), det );  // one divide, not four
+    rdet = VEC_SWIZZLE(rdet, 0, 0, 0, 0);
+    vec4 n0, n1, n2;
+    _mm_storeu_ps( n0, _mm_mul_ps( c0, rdet ) );
+    _mm_storeu_ps( n1, _mm_mul_ps( c1, rdet ) );
+    _mm_storeu_ps( n2, _mm_mul_ps( c2, rdet ) );
+    return mat3( vec3( n0.y, n0.z, n0.x ), vec3( n1.y, n1.z, n1.x ), vec3( n2.y, n2.z, n2.x ) );
+#else
+    vec3 r0( A[0].x, A[0].y, A[0].z ), r1( A[1].x, A[1].y, A[1].z ), r2( A[2].x, A[2].y, A[2].z );
+    vec3 c0 = cross( r1, r2 ), c1 = cross( r2, r0 ), c2 = cross( r0, r1 );
+    GLfloat r = GLfloat(1.0) / dot( r0, c0 );
+    return mat3( c0*r, c1*r, c2*r );
+#endif
+}
+
+#ifdef VEC_SSE
+#undef VEC_SWIZZLE
+#undef VEC_SHUFFLE
+#undef VEC_MAT2MUL
+#undef VEC_MAT2ADJMUL
+#undef VEC_MAT2MULADJ
+#undef VEC_CROSS
+#endif
+
 //----------------------------------------------------------------------------
 //
 //  Rotation matrix generators
@@ -566,23 +731,22 @@ mat4 RotateZ( const GLfloat theta )
 //  Translation matrix generators
 //
 
-inline
+inline constexpr
 mat4 Translate( const GLfloat x, const GLfloat y, const GLfloat z )
 {
-    mat4 c;
-    c[0][3] = x;
-    c[1][3] = y;
-    c[2][3] = z;
-    return c;
+    return mat4( vec4( 1, 0, 0, x ),
+		 vec4( 0, 1, 0, y ),
+		 vec4( 0, 0, 1, z ),
+		 vec4( 0, 0, 0, 1 ) );
 }
 
-inline
+inline constexpr
 mat4 Translate( const vec3& v )
 {
     return Translate( v.x, v.y, v.z );
 }
 
-inline
+inline constexpr
 mat4 Translate( const vec4& v )
 {
     return Translate( v.x, v.y, v.z );
@@ -593,17 +757,16 @@ mat4 Translate( const vec4& v )
 //  Scale matrix generators
 //
 
-inline
+inline constexpr
 mat4 Scale( const GLfloat x, const GLfloat y, const GLfloat z )
 {
-    mat4 c;
-    c[0][0] = x;
-    c[1][1] = y;
-    c[2][2] = z;
-    return c;
+    return mat4( vec4( x, 0, 0, 0 ),
+		 vec4( 0, y, 0, 0 ),
+		 vec4( 0, 0, z, 0 ),
+		 vec4( 0, 0, 0, 1 ) );
 }
 
-inline
+inline constexpr
 mat4 Scale( const vec3& v )
 {
     return Scale( v.x, v.y, v.z );
@@ -620,43 +783,33 @@ mat4 Scale( const vec3& v )
 
 
 
-inline
+inline constexpr
 mat4 Ortho( const GLfloat left, const GLfloat right,
 	    const GLfloat bottom, const GLfloat top,
 	    const GLfloat zNear, const GLfloat zFar )
 {
-    mat4 c;
-    c[0][0] = 2.0f/(right - left);
-    c[1][1] = 2.0f/(top - bottom);
-    c[2][2] = 2.0f/(zNear - zFar);
-    c[3][3] = 1.0f;
-    c[0][3] = -(right + left)/(right - left);
-    c[1][3] = -(top + bottom)/(top - bottom);
-    c[2][3] = -(zFar + zNear)/(zFar - zNear);
-    return c;
+    return mat4( vec4( 2.0f/(right - left), 0, 0, -(right + left)/(right - left) ),
+		 vec4( 0, 2.0f/(top - bottom), 0, -(top + bottom)/(top - bottom) ),
+		 vec4( 0, 0, 2.0f/(zNear - zFar), -(zFar + zNear)/(zFar - zNear) ),
+		 vec4( 0, 0, 0, 1.0f ) );
 }
 
-inline
+inline constexpr
 mat4 Ortho2D( const GLfloat left, const GLfloat right,
 	      const GLfloat bottom, const GLfloat top )
 {
     return Ortho( left, right, bottom, top, -1.0, 1.0 );
 }
 
-inline
+inline constexpr
 mat4 Frustum( const GLfloat left, const GLfloat right,
 	      const GLfloat bottom, const GLfloat top,
 	      const GLfloat zNear, const GLfloat zFar )
 {
-    mat4 c;
-    c[0][0] = 2.0f*zNear/(right - left);
-    c[0][2] = (right + left)/(right - left);
-    c[1][1] = 2.0f*zNear/(top - bottom);
-    c[1][2] = (top + bottom)/(top - bottom);
-    c[2][2] = -(zFar + zNear)/(zFar - zNear);
-    c[2][3] = -2.0f*zFar*zNear/(zFar - zNear);
-    c[3][2] = -1.0f;
-    return c;
+    return mat4( vec4( 2.0f*zNear/(right - left), 0, (right + left)/(right - left), 0 ),
+		 vec4( 0, 2.0f*zNear/(top - bottom), (top + bottom)/(top - bottom), 0 ),
+		 vec4( 0, 0, -(zFar + zNear)/(zFar - zNear), -2.0f*zFar*zNear/(zFar - zNear) ),
+		 vec4( 0, 0, -1.0f, 0 ) );
 }
 
 inline
@@ -684,13 +837,23 @@ inline
 mat4 LookAt( const vec4& eye, const vec4& at, const vec4& up )
 {
     vec4 n = normalize(eye - at);
-    vec4 u = normalize(cross(up,n));
-    vec4 v = normalize(cross(n,u));
+    vec4 u = vec4(normalize(cross(up,n)), 0.0);
+    vec4 v = vec4(normalize(cross(n,u)), 0.0);
     vec4 t = vec4(0.0, 0.0, 0.0, 1.0);
     mat4 c = mat4(u, v, n, t);
     return c * Translate( -eye );
 }
 
+//----------------------------------------------------------------------------
+//
+//  matrices copy as bytes and are laid out as row-major arrays of GLfloat
+//
+
+static_assert( std::is_trivially_copyable<mat2>::value && std::is_standard_layout<mat2>::value, "mat2 layout" );
+static_assert( std::is_trivially_copyable<mat3>::value && std::is_standard_layout<mat3>::value, "mat3 layout" );
+static_assert( std::is_trivially_copyable<mat4>::value && std::is_standard_layout<mat4>::value, "mat4 layout" );
+static_assert( sizeof(mat4) == 16*sizeof(GLfloat), "mat4 size" );
+
 //----------------------------------------------------------------------------
 
 
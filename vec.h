@@ -11,6 +11,7 @@
 
 #include <cmath>
 #include <iostream>
+#include <type_traits>
 
 #ifndef M_PI
 #  define M_PI  3.14159265358979323846
@@ -20,21 +21,36 @@
 #  include "freeglut.h"
 #  include "freeglut_ext.h"
 
-const GLfloat  DivideByZeroTolerance = GLfloat(1.0e-07);
+// mat4 products, transpose and dot(vec4) use SSE if the compiler targets it (define VEC_NO_SIMD for scalar);
+// the rest stays scalar so it can be constexpr
+#if !defined(VEC_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define VEC_SSE
+#include <xmmintrin.h>
+#endif
+
+constexpr GLfloat  DivideByZeroTolerance = GLfloat(1.0e-07);
 const GLfloat  DegreesToRadians = (float) M_PI / 180.0f;
 
+#ifdef DEBUG
+// the divide operators are constexpr; they call this (not constexpr) only for a divisor
+// within DivideByZeroTolerance of zero, so constant expressions with valid divisors still compile
+inline void VEC_DivideByZero( const char* file, int line ) {
+    std::cerr << "[" << file << ":" << line << "] " << "Division by zero" << std::endl;
+}
+#endif // DEBUG
+
 
 //***** Triangle Type
 
 struct int2 {
 	int i1, i2;
-	int2(int i1=0, int i2=0) : i1(i1), i2(i2) {}
+	constexpr int2(int i1=0, int i2=0) : i1(i1), i2(i2) {}
 };
 
 struct int3 {
 	int i1, i2, i3;
-	int3(int i1=0, int i2=0, int i3=0) : i1(i1), i2(i2), i3(i3) {}
-	bool operator==(const int3 &a) const {return i1 == a.i1 && i2 == a.i2 && i3 == a.i3;}
+	constexpr int3(int i1=0, int i2=0, int i3=0) : i1(i1), i2(i2), i3(i3) {}
+	constexpr bool operator==(const int3 &a) const {return i1 == a.i1 && i2 == a.i2 && i3 == a.i3;}
 };
 
 
@@ -54,15 +70,12 @@ struct vec2 {
     //  --- Constructors and Destructors ---
     //
 
-    vec2( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec2( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s) {}
 
-    vec2( GLfloat x, GLfloat y ) :
+    constexpr vec2( GLfloat x, GLfloat y ) :
 	x(x), y(y) {}
 
-    vec2( const vec2& v )
-	{ x = v.x;  y = v.y;  }
-
     //
     //  --- Indexing Operator ---
     //
@@ -74,29 +87,28 @@ struct vec2 {
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    vec2 operator - () const // unary minus operator
+    constexpr vec2 operator - () const // unary minus operator
 	{ return vec2( -x, -y ); }
 
-    vec2 operator + ( const vec2& v ) const
+    constexpr vec2 operator + ( const vec2& v ) const
 	{ return vec2( x + v.x, y + v.y ); }
 
-    vec2 operator - ( const vec2& v ) const
+    constexpr vec2 operator - ( const vec2& v ) const
 	{ return vec2( x - v.x, y - v.y ); }
 
-    vec2 operator * ( const GLfloat s ) const
+    constexpr vec2 operator * ( const GLfloat s ) const
 	{ return vec2( s*x, s*y ); }
 
-    vec2 operator * ( const vec2& v ) const
+    constexpr vec2 operator * ( const vec2& v ) const
 	{ return vec2( x*v.x, y*v.y ); }
 
-    friend vec2 operator * ( const GLfloat s, const vec2& v )
+    friend constexpr vec2 operator * ( const GLfloat s, const vec2& v )
 	{ return v * s; }
 
-    vec2 operator / ( const GLfloat s ) const {
+    constexpr vec2 operator / ( const GLfloat s ) const {
 #ifdef DEBUG
-	if ( std::fabs(s) < DivideByZeroTolerance ) {
-	    std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] "
-		      << "Division by zero" << std::endl;
+	if ( (s < 0 ? -s : s) < DivideByZeroTolerance ) {
+	    VEC_DivideByZero( __FILE__, __LINE__ );
 	    return vec2();
 	}
 #endif // DEBUG
@@ -109,23 +121,22 @@ struct vec2 {
     //  --- (modifying) Arithematic Operators ---
     //
 
-    vec2& operator += ( const vec2& v )
+    constexpr vec2& operator += ( const vec2& v )
 	{ x += v.x;  y += v.y;   return *this; }
 
-    vec2& operator -= ( const vec2& v )
+    constexpr vec2& operator -= ( const vec2& v )
 	{ x -= v.x;  y -= v.y;  return *this; }
 
-    vec2& operator *= ( const GLfloat s )
+    constexpr vec2& operator *= ( const GLfloat s )
 	{ x *= s;  y *= s;   return *this; }
 
-    vec2& operator *= ( const vec2& v )
+    constexpr vec2& operator *= ( const vec2& v )
 	{ x *= v.x;  y *= v.y; return *this; }
 
-    vec2& operator /= ( const GLfloat s ) {
+    constexpr vec2& operator /= ( const GLfloat s ) {
 #ifdef DEBUG
-	if ( std::fabs(s) < DivideByZeroTolerance ) {
-	    std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] "
-		      << "Division by zero" << std::endl;
+	if ( (s < 0 ? -s : s) < DivideByZeroTolerance ) {
+	    VEC_DivideByZero( __FILE__, __LINE__ );
 	}
 #endif // DEBUG
 
@@ -162,7 +173,7 @@ struct vec2 {
 //  Non-class vec2 Methods
 //
 
-inline
+inline constexpr
 GLfloat dot( const vec2& u, const vec2& v ) {
     return u.x * v.x + u.y * v.y;
 }
@@ -193,15 +204,14 @@ struct vec3 {
     //  --- Constructors and Destructors ---
     //
 
-    vec3( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec3( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s), z(s) {}
 
-    vec3( GLfloat x, GLfloat y, GLfloat z ) :
+    constexpr vec3( GLfloat x, GLfloat y, GLfloat z ) :
 	x(x), y(y), z(z) {}
 
-    vec3( const vec3& v ) { x = v.x;  y = v.y;  z = v.z; }
-
-    vec3( const vec2& v, const float f ) { x = v.x;  y = v.y;  z = f; }
+    constexpr vec3( const vec2& v, const float f ) :
+	x(v.x), y(v.y), z(f) {}
 
     //
     //  --- Indexing Operator ---
@@ -214,29 +224,28 @@ struct vec3 {
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    vec3 operator - () const  // unary minus operator
+    constexpr vec3 operator - () const  // unary minus operator
 	{ return vec3( -x, -y, -z ); }
 
-    vec3 operator + ( const vec3& v ) const
+    constexpr vec3 operator + ( const vec3& v ) const
 	{ return vec3( x + v.x, y + v.y, z + v.z ); }
 
-    vec3 operator - ( const vec3& v ) const
+    constexpr vec3 operator - ( const vec3& v ) const
 	{ return vec3( x - v.x, y - v.y, z - v.z ); }
 
-    vec3 operator * ( const GLfloat s ) const
+    constexpr vec3 operator * ( const GLfloat s ) const
 	{ return vec3( s*x, s*y, s*z ); }
 
-    vec3 operator * ( const vec3& v ) const
+    constexpr vec3 operator * ( const vec3& v ) const
 	{ return vec3( x*v.x, y*v.y, z*v.z ); }
 
-    friend vec3 operator * ( const GLfloat s, const vec3& v )
+    friend constexpr vec3 operator * ( const GLfloat s, const vec3& v )
 	{ return v * s; }
 
-    vec3 operator / ( const GLfloat s ) const {
+    constexpr vec3 operator / ( const GLfloat s ) const {
 #ifdef DEBUG
-	if ( std::fabs(s) < DivideByZeroTolerance ) {
-	    std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] "
-		      << "Division by zero" << std::endl;
+	if ( (s < 0 ? -s : s) < DivideByZeroTolerance ) {
+	    VEC_DivideByZero( __FILE__, __LINE__ );
 	    return vec3();
 	}
 #endif // DEBUG
@@ -249,23 +258,22 @@ struct vec3 {
     //  --- (modifying) Arithematic Operators ---
     //
 
-    vec3& operator += ( const vec3& v )
+    constexpr vec3& operator += ( const vec3& v )
 	{ x += v.x;  y += v.y;  z += v.z;  return *this; }
 
-    vec3& operator -= ( const vec3& v )
+    constexpr vec3& operator -= ( const vec3& v )
 	{ x -= v.x;  y -= v.y;  z -= v.z;  return *this; }
 
-    vec3& operator *= ( const GLfloat s )
+    constexpr vec3& operator *= ( const GLfloat s )
 	{ x *= s;  y *= s;  z *= s;  return *this; }
 
-    vec3& operator *= ( const vec3& v )
+    constexpr vec3& operator *= ( const vec3& v )
 	{ x *= v.x;  y *= v.y;  z *= v.z;  return *this; }
 
-    vec3& operator /= ( const GLfloat s ) {
+    constexpr vec3& operator /= ( const GLfloat s ) {
 #ifdef DEBUG
-	if ( std::fabs(s) < DivideByZeroTolerance ) {
-	    std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] "
-		      << "Division by zero" << std::endl;
+	if ( (s < 0 ? -s : s) < DivideByZeroTolerance ) {
+	    VEC_DivideByZero( __FILE__, __LINE__ );
 	}
 #endif // DEBUG
 
@@ -302,7 +310,7 @@ struct vec3 {
 //  Non-class vec3 Methods
 //
 
-inline
+inline constexpr
 GLfloat dot( const vec3& u, const vec3& v ) {
     return u.x*v.x + u.y*v.y + u.z*v.z ;
 }
@@ -317,7 +325,7 @@ vec3 normalize( const vec3& v ) {
     return v / length(v);
 }
 
-inline
+inline constexpr
 vec3 cross(const vec3& a, const vec3& b )
 {
     return vec3( a.y * b.z - a.z * b.y,
@@ -343,19 +351,17 @@ struct vec4 {
     //  --- Constructors and Destructors ---
     //
 
-    vec4( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec4( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s), z(s), w(s) {}
 
-    vec4( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) :
+    constexpr vec4( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) :
 	x(x), y(y), z(z), w(w) {}
 
-    vec4( const vec4& v ) { x = v.x;  y = v.y;  z = v.z;  w = v.w; }
-
-    vec4( const vec3& v, const float w = 1.0 ) : w(w)
-	{ x = v.x;  y = v.y;  z = v.z; }
+    constexpr vec4( const vec3& v, const float w = 1.0 ) :
+	x(v.x), y(v.y), z(v.z), w(w) {}
 
-    vec4( const vec2& v, const float z, const float w ) : z(z), w(w)
-	{ x = v.x;  y = v.y; }
+    constexpr vec4( const vec2& v, const float z, const float w ) :
+	x(v.x), y(v.y), z(z), w(w) {}
 
     //
     //  --- Indexing Operator ---
@@ -368,29 +374,28 @@ struct vec4 {
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    vec4 operator - () const  // unary minus operator
+    constexpr vec4 operator - () const  // unary minus operator
 	{ return vec4( -x, -y, -z, -w ); }
 
-    vec4 operator + ( const vec4& v ) const
+    constexpr vec4 operator + ( const vec4& v ) const
 	{ return vec4( x + v.x, y + v.y, z + v.z, w + v.w ); }
 
-    vec4 operator - ( const vec4& v ) const
+    constexpr vec4 operator - ( const vec4& v ) const
 	{ return vec4( x - v.x, y - v.y, z - v.z, w - v.w ); }
 
-    vec4 operator * ( const GLfloat s ) const
+    constexpr vec4 operator * ( const GLfloat s ) const
 	{ return vec4( s*x, s*y, s*z, s*w ); }
 
-    vec4 operator * ( const vec4& v ) const
-	{ return vec4( x*v.x, y*v.y, z*v.z, w*v.z ); }
+    constexpr vec4 operator * ( const vec4& v ) const
+	{ return vec4( x*v.x, y*v.y, z*v.z, w*v.w ); }
 
-    friend vec4 operator * ( const GLfloat s, const vec4& v )
+    friend constexpr vec4 operator * ( const GLfloat s, const vec4& v )
 	{ return v * s; }
 
-    vec4 operator / ( const GLfloat s ) const {
+    constexpr vec4 operator / ( const GLfloat s ) const {
 #ifdef DEBUG
-	if ( std::fabs(s) < DivideByZeroTolerance ) {
-	    std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] "
-		      << "Division by zero" << std::endl;
+	if ( (s < 0 ? -s : s) < DivideByZeroTolerance ) {
+	    VEC_DivideByZero( __FILE__, __LINE__ );
 	    return vec4();
 	}
 #endif // DEBUG
@@ -403,23 +408,22 @@ struct vec4 {
     //  --- (modifying) Arithematic Operators ---
     //
 
-    vec4& operator += ( const vec4& v )
+    constexpr vec4& operator += ( const vec4& v )
 	{ x += v.x;  y += v.y;  z += v.z;  w += v.w;  return *this; }
 
-    vec4& operator -= ( const vec4& v )
+    constexpr vec4& operator -= ( const vec4& v )
 	{ x -= v.x;  y -= v.y;  z -= v.z;  w -= v.w;  return *this; }
 
-    vec4& operator *= ( const GLfloat s )
+    constexpr vec4& operator *= ( const GLfloat s )
 	{ x *= s;  y *= s;  z *= s;  w *= s;  return *this; }
 
-    vec4& operator *= ( const vec4& v )
+    constexpr vec4& operator *= ( const vec4& v )
 	{ x *= v.x, y *= v.y, z *= v.z, w *= v.w;  return *this; }
 
-    vec4& operator /= ( const GLfloat s ) {
+    constexpr vec4& operator /= ( const GLfloat s ) {
 #ifdef DEBUG
-	if ( std::fabs(s) < DivideByZeroTolerance ) {
-	    std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] "
-		      << "Division by zero" << std::endl;
+	if ( (s < 0 ? -s : s) < DivideByZeroTolerance ) {
+	    VEC_DivideByZero( __FILE__, __LINE__ );
 	}
 #endif // DEBUG
 
@@ -459,7 +463,13 @@ struct vec4 {
 
 inline
 GLfloat dot( const vec4& u, const vec4& v ) {
-    return u.x*v.x + u.y*v.y + u.z*v.z + u.w+v.w;
+#ifdef VEC_SSE
+    __m128 m = _mm_mul_ps( _mm_loadu_ps(&u.x), _mm_loadu_ps(&v.x) );
+    m = _mm_add_ps( m, _mm_movehl_ps(m, m) );			// x+z, y+w
+    return _mm_cvtss_f32( _mm_add_ss( m, _mm_shuffle_ps(m, m, 1) ) );
+#else
+    return u.x*v.x + u.y*v.y + u.z*v.z + u.w*v.w;
+#endif
 }
 
 inline
@@ -472,7 +482,7 @@ vec4 normalize( const vec4& v ) {
     return v / length(v);
 }
 
-inline
+inline constexpr
 vec3 cross(const vec4& a, const vec4& b )
 {
     return vec3( a.y * b.z - a.z * b.y,
@@ -480,6 +490,16 @@ vec3 cross(const vec4& a, const vec4& b )
 		 a.x * b.y - a.y * b.x );
 }
 
+//----------------------------------------------------------------------------
+//
+//  vectors copy as bytes (memcpy when a vector<> grows) and are laid out as arrays of GLfloat
+//
+
+static_assert( std::is_trivially_copyable<vec2>::value && std::is_standard_layout<vec2>::value, "vec2 layout" );
+static_assert( std::is_trivially_copyable<vec3>::value && std::is_standard_layout<vec3>::value, "vec3 layout" );
+static_assert( std::is_trivially_copyable<vec4>::value && std::is_standard_layout<vec4>::value, "vec4 layout" );
+static_assert( std::is_trivially_copyable<int3>::value && sizeof(int3) == 3*sizeof(int), "int3 layout" );
+
 //----------------------------------------------------------------------------
 
 #endif // __VEC_H__